@@ -0,0 +1,385 @@
+// OpenXR API layer measuring the OpenXR calls of the plug-in.
+//
+// Loaded by the OpenXR loader through XrApiLayer_bee_api_stats.json (XR_API_LAYER_PATH and
+// XR_ENABLE_API_LAYERS), so the application is not modified. Every core function, and the functions
+// of the extensions the plug-in uses, is wrapped: the wrapper times the call into the next layer or
+// the runtime and records the call count, a latency histogram and the per frame totals. A frame ends
+// with xrEndFrame. The report is written to a text file periodically and when the instance is destroyed.
+
+#define XR_USE_GRAPHICS_API_OPENGL
+#if defined(__has_include)
+#if __has_include(<vulkan/vulkan.h>)
+#include <vulkan/vulkan.h>
+#define XR_USE_GRAPHICS_API_VULKAN
+#endif
+#endif
+#include "openxr.h"
+#include "openxr_platform.h"
+#include "openxr_loader_negotiation.h"
+#include "openxr_reflection.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define BEE_XR_LAYER_EXPORT extern "C" __declspec(dllexport)
+#else
+#define BEE_XR_LAYER_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+#define BEE_XR_LAYER_NAME "XR_APILAYER_BEE_api_stats"
+
+
+namespace
+{
+
+// Wrapped functions: the core ones and the extensions the plug-in enables.
+#if defined(XR_USE_GRAPHICS_API_VULKAN)
+#define BEE_XR_LAYER_VULKAN_FUNCTIONS(_) XR_LIST_FUNCTIONS_XR_KHR_vulkan_enable2(_)
+#else
+#define BEE_XR_LAYER_VULKAN_FUNCTIONS(_)
+#endif
+
+#define BEE_XR_LAYER_FUNCTIONS(_)                 \
+    XR_LIST_FUNCTIONS_XR_VERSION_1_0(_)           \
+    XR_LIST_FUNCTIONS_XR_KHR_opengl_enable(_)     \
+    XR_LIST_FUNCTIONS_XR_EXT_debug_utils(_)       \
+    BEE_XR_LAYER_VULKAN_FUNCTIONS(_)
+
+enum FunctionIndx : uint32_t
+{
+#define BEE_XR_LAYER_INDX(name, extension) kIndx_##name,
+    BEE_XR_LAYER_FUNCTIONS(BEE_XR_LAYER_INDX)
+#undef BEE_XR_LAYER_INDX
+    kFunctionCount
+};
+
+const char* const kFunctionNames[kFunctionCount] = {
+#define BEE_XR_LAYER_NAME_STRING(name, extension) "xr" #name,
+    BEE_XR_LAYER_FUNCTIONS(BEE_XR_LAYER_NAME_STRING)
+#undef BEE_XR_LAYER_NAME_STRING
+};
+
+// Bucket i holds the calls that took [2^i, 2^(i+1)) nanoseconds.
+constexpr uint32_t kHistogramBuckets = 40;
+
+struct FunctionStats
+{
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> maxNs{0};
+    std::atomic<uint64_t> histogram[kHistogramBuckets] = {};
+};
+
+struct LayerState
+{
+    XrInstance instance = XR_NULL_HANDLE;
+    PFN_xrGetInstanceProcAddr nextGetInstanceProcAddr = nullptr;
+    PFN_xrVoidFunction next[kFunctionCount] = {};
+
+    FunctionStats functions[kFunctionCount];
+
+    // Frame totals, a frame ends when xrEndFrame returns.
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> frameCalls{0};
+    std::atomic<uint64_t> frameNs{0};
+    std::atomic<uint64_t> lastFrameCalls{0};
+    std::atomic<uint64_t> maxFrameCalls{0};
+    std::atomic<uint64_t> lastFrameNs{0};
+    std::atomic<uint64_t> maxFrameNs{0};
+
+    std::string reportPath = "bee_xr_api_stats.txt";
+    uint64_t reportIntervalFrames = 900;
+    std::mutex reportMutex;
+};
+
+LayerState g_layer;
+
+uint64_t NowNs()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void AtomicMax(std::atomic<uint64_t>& value, uint64_t candidate)
+{
+    uint64_t current = value.load(std::memory_order_relaxed);
+    while (candidate > current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed))
+    {
+    }
+}
+
+void Record(FunctionIndx indx, uint64_t durationNs)
+{
+    FunctionStats& stats = g_layer.functions[indx];
+    stats.calls.fetch_add(1, std::memory_order_relaxed);
+    stats.totalNs.fetch_add(durationNs, std::memory_order_relaxed);
+    AtomicMax(stats.maxNs, durationNs);
+
+    uint32_t bucket = 0;
+    while (bucket + 1 < kHistogramBuckets && (durationNs >> (bucket + 1)) != 0)
+    {
+        bucket++;
+    }
+    stats.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    g_layer.frameCalls.fetch_add(1, std::memory_order_relaxed);
+    g_layer.frameNs.fetch_add(durationNs, std::memory_order_relaxed);
+}
+
+// Upper bound of the histogram bucket holding the given fraction of the calls, at most the maximum.
+uint64_t PercentileNs(const FunctionStats& stats, uint64_t calls, double fraction)
+{
+    uint64_t target = static_cast<uint64_t>(static_cast<double>(calls) * fraction);
+    uint64_t maxNs = stats.maxNs.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for (uint32_t bucket = 0; bucket < kHistogramBuckets; bucket++)
+    {
+        seen += stats.histogram[bucket].load(std::memory_order_relaxed);
+        if (seen > target)
+        {
+            return std::min(2ull << bucket, static_cast<unsigned long long>(maxNs));
+        }
+    }
+    return maxNs;
+}
+
+void WriteReport()
+{
+    std::lock_guard<std::mutex> lock(g_layer.reportMutex);
+    if (g_layer.reportPath.empty())
+    {
+        return;
+    }
+
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < kFunctionCount; i++)
+    {
+        if (g_layer.functions[i].calls.load(std::memory_order_relaxed) > 0)
+        {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), [](uint32_t a, uint32_t b) {
+        return g_layer.functions[a].totalNs.load(std::memory_order_relaxed) > g_layer.functions[b].totalNs.load(std::memory_order_relaxed);
+    });
+
+    std::string temporaryPath = g_layer.reportPath + ".tmp";
+    FILE* file = fopen(temporaryPath.c_str(), "w");
+    if (file == nullptr)
+    {
+        return;
+    }
+
+    uint64_t frames = g_layer.frames.load(std::memory_order_relaxed);
+    double frameDivisor = frames > 0 ? static_cast<double>(frames) : 1.0;
+    fprintf(file, "frames %llu\n", static_cast<unsigned long long>(frames));
+    fprintf(file,
+            "calls per frame: last %llu, max %llu\n",
+            static_cast<unsigned long long>(g_layer.lastFrameCalls.load(std::memory_order_relaxed)),
+            static_cast<unsigned long long>(g_layer.maxFrameCalls.load(std::memory_order_relaxed)));
+    fprintf(file,
+            "time in OpenXR per frame: last %.3f ms, max %.3f ms\n\n",
+            g_layer.lastFrameNs.load(std::memory_order_relaxed) / 1e6,
+            g_layer.maxFrameNs.load(std::memory_order_relaxed) / 1e6);
+
+    fprintf(file,
+            "%-42s %10s %11s %11s %12s %10s %10s %10s %10s\n",
+            "function", "calls", "calls/frame", "total ms", "ms/frame", "mean us", "p50 us", "p99 us", "max us");
+    for (uint32_t i : order)
+    {
+        const FunctionStats& stats = g_layer.functions[i];
+        uint64_t calls = stats.calls.load(std::memory_order_relaxed);
+        uint64_t totalNs = stats.totalNs.load(std::memory_order_relaxed);
+        fprintf(file,
+                "%-42s %10llu %11.2f %11.3f %12.4f %10.2f %10.2f %10.2f %10.2f\n",
+                kFunctionNames[i],
+                static_cast<unsigned long long>(calls),
+                calls / frameDivisor,
+                totalNs / 1e6,
+                totalNs / 1e6 / frameDivisor,
+                totalNs / 1e3 / static_cast<double>(calls),
+                PercentileNs(stats, calls, 0.5) / 1e3,
+                PercentileNs(stats, calls, 0.99) / 1e3,
+                stats.maxNs.load(std::memory_order_relaxed) / 1e3);
+    }
+    fclose(file);
+
+    std::remove(g_layer.reportPath.c_str());
+    std::rename(temporaryPath.c_str(), g_layer.reportPath.c_str());
+}
+
+void EndFrame()
+{
+    uint64_t calls = g_layer.frameCalls.exchange(0, std::memory_order_relaxed);
+    uint64_t durationNs = g_layer.frameNs.exchange(0, std::memory_order_relaxed);
+    g_layer.lastFrameCalls.store(calls, std::memory_order_relaxed);
+    g_layer.lastFrameNs.store(durationNs, std::memory_order_relaxed);
+    AtomicMax(g_layer.maxFrameCalls, calls);
+    AtomicMax(g_layer.maxFrameNs, durationNs);
+
+    uint64_t frames = g_layer.frames.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (g_layer.reportIntervalFrames > 0 && frames % g_layer.reportIntervalFrames == 0)
+    {
+        WriteReport();
+    }
+}
+
+// Wrapper with the exact signature of the wrapped function, deduced from its PFN type.
+template <FunctionIndx Indx, typename Pfn>
+struct Intercept;
+
+template <FunctionIndx Indx, typename... Args>
+struct Intercept<Indx, XrResult(XRAPI_PTR*)(Args...)>
+{
+    static XRAPI_ATTR XrResult XRAPI_CALL Call(Args... args)
+    {
+        if constexpr (Indx == kIndx_DestroyInstance)
+        {
+            WriteReport();
+        }
+
+        using Function = XrResult(XRAPI_PTR*)(Args...);
+        uint64_t start = NowNs();
+        XrResult result = reinterpret_cast<Function>(g_layer.next[Indx])(args...);
+        Record(Indx, NowNs() - start);
+
+        if constexpr (Indx == kIndx_EndFrame)
+        {
+            EndFrame();
+        }
+        if constexpr (Indx == kIndx_DestroyInstance)
+        {
+            g_layer.instance = XR_NULL_HANDLE;
+        }
+        return result;
+    }
+};
+
+const PFN_xrVoidFunction kIntercepts[kFunctionCount] = {
+#define BEE_XR_LAYER_INTERCEPT(name, extension) \
+    reinterpret_cast<PFN_xrVoidFunction>(&Intercept<kIndx_##name, PFN_xr##name>::Call),
+    BEE_XR_LAYER_FUNCTIONS(BEE_XR_LAYER_INTERCEPT)
+#undef BEE_XR_LAYER_INTERCEPT
+};
+
+// Handled by the loader and the layer interface itself, never wrapped.
+bool IsLoaderFunction(uint32_t indx)
+{
+    return indx == kIndx_GetInstanceProcAddr || indx == kIndx_EnumerateApiLayerProperties ||
+           indx == kIndx_EnumerateInstanceExtensionProperties || indx == kIndx_CreateInstance;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL LayerGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function)
+{
+    if (name == nullptr || function == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (strcmp(name, "xrGetInstanceProcAddr") == 0)
+    {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(LayerGetInstanceProcAddr);
+        return XR_SUCCESS;
+    }
+    if (g_layer.nextGetInstanceProcAddr == nullptr)
+    {
+        *function = nullptr;
+        return XR_ERROR_HANDLE_INVALID;
+    }
+
+    for (uint32_t i = 0; i < kFunctionCount; i++)
+    {
+        if (!IsLoaderFunction(i) && g_layer.next[i] != nullptr && strcmp(name, kFunctionNames[i]) == 0)
+        {
+            *function = kIntercepts[i];
+            return XR_SUCCESS;
+        }
+    }
+    return g_layer.nextGetInstanceProcAddr(instance, name, function);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL LayerCreateApiLayerInstance(const XrInstanceCreateInfo* info,
+                                                           const XrApiLayerCreateInfo* layerInfo,
+                                                           XrInstance* instance)
+{
+    if (layerInfo == nullptr || layerInfo->nextInfo == nullptr ||
+        layerInfo->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO ||
+        layerInfo->nextInfo->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO ||
+        strcmp(layerInfo->nextInfo->layerName, BEE_XR_LAYER_NAME) != 0)
+    {
+        return XR_ERROR_INITIALIZATION_FAILED;
+    }
+    // One instance at a time, the plug-in never creates more.
+    if (g_layer.instance != XR_NULL_HANDLE)
+    {
+        return XR_ERROR_LIMIT_REACHED;
+    }
+
+    // Create the instance down the chain, skipping this layer.
+    XrApiLayerCreateInfo nextLayerInfo = *layerInfo;
+    nextLayerInfo.nextInfo = layerInfo->nextInfo->next;
+    XrResult result = layerInfo->nextInfo->nextCreateApiLayerInstance(info, &nextLayerInfo, instance);
+    if (XR_FAILED(result))
+    {
+        return result;
+    }
+
+    g_layer.instance = *instance;
+    g_layer.nextGetInstanceProcAddr = layerInfo->nextInfo->nextGetInstanceProcAddr;
+    for (uint32_t i = 0; i < kFunctionCount; i++)
+    {
+        g_layer.next[i] = nullptr;
+        if (!IsLoaderFunction(i))
+        {
+            // Extension functions the instance did not enable stay null and are not wrapped.
+            g_layer.nextGetInstanceProcAddr(*instance, kFunctionNames[i], &g_layer.next[i]);
+        }
+    }
+
+    if (const char* path = getenv("BEE_XR_API_STATS_FILE"))
+    {
+        g_layer.reportPath = path;
+    }
+    if (const char* interval = getenv("BEE_XR_API_STATS_INTERVAL"))
+    {
+        g_layer.reportIntervalFrames = strtoull(interval, nullptr, 10);
+    }
+    return XR_SUCCESS;
+}
+
+}  // namespace
+
+
+BEE_XR_LAYER_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrNegotiateLoaderApiLayerInterface(const XrNegotiateLoaderInfo* loaderInfo,
+                                                                                   const char* layerName,
+                                                                                   XrNegotiateApiLayerRequest* apiLayerRequest)
+{
+    if (loaderInfo == nullptr || layerName == nullptr || apiLayerRequest == nullptr ||
+        strcmp(layerName, BEE_XR_LAYER_NAME) != 0 || loaderInfo->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
+        loaderInfo->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loaderInfo->structSize != sizeof(XrNegotiateLoaderInfo) ||
+        apiLayerRequest->structType != XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST ||
+        apiLayerRequest->structVersion != XR_API_LAYER_INFO_STRUCT_VERSION ||
+        apiLayerRequest->structSize != sizeof(XrNegotiateApiLayerRequest))
+    {
+        return XR_ERROR_INITIALIZATION_FAILED;
+    }
+    if (loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_API_LAYER_VERSION ||
+        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_API_LAYER_VERSION ||
+        XR_VERSION_MAJOR(loaderInfo->maxApiVersion) < 1 || XR_VERSION_MAJOR(loaderInfo->minApiVersion) > 1)
+    {
+        return XR_ERROR_INITIALIZATION_FAILED;
+    }
+
+    apiLayerRequest->layerInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+    apiLayerRequest->layerApiVersion = XR_CURRENT_API_VERSION;
+    apiLayerRequest->getInstanceProcAddr = LayerGetInstanceProcAddr;
+    apiLayerRequest->createApiLayerInstance = LayerCreateApiLayerInstance;
+    return XR_SUCCESS;
+}
@@ -0,0 +1,2188 @@
+// Mock OpenXR runtime for headless testing and benchmarking of the plug-in.
+//
+// Loaded by the OpenXR loader through bee_xr_mock_runtime.json (XR_RUNTIME_JSON). It simulates one
+// instance with one head mounted system: session state transitions, deterministic frame timing,
+// scripted head and controller poses and input, and swapchains backed by GL textures created in the
+// application's current (software) GL context.
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#define XR_USE_GRAPHICS_API_OPENGL
+#include "openxr.h"
+#include "openxr_platform.h"
+#include "openxr_loader_negotiation.h"
+#include "openxr_reflection.h"
+
+#include "MockScript.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#if defined(_WIN32)
+#define MOCK_XR_EXPORT extern "C" __declspec(dllexport)
+#else
+#define MOCK_XR_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+
+// Handle objects. The OpenXR headers only forward declare them.
+
+struct XrInstance_T
+{
+    std::vector<std::string> enabledExtensions;
+    std::vector<std::string> paths;             // XrPath n is paths[n - 1]
+    std::unordered_map<std::string, XrPath> pathIds;
+    std::deque<XrEventDataBuffer> events;
+    MockScript script;
+    XrSession session = XR_NULL_HANDLE;
+    std::vector<XrDebugUtilsMessengerEXT> messengers;
+};
+
+struct XrSession_T
+{
+    XrInstance instance = XR_NULL_HANDLE;
+    XrSessionState state = XR_SESSION_STATE_UNKNOWN;
+    bool running = false;
+    bool exitRequested = false;
+    bool lost = false;
+    bool headless = false;
+    XrViewConfigurationType viewConfiguration = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+
+    // Frame loop.
+    uint64_t frameIndx = 0;                 // Frames returned by xrWaitFrame
+    uint64_t framesEnded = 0;
+    bool firstFrameSinceBegin = false;      // Set by xrBeginSession, cleared by the next xrEndFrame
+    bool frameBegun = false;
+    bool frameWaited = false;
+    XrTime lastPredictedDisplayTime = 0;
+    XrTime lastTriggerTime = -1;            // Script time of the last trigger fired
+    std::chrono::steady_clock::time_point realtimeStart;
+    uint64_t beginFrameIndx = 0;            // frameIndx at xrBeginSession, realtime pacing starts there
+
+    // Input.
+    std::vector<XrActionSet> attachedActionSets;
+    XrPath currentProfile = XR_NULL_PATH;
+    std::unordered_map<std::string, float> inputs;      // Input path -> value at the last xrSyncActions
+    XrTime lastSyncTime = 0;
+
+    // Statistics written on xrDestroyInstance when MOCK_XR_STATS_FILE is set.
+    uint64_t layersSubmitted = 0;
+};
+
+struct XrActionSet_T
+{
+    XrInstance instance = XR_NULL_HANDLE;
+    std::string name;
+    uint32_t priority = 0;
+    bool attached = false;
+    std::vector<XrAction> actions;
+};
+
+struct XrAction_T
+{
+    XrActionSet actionSet = XR_NULL_HANDLE;
+    std::string name;
+    XrActionType type = XR_ACTION_TYPE_BOOLEAN_INPUT;
+    std::vector<XrPath> subactionPaths;
+    // Interaction profile -> bound input paths.
+    std::unordered_map<XrPath, std::vector<XrPath>> bindings;
+    // Subaction path -> last value returned, for changedSinceLastSync.
+    std::unordered_map<XrPath, float> lastValues;
+    std::unordered_map<XrPath, XrTime> lastChangeTimes;
+};
+
+struct XrSpace_T
+{
+    XrSession session = XR_NULL_HANDLE;
+    XrReferenceSpaceType referenceSpaceType = XR_REFERENCE_SPACE_TYPE_MAX_ENUM;   // MAX_ENUM for action spaces
+    XrAction action = XR_NULL_HANDLE;
+    XrPath subactionPath = XR_NULL_PATH;
+    XrPosef poseInSpace = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
+};
+
+struct XrSwapchain_T
+{
+    XrSession session = XR_NULL_HANDLE;
+    XrSwapchainCreateInfo createInfo = {XR_TYPE_SWAPCHAIN_CREATE_INFO};
+    std::vector<uint32_t> images;
+    std::deque<uint32_t> acquired;          // Acquired, in order, not yet released
+    uint32_t nextImage = 0;
+    bool waited = false;
+    bool staticImageReleased = false;
+};
+
+struct XrDebugUtilsMessengerEXT_T
+{
+    XrInstance instance = XR_NULL_HANDLE;
+    XrDebugUtilsMessengerCreateInfoEXT createInfo = {XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT};
+};
+
+
+namespace
+{
+
+// Configuration read from the environment when the instance is created.
+struct MockConfig
+{
+    uint32_t width = 1440;
+    uint32_t height = 1584;
+    uint32_t imageCount = 3;
+    double displayHz = 90.0;
+    bool realtime = false;              // Pace xrWaitFrame to the display rate instead of returning immediately
+    float ipd = 0.063f;
+    float fovHalfAngle = 0.785398f;     // 45 degrees on every side
+    std::string scriptPath;
+    std::string statsPath;
+};
+
+constexpr XrTime kStartTime = 1000000000;   // 1 second, so XrTime 0 is never a valid display time
+constexpr uint32_t kMaxLayerCount = 16;
+
+const char* const kRuntimeName = "Bee Mock Runtime";
+
+const char* const kSupportedExtensions[] = {
+    XR_KHR_OPENGL_ENABLE_EXTENSION_NAME,
+    XR_EXT_DEBUG_UTILS_EXTENSION_NAME,
+    XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME,
+    XR_KHR_COMPOSITION_LAYER_CUBE_EXTENSION_NAME,
+    XR_KHR_COMPOSITION_LAYER_CYLINDER_EXTENSION_NAME,
+    XR_KHR_COMPOSITION_LAYER_EQUIRECT2_EXTENSION_NAME,
+    XR_MND_HEADLESS_EXTENSION_NAME,
+    XR_EXT_LOCAL_FLOOR_EXTENSION_NAME,
+    "XR_MNDX_egl_enable",
+};
+
+std::recursive_mutex g_mutex;
+MockConfig g_config;
+XrInstance g_instance = XR_NULL_HANDLE;
+
+std::unordered_set<void*> g_handles;
+
+template <typename T>
+bool IsValid(T handle)
+{
+    return handle != XR_NULL_HANDLE && g_handles.count(reinterpret_cast<void*>(handle)) != 0;
+}
+
+template <typename T>
+T CreateHandle()
+{
+    T handle = new std::remove_pointer_t<T>();
+    g_handles.insert(handle);
+    return handle;
+}
+
+template <typename T>
+void DestroyHandle(T handle)
+{
+    g_handles.erase(handle);
+    delete handle;
+}
+
+std::string GetEnvString(const char* name)
+{
+    const char* value = std::getenv(name);
+    return value ? value : "";
+}
+
+void ReadConfig()
+{
+    g_config = MockConfig();
+    std::string value;
+    if (!(value = GetEnvString("MOCK_XR_RESOLUTION")).empty())
+    {
+        unsigned width = 0, height = 0;
+        if (sscanf(value.c_str(), "%ux%u", &width, &height) == 2 && width > 0 && height > 0)
+        {
+            g_config.width = width;
+            g_config.height = height;
+        }
+    }
+    if (!(value = GetEnvString("MOCK_XR_DISPLAY_HZ")).empty())
+    {
+        double hz = atof(value.c_str());
+        if (hz > 0.0)
+        {
+            g_config.displayHz = hz;
+        }
+    }
+    g_config.realtime = GetEnvString("MOCK_XR_REALTIME") == "1";
+    g_config.scriptPath = GetEnvString("MOCK_XR_SCRIPT");
+    g_config.statsPath = GetEnvString("MOCK_XR_STATS_FILE");
+}
+
+XrDuration DisplayPeriod()
+{
+    return static_cast<XrDuration>(1000000000.0 / g_config.displayHz);
+}
+
+template <typename T>
+XrResult FillArray(uint32_t capacityInput, uint32_t* countOutput, T* output, const std::vector<T>& values)
+{
+    if (countOutput == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *countOutput = static_cast<uint32_t>(values.size());
+    if (capacityInput == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (capacityInput < values.size())
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        output[i] = values[i];
+    }
+    return XR_SUCCESS;
+}
+
+XrResult FillString(uint32_t capacityInput, uint32_t* countOutput, char* buffer, const std::string& value)
+{
+    if (countOutput == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *countOutput = static_cast<uint32_t>(value.size() + 1);
+    if (capacityInput == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (capacityInput < value.size() + 1)
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+    memcpy(buffer, value.c_str(), value.size() + 1);
+    return XR_SUCCESS;
+}
+
+bool IsExtensionEnabled(XrInstance instance, const char* name)
+{
+    for (const std::string& extension : instance->enabledExtensions)
+    {
+        if (extension == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::string& PathString(XrInstance instance, XrPath path)
+{
+    static const std::string empty;
+    if (path == XR_NULL_PATH || path > instance->paths.size())
+    {
+        return empty;
+    }
+    return instance->paths[path - 1];
+}
+
+XrPath GetPath(XrInstance instance, const std::string& str)
+{
+    auto it = instance->pathIds.find(str);
+    if (it != instance->pathIds.end())
+    {
+        return it->second;
+    }
+    instance->paths.push_back(str);
+    XrPath path = static_cast<XrPath>(instance->paths.size());
+    instance->pathIds[str] = path;
+    return path;
+}
+
+bool StartsWith(const std::string& str, const std::string& prefix)
+{
+    return str.size() >= prefix.size() && str.compare(0, prefix.size(), prefix) == 0;
+}
+
+
+// Pose math.
+
+XrVector3f Rotate(const XrQuaternionf& q, const XrVector3f& v)
+{
+    // v' = v + 2w(q x v) + 2(q x (q x v))
+    XrVector3f u = {q.x, q.y, q.z};
+    XrVector3f t = {2.0f * (u.y * v.z - u.z * v.y), 2.0f * (u.z * v.x - u.x * v.z), 2.0f * (u.x * v.y - u.y * v.x)};
+    return {v.x + q.w * t.x + (u.y * t.z - u.z * t.y),
+            v.y + q.w * t.y + (u.z * t.x - u.x * t.z),
+            v.z + q.w * t.z + (u.x * t.y - u.y * t.x)};
+}
+
+XrQuaternionf Multiply(const XrQuaternionf& a, const XrQuaternionf& b)
+{
+    return {a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+
+// a * b, pose b expressed in the frame of pose a.
+XrPosef Compose(const XrPosef& a, const XrPosef& b)
+{
+    XrPosef result;
+    XrVector3f rotated = Rotate(a.orientation, b.position);
+    result.position = {a.position.x + rotated.x, a.position.y + rotated.y, a.position.z + rotated.z};
+    result.orientation = Multiply(a.orientation, b.orientation);
+    return result;
+}
+
+XrPosef Invert(const XrPosef& pose)
+{
+    XrPosef result;
+    result.orientation = {-pose.orientation.x, -pose.orientation.y, -pose.orientation.z, pose.orientation.w};
+    XrVector3f rotated = Rotate(result.orientation, pose.position);
+    result.position = {-rotated.x, -rotated.y, -rotated.z};
+    return result;
+}
+
+const XrPosef kIdentityPose = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
+
+
+// Script time is measured from the first predicted display time.
+XrTime ScriptTime(XrTime time)
+{
+    return time - kStartTime - DisplayPeriod();
+}
+
+XrPosef SampleUserPose(XrInstance instance, const char* userPath, XrTime time)
+{
+    XrPosef pose = kIdentityPose;
+    instance->script.SamplePose(userPath, ScriptTime(time), pose);
+    return pose;
+}
+
+// Pose of the origin of a reference space in stage space.
+XrPosef ReferenceSpaceInStage(XrInstance instance, XrReferenceSpaceType type, XrTime time)
+{
+    switch (type)
+    {
+        case XR_REFERENCE_SPACE_TYPE_VIEW:
+            return SampleUserPose(instance, "/user/head", time);
+        case XR_REFERENCE_SPACE_TYPE_LOCAL:
+        {
+            // Eye level at the initial head position, facing -Z.
+            XrPosef head = SampleUserPose(instance, "/user/head", kStartTime + DisplayPeriod());
+            XrPosef local = kIdentityPose;
+            local.position = head.position;
+            return local;
+        }
+        case XR_REFERENCE_SPACE_TYPE_LOCAL_FLOOR_EXT:
+        {
+            XrPosef head = SampleUserPose(instance, "/user/head", kStartTime + DisplayPeriod());
+            XrPosef localFloor = kIdentityPose;
+            localFloor.position = {head.position.x, 0.0f, head.position.z};
+            return localFloor;
+        }
+        default:
+            return kIdentityPose;
+    }
+}
+
+// The user path (/user/hand/left or /user/hand/right) an action space is bound to.
+std::string ActionSpaceUserPath(XrSpace space)
+{
+    XrInstance instance = space->session->instance;
+    if (space->subactionPath != XR_NULL_PATH)
+    {
+        return PathString(instance, space->subactionPath);
+    }
+    // Without a subaction path use the first bound input of the current profile.
+    auto it = space->action->bindings.find(space->session->currentProfile);
+    if (it != space->action->bindings.end() && !it->second.empty())
+    {
+        const std::string& binding = PathString(instance, it->second.front());
+        size_t input = binding.find("/input");
+        return binding.substr(0, input);
+    }
+    return "";
+}
+
+bool IsActionSpaceActive(XrSpace space)
+{
+    XrSession session = space->session;
+    if (!space->action->actionSet->attached)
+    {
+        return false;
+    }
+    auto it = space->action->bindings.find(session->currentProfile);
+    if (it == space->action->bindings.end())
+    {
+        return false;
+    }
+    std::string userPath = ActionSpaceUserPath(space);
+    for (XrPath binding : it->second)
+    {
+        if (!userPath.empty() && StartsWith(PathString(session->instance, binding), userPath))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SpaceInStage(XrSpace space, XrTime time, XrPosef& pose)
+{
+    XrInstance instance = space->session->instance;
+    if (space->action == XR_NULL_HANDLE)
+    {
+        pose = Compose(ReferenceSpaceInStage(instance, space->referenceSpaceType, time), space->poseInSpace);
+        return true;
+    }
+    if (!IsActionSpaceActive(space))
+    {
+        return false;
+    }
+    XrPosef hand = SampleUserPose(instance, ActionSpaceUserPath(space).c_str(), time);
+    pose = Compose(hand, space->poseInSpace);
+    return true;
+}
+
+
+// Events.
+
+void EmitDebugMessage(XrInstance instance, XrDebugUtilsMessageSeverityFlagsEXT severity, const char* messageId, const std::string& message)
+{
+    XrDebugUtilsMessengerCallbackDataEXT callbackData{XR_TYPE_DEBUG_UTILS_MESSENGER_CALLBACK_DATA_EXT};
+    callbackData.messageId = messageId;
+    callbackData.functionName = messageId;
+    callbackData.message = message.c_str();
+    for (XrDebugUtilsMessengerEXT messenger : instance->messengers)
+    {
+        const XrDebugUtilsMessengerCreateInfoEXT& info = messenger->createInfo;
+        if ((info.messageSeverities & severity) && (info.messageTypes & XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT))
+        {
+            info.userCallback(severity, XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT, &callbackData, info.userData);
+        }
+    }
+}
+
+void PushEvent(XrInstance instance, const XrEventDataBuffer& event)
+{
+    instance->events.push_back(event);
+}
+
+void SetSessionState(XrSession session, XrSessionState state, XrTime time)
+{
+    if (session->state == state)
+    {
+        return;
+    }
+    session->state = state;
+
+    char stateName[64];
+    snprintf(stateName, sizeof(stateName), "Session state changed to %d", int(state));
+    EmitDebugMessage(session->instance, XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT, "xrPollEvent", stateName);
+
+    XrEventDataBuffer buffer{XR_TYPE_EVENT_DATA_BUFFER};
+    XrEventDataSessionStateChanged* stateChanged = reinterpret_cast<XrEventDataSessionStateChanged*>(&buffer);
+    stateChanged->type = XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED;
+    stateChanged->next = nullptr;
+    stateChanged->session = session;
+    stateChanged->state = state;
+    stateChanged->time = time;
+    PushEvent(session->instance, buffer);
+}
+
+void FireScriptTrigger(XrSession session, const MockScript::TriggerKey& trigger, XrTime time)
+{
+    XrInstance instance = session->instance;
+    if (trigger.command == "state")
+    {
+        if (trigger.name == "synchronized" && session->running)
+        {
+            SetSessionState(session, XR_SESSION_STATE_SYNCHRONIZED, time);
+        }
+        else if (trigger.name == "visible" && session->running)
+        {
+            SetSessionState(session, XR_SESSION_STATE_VISIBLE, time);
+        }
+        else if (trigger.name == "focused" && session->running)
+        {
+            SetSessionState(session, XR_SESSION_STATE_FOCUSED, time);
+        }
+        else if (trigger.name == "stopping" && session->running)
+        {
+            // Simulates the headset being taken off: the application has to end the session.
+            SetSessionState(session, XR_SESSION_STATE_VISIBLE, time);
+            SetSessionState(session, XR_SESSION_STATE_SYNCHRONIZED, time);
+            SetSessionState(session, XR_SESSION_STATE_STOPPING, time);
+        }
+        else if (trigger.name == "ready" && !session->running && session->state == XR_SESSION_STATE_IDLE)
+        {
+            SetSessionState(session, XR_SESSION_STATE_READY, time);
+        }
+        else if (trigger.name == "loss_pending")
+        {
+            session->lost = true;
+            SetSessionState(session, XR_SESSION_STATE_LOSS_PENDING, time);
+        }
+        else
+        {
+            EmitDebugMessage(instance, XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "MockScript",
+                             "Ignoring scripted state " + trigger.name);
+        }
+        return;
+    }
+
+    XrEventDataBuffer buffer{XR_TYPE_EVENT_DATA_BUFFER};
+    if (trigger.name == "reference_space_change")
+    {
+        // event reference_space_change <local|stage|local_floor> px py pz qx qy qz qw
+        XrEventDataReferenceSpaceChangePending* event = reinterpret_cast<XrEventDataReferenceSpaceChangePending*>(&buffer);
+        event->type = XR_TYPE_EVENT_DATA_REFERENCE_SPACE_CHANGE_PENDING;
+        event->session = session;
+        event->referenceSpaceType = XR_REFERENCE_SPACE_TYPE_STAGE;
+        event->changeTime = time;
+        event->poseValid = trigger.args.size() >= 7;
+        event->poseInPreviousSpace = kIdentityPose;
+        if (event->poseValid)
+        {
+            event->poseInPreviousSpace.position = {trigger.args[0], trigger.args[1], trigger.args[2]};
+            event->poseInPreviousSpace.orientation = {trigger.args[3], trigger.args[4], trigger.args[5], trigger.args[6]};
+        }
+        PushEvent(instance, buffer);
+    }
+    else if (trigger.name == "interaction_profile_changed")
+    {
+        XrEventDataInteractionProfileChanged* event = reinterpret_cast<XrEventDataInteractionProfileChanged*>(&buffer);
+        event->type = XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED;
+        event->session = session;
+        PushEvent(instance, buffer);
+    }
+    else if (trigger.name == "instance_loss_pending")
+    {
+        XrEventDataInstanceLossPending* event = reinterpret_cast<XrEventDataInstanceLossPending*>(&buffer);
+        event->type = XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING;
+        event->lossTime = time + DisplayPeriod() * 10;
+        PushEvent(instance, buffer);
+    }
+    else if (trigger.name == "events_lost")
+    {
+        XrEventDataEventsLost* event = reinterpret_cast<XrEventDataEventsLost*>(&buffer);
+        event->type = XR_TYPE_EVENT_DATA_EVENTS_LOST;
+        event->lostEventCount = trigger.args.empty() ? 1 : static_cast<uint32_t>(trigger.args[0]);
+        PushEvent(instance, buffer);
+    }
+    else
+    {
+        EmitDebugMessage(instance, XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "MockScript", "Unknown scripted event " + trigger.name);
+    }
+}
+
+
+// GL backed swapchain images. Without a current GL context the texture names are still unique so the
+// frame loop can be driven with a null renderer.
+
+uint32_t g_fakeTextureName = 0x10000;
+
+bool HasCurrentGLContext()
+{
+    return glGetString(GL_VERSION) != nullptr;
+}
+
+void CreateSwapchainImages(XrSwapchain swapchain)
+{
+    const XrSwapchainCreateInfo& info = swapchain->createInfo;
+    uint32_t imageCount = (info.createFlags & XR_SWAPCHAIN_CREATE_STATIC_IMAGE_BIT) ? 1 : g_config.imageCount;
+    swapchain->images.resize(imageCount);
+
+    if (!HasCurrentGLContext())
+    {
+        for (uint32_t& image : swapchain->images)
+        {
+            image = g_fakeTextureName++;
+        }
+        return;
+    }
+
+    bool depth = info.format == GL_DEPTH_COMPONENT16 || info.format == GL_DEPTH_COMPONENT24 ||
+                 info.format == GL_DEPTH_COMPONENT32F || info.format == GL_DEPTH24_STENCIL8;
+    GLenum format = depth ? GL_DEPTH_COMPONENT : GL_RGBA;
+    GLenum type = depth ? GL_FLOAT : GL_UNSIGNED_BYTE;
+
+    glGenTextures(static_cast<GLsizei>(imageCount), swapchain->images.data());
+    for (uint32_t image : swapchain->images)
+    {
+        if (info.faceCount == 6)
+        {
+            glBindTexture(GL_TEXTURE_CUBE_MAP, image);
+            for (GLenum face = 0; face < 6; face++)
+            {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, static_cast<GLint>(info.format), static_cast<GLsizei>(info.width),
+                             static_cast<GLsizei>(info.height), 0, format, type, nullptr);
+            }
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        }
+        else if (info.arraySize > 1)
+        {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, image);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, static_cast<GLint>(info.format), static_cast<GLsizei>(info.width),
+                         static_cast<GLsizei>(info.height), static_cast<GLsizei>(info.arraySize), 0, format, type, nullptr);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_2D, image);
+            glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(info.format), static_cast<GLsizei>(info.width),
+                         static_cast<GLsizei>(info.height), 0, format, type, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+    }
+}
+
+void DestroySwapchainImages(XrSwapchain swapchain)
+{
+    if (!swapchain->images.empty() && swapchain->images.front() < 0x10000 && HasCurrentGLContext())
+    {
+        glDeleteTextures(static_cast<GLsizei>(swapchain->images.size()), swapchain->images.data());
+    }
+    swapchain->images.clear();
+}
+
+void WriteStats(XrInstance instance)
+{
+    if (g_config.statsPath.empty() || instance->session == XR_NULL_HANDLE)
+    {
+        return;
+    }
+    std::ofstream stream(g_config.statsPath);
+    stream << "frames_waited " << instance->session->frameIndx << "\n";
+    stream << "frames_ended " << instance->session->framesEnded << "\n";
+    stream << "layers_submitted " << instance->session->layersSubmitted << "\n";
+}
+
+}  // namespace
+
+
+#define MOCK_XR_CHECK_INSTANCE(instance)          \
+    std::lock_guard<std::recursive_mutex> lock(g_mutex); \
+    if (!IsValid(instance)) return XR_ERROR_HANDLE_INVALID;
+
+#define MOCK_XR_CHECK_SESSION(session)            \
+    std::lock_guard<std::recursive_mutex> lock(g_mutex); \
+    if (!IsValid(session)) return XR_ERROR_HANDLE_INVALID; \
+    if (session->lost) return XR_ERROR_SESSION_LOST;
+
+
+// Instance
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateInstanceExtensionProperties(const char* layerName,
+                                                                        uint32_t propertyCapacityInput,
+                                                                        uint32_t* propertyCountOutput,
+                                                                        XrExtensionProperties* properties)
+{
+    if (layerName != nullptr)
+    {
+        return XR_ERROR_API_LAYER_NOT_PRESENT;
+    }
+    std::vector<XrExtensionProperties> extensions;
+    for (const char* name : kSupportedExtensions)
+    {
+        XrExtensionProperties extension{XR_TYPE_EXTENSION_PROPERTIES};
+        strncpy(extension.extensionName, name, XR_MAX_EXTENSION_NAME_SIZE - 1);
+        extension.extensionVersion = 1;
+        extensions.push_back(extension);
+    }
+    return FillArray(propertyCapacityInput, propertyCountOutput, properties, extensions);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateApiLayerProperties(uint32_t propertyCapacityInput,
+                                                               uint32_t* propertyCountOutput,
+                                                               XrApiLayerProperties* properties)
+{
+    (void)properties;
+    (void)propertyCapacityInput;
+    if (propertyCountOutput == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *propertyCountOutput = 0;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateInstance(const XrInstanceCreateInfo* createInfo, XrInstance* instance)
+{
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (createInfo == nullptr || instance == nullptr || createInfo->type != XR_TYPE_INSTANCE_CREATE_INFO)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (g_instance != XR_NULL_HANDLE)
+    {
+        return XR_ERROR_LIMIT_REACHED;
+    }
+
+    std::vector<std::string> enabledExtensions;
+    for (uint32_t i = 0; i < createInfo->enabledExtensionCount; i++)
+    {
+        bool supported = false;
+        for (const char* name : kSupportedExtensions)
+        {
+            supported |= strcmp(name, createInfo->enabledExtensionNames[i]) == 0;
+        }
+        if (!supported)
+        {
+            return XR_ERROR_EXTENSION_NOT_PRESENT;
+        }
+        enabledExtensions.push_back(createInfo->enabledExtensionNames[i]);
+    }
+
+    ReadConfig();
+    XrInstance newInstance = CreateHandle<XrInstance>();
+    newInstance->enabledExtensions = enabledExtensions;
+    newInstance->script.SetDefaults();
+    if (!g_config.scriptPath.empty())
+    {
+        newInstance->script.Load(g_config.scriptPath);
+    }
+
+    g_instance = newInstance;
+    *instance = newInstance;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroyInstance(XrInstance instance)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    WriteStats(instance);
+    for (XrDebugUtilsMessengerEXT messenger : instance->messengers)
+    {
+        DestroyHandle(messenger);
+    }
+    DestroyHandle(instance);
+    g_instance = XR_NULL_HANDLE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetInstanceProperties(XrInstance instance, XrInstanceProperties* instanceProperties)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (instanceProperties == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    instanceProperties->runtimeVersion = XR_MAKE_VERSION(0, 1, 0);
+    strncpy(instanceProperties->runtimeName, kRuntimeName, XR_MAX_RUNTIME_NAME_SIZE - 1);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockPollEvent(XrInstance instance, XrEventDataBuffer* eventData)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (eventData == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (instance->events.empty())
+    {
+        return XR_EVENT_UNAVAILABLE;
+    }
+    *eventData = instance->events.front();
+    instance->events.pop_front();
+    return XR_SUCCESS;
+}
+
+#define MOCK_XR_RESULT_STRING(name, value) \
+    case name:                             \
+        str = #name;                       \
+        break;
+
+XRAPI_ATTR XrResult XRAPI_CALL MockResultToString(XrInstance instance, XrResult value, char buffer[XR_MAX_RESULT_STRING_SIZE])
+{
+    (void)instance;
+    const char* str = nullptr;
+    switch (value)
+    {
+        XR_LIST_ENUM_XrResult(MOCK_XR_RESULT_STRING)
+        default:
+            break;
+    }
+    if (str == nullptr)
+    {
+        snprintf(buffer, XR_MAX_RESULT_STRING_SIZE, "%s_%d", value < 0 ? "XR_UNKNOWN_FAILURE" : "XR_UNKNOWN_SUCCESS", int(value));
+    }
+    else
+    {
+        snprintf(buffer, XR_MAX_RESULT_STRING_SIZE, "%s", str);
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockStructureTypeToString(XrInstance instance, XrStructureType value, char buffer[XR_MAX_STRUCTURE_NAME_SIZE])
+{
+    (void)instance;
+    const char* str = nullptr;
+    switch (value)
+    {
+        XR_LIST_ENUM_XrStructureType(MOCK_XR_RESULT_STRING)
+        default:
+            break;
+    }
+    snprintf(buffer, XR_MAX_STRUCTURE_NAME_SIZE, "%s", str ? str : "XR_UNKNOWN_STRUCTURE_TYPE");
+    return XR_SUCCESS;
+}
+
+
+// System
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (getInfo == nullptr || systemId == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (getInfo->formFactor != XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY)
+    {
+        return XR_ERROR_FORM_FACTOR_UNSUPPORTED;
+    }
+    *systemId = 1;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetSystemProperties(XrInstance instance, XrSystemId systemId, XrSystemProperties* properties)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (systemId != 1)
+    {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    properties->systemId = systemId;
+    properties->vendorId = 0;
+    strncpy(properties->systemName, kRuntimeName, XR_MAX_SYSTEM_NAME_SIZE - 1);
+    properties->graphicsProperties.maxSwapchainImageWidth = 4096;
+    properties->graphicsProperties.maxSwapchainImageHeight = 4096;
+    properties->graphicsProperties.maxLayerCount = kMaxLayerCount;
+    properties->trackingProperties.orientationTracking = XR_TRUE;
+    properties->trackingProperties.positionTracking = XR_TRUE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateEnvironmentBlendModes(XrInstance instance,
+                                                                  XrSystemId systemId,
+                                                                  XrViewConfigurationType viewConfigurationType,
+                                                                  uint32_t environmentBlendModeCapacityInput,
+                                                                  uint32_t* environmentBlendModeCountOutput,
+                                                                  XrEnvironmentBlendMode* environmentBlendModes)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    (void)viewConfigurationType;
+    if (systemId != 1)
+    {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    return FillArray(environmentBlendModeCapacityInput, environmentBlendModeCountOutput, environmentBlendModes,
+                     std::vector<XrEnvironmentBlendMode>{XR_ENVIRONMENT_BLEND_MODE_OPAQUE});
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateViewConfigurations(XrInstance instance,
+                                                               XrSystemId systemId,
+                                                               uint32_t viewConfigurationTypeCapacityInput,
+                                                               uint32_t* viewConfigurationTypeCountOutput,
+                                                               XrViewConfigurationType* viewConfigurationTypes)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (systemId != 1)
+    {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    return FillArray(viewConfigurationTypeCapacityInput, viewConfigurationTypeCountOutput, viewConfigurationTypes,
+                     std::vector<XrViewConfigurationType>{XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO});
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetViewConfigurationProperties(XrInstance instance,
+                                                                  XrSystemId systemId,
+                                                                  XrViewConfigurationType viewConfigurationType,
+                                                                  XrViewConfigurationProperties* configurationProperties)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (systemId != 1)
+    {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    if (viewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO)
+    {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+    configurationProperties->viewConfigurationType = viewConfigurationType;
+    configurationProperties->fovMutable = XR_FALSE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateViewConfigurationViews(XrInstance instance,
+                                                                   XrSystemId systemId,
+                                                                   XrViewConfigurationType viewConfigurationType,
+                                                                   uint32_t viewCapacityInput,
+                                                                   uint32_t* viewCountOutput,
+                                                                   XrViewConfigurationView* views)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (systemId != 1)
+    {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    if (viewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO)
+    {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+    if (viewCountOutput == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *viewCountOutput = 2;
+    if (viewCapacityInput == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (viewCapacityInput < 2)
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        views[i].recommendedImageRectWidth = g_config.width;
+        views[i].maxImageRectWidth = 4096;
+        views[i].recommendedImageRectHeight = g_config.height;
+        views[i].maxImageRectHeight = 4096;
+        views[i].recommendedSwapchainSampleCount = 1;
+        views[i].maxSwapchainSampleCount = 1;
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetOpenGLGraphicsRequirementsKHR(XrInstance instance,
+                                                                    XrSystemId systemId,
+                                                                    XrGraphicsRequirementsOpenGLKHR* graphicsRequirements)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (systemId != 1)
+    {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    graphicsRequirements->minApiVersionSupported = XR_MAKE_VERSION(3, 3, 0);
+    graphicsRequirements->maxApiVersionSupported = XR_MAKE_VERSION(4, 6, 0);
+    return XR_SUCCESS;
+}
+
+
+// Paths
+
+XRAPI_ATTR XrResult XRAPI_CALL MockStringToPath(XrInstance instance, const char* pathString, XrPath* path)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (pathString == nullptr || path == nullptr || pathString[0] != '/')
+    {
+        return XR_ERROR_PATH_FORMAT_INVALID;
+    }
+    *path = GetPath(instance, pathString);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockPathToString(XrInstance instance,
+                                                XrPath path,
+                                                uint32_t bufferCapacityInput,
+                                                uint32_t* bufferCountOutput,
+                                                char* buffer)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (path == XR_NULL_PATH || path > instance->paths.size())
+    {
+        return XR_ERROR_PATH_INVALID;
+    }
+    return FillString(bufferCapacityInput, bufferCountOutput, buffer, PathString(instance, path));
+}
+
+
+// Session
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateSession(XrInstance instance, const XrSessionCreateInfo* createInfo, XrSession* session)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (createInfo == nullptr || session == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (createInfo->systemId != 1)
+    {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    if (instance->session != XR_NULL_HANDLE)
+    {
+        return XR_ERROR_LIMIT_REACHED;
+    }
+
+    // Any of the GL bindings is accepted, the mock uses whatever context is current on the calling thread.
+    bool hasBinding = false;
+    for (const XrBaseInStructure* next = static_cast<const XrBaseInStructure*>(createInfo->next); next != nullptr; next = next->next)
+    {
+        hasBinding |= next->type == XR_TYPE_GRAPHICS_BINDING_OPENGL_WIN32_KHR || next->type == XR_TYPE_GRAPHICS_BINDING_OPENGL_XLIB_KHR ||
+                      next->type == XR_TYPE_GRAPHICS_BINDING_OPENGL_XCB_KHR || next->type == XR_TYPE_GRAPHICS_BINDING_EGL_MNDX;
+    }
+    bool headless = !hasBinding && IsExtensionEnabled(instance, XR_MND_HEADLESS_EXTENSION_NAME);
+    if (!hasBinding && !headless)
+    {
+        return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+    }
+
+    XrSession newSession = CreateHandle<XrSession>();
+    newSession->instance = instance;
+    newSession->headless = headless;
+    instance->session = newSession;
+
+    SetSessionState(newSession, XR_SESSION_STATE_IDLE, kStartTime);
+    SetSessionState(newSession, XR_SESSION_STATE_READY, kStartTime);
+
+    *session = newSession;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroySession(XrSession session)
+{
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(session))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    XrInstance instance = session->instance;
+
+    WriteStats(instance);
+    instance->session = XR_NULL_HANDLE;
+    for (XrActionSet actionSet : session->attachedActionSets)
+    {
+        actionSet->attached = false;
+    }
+
+    // Drop queued events of this session.
+    std::deque<XrEventDataBuffer> events;
+    for (const XrEventDataBuffer& event : instance->events)
+    {
+        if (event.type != XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED ||
+            reinterpret_cast<const XrEventDataSessionStateChanged*>(&event)->session != session)
+        {
+            events.push_back(event);
+        }
+    }
+    instance->events = events;
+
+    DestroyHandle(session);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockBeginSession(XrSession session, const XrSessionBeginInfo* beginInfo)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (session->running)
+    {
+        return XR_ERROR_SESSION_RUNNING;
+    }
+    if (session->state != XR_SESSION_STATE_READY)
+    {
+        return XR_ERROR_SESSION_NOT_READY;
+    }
+    if (beginInfo->primaryViewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO)
+    {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+    session->viewConfiguration = beginInfo->primaryViewConfigurationType;
+    session->running = true;
+    session->exitRequested = false;
+    session->realtimeStart = std::chrono::steady_clock::now();
+    session->beginFrameIndx = session->frameIndx;
+    session->firstFrameSinceBegin = true;
+
+    // SYNCHRONIZED on the next xrWaitFrame, VISIBLE and FOCUSED after the first xrEndFrame, also when
+    // the session is begun again after STOPPING.
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEndSession(XrSession session)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (!session->running)
+    {
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+    if (session->state != XR_SESSION_STATE_STOPPING)
+    {
+        return XR_ERROR_SESSION_NOT_STOPPING;
+    }
+    session->running = false;
+    session->frameBegun = false;
+    session->frameWaited = false;
+    SetSessionState(session, XR_SESSION_STATE_IDLE, session->lastPredictedDisplayTime);
+    if (session->exitRequested)
+    {
+        SetSessionState(session, XR_SESSION_STATE_EXITING, session->lastPredictedDisplayTime);
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockRequestExitSession(XrSession session)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (!session->running)
+    {
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+    session->exitRequested = true;
+    XrTime time = session->lastPredictedDisplayTime;
+    if (session->state == XR_SESSION_STATE_FOCUSED)
+    {
+        SetSessionState(session, XR_SESSION_STATE_VISIBLE, time);
+    }
+    if (session->state == XR_SESSION_STATE_VISIBLE)
+    {
+        SetSessionState(session, XR_SESSION_STATE_SYNCHRONIZED, time);
+    }
+    SetSessionState(session, XR_SESSION_STATE_STOPPING, time);
+    return XR_SUCCESS;
+}
+
+
+// Frame loop
+
+XRAPI_ATTR XrResult XRAPI_CALL MockWaitFrame(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState)
+{
+    (void)frameWaitInfo;
+    XrTime predictedDisplayTime = 0;
+    std::chrono::steady_clock::time_point wakeTime;
+    {
+        MOCK_XR_CHECK_SESSION(session);
+        if (!session->running)
+        {
+            return XR_ERROR_SESSION_NOT_RUNNING;
+        }
+        if (frameState == nullptr)
+        {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+
+        // Deterministic timing: frame n is displayed exactly n display periods after the start.
+        session->frameIndx++;
+        session->frameWaited = true;
+        predictedDisplayTime = kStartTime + static_cast<XrTime>(session->frameIndx) * DisplayPeriod();
+        session->lastPredictedDisplayTime = predictedDisplayTime;
+
+        if (session->state == XR_SESSION_STATE_READY)
+        {
+            SetSessionState(session, XR_SESSION_STATE_SYNCHRONIZED, predictedDisplayTime);
+        }
+
+        // Fire the script triggers reached by this frame.
+        XrTime scriptTime = ScriptTime(predictedDisplayTime);
+        std::vector<const MockScript::TriggerKey*> triggers;
+        session->instance->script.CollectTriggers(session->lastTriggerTime, scriptTime, triggers);
+        session->lastTriggerTime = scriptTime;
+        for (const MockScript::TriggerKey* trigger : triggers)
+        {
+            FireScriptTrigger(session, *trigger, predictedDisplayTime);
+        }
+
+        frameState->predictedDisplayTime = predictedDisplayTime;
+        frameState->predictedDisplayPeriod = DisplayPeriod();
+        frameState->shouldRender = session->state == XR_SESSION_STATE_VISIBLE || session->state == XR_SESSION_STATE_FOCUSED;
+
+        // Paced from the last xrBeginSession: display times continue across a re-begun session, the wall clock does not.
+        const uint64_t framesSinceBegin = session->frameIndx - session->beginFrameIndx - 1;
+        wakeTime = session->realtimeStart + std::chrono::nanoseconds(static_cast<XrTime>(framesSinceBegin) * DisplayPeriod());
+    }
+
+    // Throttle outside of the lock so other threads can keep calling into the runtime.
+    if (g_config.realtime)
+    {
+        std::this_thread::sleep_until(wakeTime);
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockBeginFrame(XrSession session, const XrFrameBeginInfo* frameBeginInfo)
+{
+    (void)frameBeginInfo;
+    MOCK_XR_CHECK_SESSION(session);
+    if (!session->running)
+    {
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+    if (!session->frameWaited)
+    {
+        return XR_ERROR_CALL_ORDER_INVALID;
+    }
+    session->frameWaited = false;
+    if (session->frameBegun)
+    {
+        // The previous frame was never ended.
+        return XR_FRAME_DISCARDED;
+    }
+    session->frameBegun = true;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (!session->running)
+    {
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+    if (!session->frameBegun)
+    {
+        return XR_ERROR_CALL_ORDER_INVALID;
+    }
+    if (frameEndInfo == nullptr || frameEndInfo->displayTime <= 0)
+    {
+        return XR_ERROR_TIME_INVALID;
+    }
+    if (frameEndInfo->environmentBlendMode != XR_ENVIRONMENT_BLEND_MODE_OPAQUE)
+    {
+        return XR_ERROR_ENVIRONMENT_BLEND_MODE_UNSUPPORTED;
+    }
+    if (frameEndInfo->layerCount > kMaxLayerCount)
+    {
+        return XR_ERROR_LAYER_LIMIT_EXCEEDED;
+    }
+    for (uint32_t i = 0; i < frameEndInfo->layerCount; i++)
+    {
+        const XrCompositionLayerBaseHeader* layer = frameEndInfo->layers[i];
+        if (layer == nullptr)
+        {
+            return XR_ERROR_LAYER_INVALID;
+        }
+        if (!IsValid(layer->space))
+        {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+    }
+
+    session->frameBegun = false;
+    session->framesEnded++;
+    session->layersSubmitted += frameEndInfo->layerCount;
+
+    const bool firstFrame = session->firstFrameSinceBegin;
+    session->firstFrameSinceBegin = false;
+    if (firstFrame && session->state == XR_SESSION_STATE_SYNCHRONIZED)
+    {
+        SetSessionState(session, XR_SESSION_STATE_VISIBLE, frameEndInfo->displayTime);
+        SetSessionState(session, XR_SESSION_STATE_FOCUSED, frameEndInfo->displayTime);
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockLocateViews(XrSession session,
+                                               const XrViewLocateInfo* viewLocateInfo,
+                                               XrViewState* viewState,
+                                               uint32_t viewCapacityInput,
+                                               uint32_t* viewCountOutput,
+                                               XrView* views)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (viewLocateInfo == nullptr || viewState == nullptr || viewCountOutput == nullptr || !IsValid(viewLocateInfo->space))
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *viewCountOutput = 2;
+    if (viewCapacityInput == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (viewCapacityInput < 2)
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+
+    XrPosef baseInStage;
+    SpaceInStage(viewLocateInfo->space, viewLocateInfo->displayTime, baseInStage);
+    XrPosef headInBase = Compose(Invert(baseInStage), SampleUserPose(session->instance, "/user/head", viewLocateInfo->displayTime));
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        XrPosef eyeInHead = kIdentityPose;
+        eyeInHead.position.x = (i == 0 ? -0.5f : 0.5f) * g_config.ipd;
+        views[i].pose = Compose(headInBase, eyeInHead);
+        views[i].fov = {-g_config.fovHalfAngle, g_config.fovHalfAngle, g_config.fovHalfAngle, -g_config.fovHalfAngle};
+    }
+    viewState->viewStateFlags = XR_VIEW_STATE_ORIENTATION_VALID_BIT | XR_VIEW_STATE_POSITION_VALID_BIT |
+                                XR_VIEW_STATE_ORIENTATION_TRACKED_BIT | XR_VIEW_STATE_POSITION_TRACKED_BIT;
+    return XR_SUCCESS;
+}
+
+
+// Spaces
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateReferenceSpaces(XrSession session,
+                                                            uint32_t spaceCapacityInput,
+                                                            uint32_t* spaceCountOutput,
+                                                            XrReferenceSpaceType* spaces)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    std::vector<XrReferenceSpaceType> types = {XR_REFERENCE_SPACE_TYPE_VIEW, XR_REFERENCE_SPACE_TYPE_LOCAL, XR_REFERENCE_SPACE_TYPE_STAGE};
+    if (IsExtensionEnabled(session->instance, XR_EXT_LOCAL_FLOOR_EXTENSION_NAME))
+    {
+        types.push_back(XR_REFERENCE_SPACE_TYPE_LOCAL_FLOOR_EXT);
+    }
+    return FillArray(spaceCapacityInput, spaceCountOutput, spaces, types);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateReferenceSpace(XrSession session, const XrReferenceSpaceCreateInfo* createInfo, XrSpace* space)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (createInfo == nullptr || space == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    XrReferenceSpaceType type = createInfo->referenceSpaceType;
+    bool supported = type == XR_REFERENCE_SPACE_TYPE_VIEW || type == XR_REFERENCE_SPACE_TYPE_LOCAL || type == XR_REFERENCE_SPACE_TYPE_STAGE ||
+                     (type == XR_REFERENCE_SPACE_TYPE_LOCAL_FLOOR_EXT && IsExtensionEnabled(session->instance, XR_EXT_LOCAL_FLOOR_EXTENSION_NAME));
+    if (!supported)
+    {
+        return XR_ERROR_REFERENCE_SPACE_UNSUPPORTED;
+    }
+    XrSpace newSpace = CreateHandle<XrSpace>();
+    newSpace->session = session;
+    newSpace->referenceSpaceType = type;
+    newSpace->poseInSpace = createInfo->poseInReferenceSpace;
+    *space = newSpace;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetReferenceSpaceBoundsRect(XrSession session, XrReferenceSpaceType referenceSpaceType, XrExtent2Df* bounds)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (referenceSpaceType != XR_REFERENCE_SPACE_TYPE_STAGE)
+    {
+        bounds->width = 0.0f;
+        bounds->height = 0.0f;
+        return XR_SPACE_BOUNDS_UNAVAILABLE;
+    }
+    bounds->width = 3.0f;
+    bounds->height = 3.0f;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateActionSpace(XrSession session, const XrActionSpaceCreateInfo* createInfo, XrSpace* space)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (createInfo == nullptr || space == nullptr || !IsValid(createInfo->action))
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (createInfo->action->type != XR_ACTION_TYPE_POSE_INPUT)
+    {
+        return XR_ERROR_ACTION_TYPE_MISMATCH;
+    }
+    XrSpace newSpace = CreateHandle<XrSpace>();
+    newSpace->session = session;
+    newSpace->action = createInfo->action;
+    newSpace->subactionPath = createInfo->subactionPath;
+    newSpace->poseInSpace = createInfo->poseInActionSpace;
+    *space = newSpace;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockLocateSpace(XrSpace space, XrSpace baseSpace, XrTime time, XrSpaceLocation* location)
+{
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(space) || !IsValid(baseSpace))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (location == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (time <= 0)
+    {
+        return XR_ERROR_TIME_INVALID;
+    }
+
+    XrPosef spaceInStage;
+    XrPosef baseInStage;
+    if (!SpaceInStage(space, time, spaceInStage) || !SpaceInStage(baseSpace, time, baseInStage))
+    {
+        location->locationFlags = 0;
+        return XR_SUCCESS;
+    }
+    location->pose = Compose(Invert(baseInStage), spaceInStage);
+    location->locationFlags = XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT |
+                              XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT | XR_SPACE_LOCATION_POSITION_TRACKED_BIT;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroySpace(XrSpace space)
+{
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(space))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    DestroyHandle(space);
+    return XR_SUCCESS;
+}
+
+
+// Swapchains
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateSwapchainFormats(XrSession session,
+                                                             uint32_t formatCapacityInput,
+                                                             uint32_t* formatCountOutput,
+                                                             int64_t* formats)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    return FillArray(formatCapacityInput, formatCountOutput, formats,
+                     std::vector<int64_t>{GL_SRGB8_ALPHA8, GL_RGBA8, GL_RGBA16F, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT32F});
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateSwapchain(XrSession session, const XrSwapchainCreateInfo* createInfo, XrSwapchain* swapchain)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (createInfo == nullptr || swapchain == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (session->headless)
+    {
+        return XR_ERROR_FEATURE_UNSUPPORTED;
+    }
+    if (createInfo->width == 0 || createInfo->height == 0 || createInfo->width > 4096 || createInfo->height > 4096 ||
+        createInfo->arraySize == 0 || createInfo->mipCount == 0 || (createInfo->faceCount != 1 && createInfo->faceCount != 6))
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    std::vector<int64_t> formats = {GL_SRGB8_ALPHA8, GL_RGBA8, GL_RGBA16F, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT32F};
+    if (std::find(formats.begin(), formats.end(), createInfo->format) == formats.end())
+    {
+        return XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED;
+    }
+
+    XrSwapchain newSwapchain = CreateHandle<XrSwapchain>();
+    newSwapchain->session = session;
+    newSwapchain->createInfo = *createInfo;
+    newSwapchain->createInfo.next = nullptr;
+    CreateSwapchainImages(newSwapchain);
+    *swapchain = newSwapchain;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroySwapchain(XrSwapchain swapchain)
+{
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(swapchain))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    DestroySwapchainImages(swapchain);
+    DestroyHandle(swapchain);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateSwapchainImages(XrSwapchain swapchain,
+                                                            uint32_t imageCapacityInput,
+                                                            uint32_t* imageCountOutput,
+                                                            XrSwapchainImageBaseHeader* images)
+{
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(swapchain))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (imageCountOutput == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *imageCountOutput = static_cast<uint32_t>(swapchain->images.size());
+    if (imageCapacityInput == 0)
+    {
+        return XR_SUCCESS;
+    }
+    if (imageCapacityInput < swapchain->images.size())
+    {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+    if (images[0].type != XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_KHR)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    XrSwapchainImageOpenGLKHR* glImages = reinterpret_cast<XrSwapchainImageOpenGLKHR*>(images);
+    for (size_t i = 0; i < swapchain->images.size(); i++)
+    {
+        glImages[i].image = swapchain->images[i];
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockAcquireSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageAcquireInfo* acquireInfo, uint32_t* index)
+{
+    (void)acquireInfo;
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(swapchain))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (index == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (swapchain->acquired.size() >= swapchain->images.size() || swapchain->staticImageReleased)
+    {
+        return XR_ERROR_CALL_ORDER_INVALID;
+    }
+    *index = swapchain->nextImage;
+    swapchain->acquired.push_back(swapchain->nextImage);
+    swapchain->nextImage = (swapchain->nextImage + 1) % static_cast<uint32_t>(swapchain->images.size());
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo)
+{
+    (void)waitInfo;
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(swapchain))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (swapchain->acquired.empty() || swapchain->waited)
+    {
+        return XR_ERROR_CALL_ORDER_INVALID;
+    }
+    // The mock compositor never holds images, the wait completes immediately.
+    swapchain->waited = true;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockReleaseSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageReleaseInfo* releaseInfo)
+{
+    (void)releaseInfo;
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(swapchain))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (swapchain->acquired.empty() || !swapchain->waited)
+    {
+        return XR_ERROR_CALL_ORDER_INVALID;
+    }
+    swapchain->acquired.pop_front();
+    swapchain->waited = false;
+    if (swapchain->createInfo.createFlags & XR_SWAPCHAIN_CREATE_STATIC_IMAGE_BIT)
+    {
+        swapchain->staticImageReleased = true;
+    }
+    return XR_SUCCESS;
+}
+
+
+// Actions
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateActionSet(XrInstance instance, const XrActionSetCreateInfo* createInfo, XrActionSet* actionSet)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (createInfo == nullptr || actionSet == nullptr || createInfo->actionSetName[0] == '\0')
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    XrActionSet newActionSet = CreateHandle<XrActionSet>();
+    newActionSet->instance = instance;
+    newActionSet->name = createInfo->actionSetName;
+    newActionSet->priority = createInfo->priority;
+    *actionSet = newActionSet;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroyActionSet(XrActionSet actionSet)
+{
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(actionSet))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    for (XrAction action : actionSet->actions)
+    {
+        if (IsValid(action))
+        {
+            DestroyHandle(action);
+        }
+    }
+    DestroyHandle(actionSet);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateAction(XrActionSet actionSet, const XrActionCreateInfo* createInfo, XrAction* action)
+{
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(actionSet))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (actionSet->attached)
+    {
+        return XR_ERROR_ACTIONSETS_ALREADY_ATTACHED;
+    }
+    if (createInfo == nullptr || action == nullptr || createInfo->actionName[0] == '\0')
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    for (XrAction existing : actionSet->actions)
+    {
+        if (existing->name == createInfo->actionName)
+        {
+            return XR_ERROR_NAME_DUPLICATED;
+        }
+    }
+    XrAction newAction = CreateHandle<XrAction>();
+    newAction->actionSet = actionSet;
+    newAction->name = createInfo->actionName;
+    newAction->type = createInfo->actionType;
+    newAction->subactionPaths.assign(createInfo->subactionPaths, createInfo->subactionPaths + createInfo->countSubactionPaths);
+    actionSet->actions.push_back(newAction);
+    *action = newAction;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroyAction(XrAction action)
+{
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(action))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    std::vector<XrAction>& actions = action->actionSet->actions;
+    actions.erase(std::remove(actions.begin(), actions.end(), action), actions.end());
+    DestroyHandle(action);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockSuggestInteractionProfileBindings(XrInstance instance, const XrInteractionProfileSuggestedBinding* suggestedBindings)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (suggestedBindings == nullptr || suggestedBindings->countSuggestedBindings == 0)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    const std::string& profile = PathString(instance, suggestedBindings->interactionProfile);
+    if (!StartsWith(profile, "/interaction_profiles/"))
+    {
+        return XR_ERROR_PATH_UNSUPPORTED;
+    }
+    for (uint32_t i = 0; i < suggestedBindings->countSuggestedBindings; i++)
+    {
+        const XrActionSuggestedBinding& binding = suggestedBindings->suggestedBindings[i];
+        if (!IsValid(binding.action))
+        {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (binding.action->actionSet->attached)
+        {
+            return XR_ERROR_ACTIONSETS_ALREADY_ATTACHED;
+        }
+    }
+    // A new suggestion for a profile replaces the previous one.
+    for (uint32_t i = 0; i < suggestedBindings->countSuggestedBindings; i++)
+    {
+        suggestedBindings->suggestedBindings[i].action->bindings[suggestedBindings->interactionProfile].clear();
+    }
+    for (uint32_t i = 0; i < suggestedBindings->countSuggestedBindings; i++)
+    {
+        const XrActionSuggestedBinding& binding = suggestedBindings->suggestedBindings[i];
+        binding.action->bindings[suggestedBindings->interactionProfile].push_back(binding.binding);
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockAttachSessionActionSets(XrSession session, const XrSessionActionSetsAttachInfo* attachInfo)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (!session->attachedActionSets.empty())
+    {
+        return XR_ERROR_ACTIONSETS_ALREADY_ATTACHED;
+    }
+    if (attachInfo == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    for (uint32_t i = 0; i < attachInfo->countActionSets; i++)
+    {
+        XrActionSet actionSet = attachInfo->actionSets[i];
+        if (!IsValid(actionSet))
+        {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        actionSet->attached = true;
+        session->attachedActionSets.push_back(actionSet);
+    }
+
+    // The emulated controllers are Oculus Touch, falling back to the simple controller or the first suggested profile.
+    XrInstance instance = session->instance;
+    XrPath preferred[] = {GetPath(instance, "/interaction_profiles/oculus/touch_controller"),
+                          GetPath(instance, "/interaction_profiles/khr/simple_controller")};
+    session->currentProfile = XR_NULL_PATH;
+    for (XrPath profile : preferred)
+    {
+        for (XrActionSet actionSet : session->attachedActionSets)
+        {
+            for (XrAction action : actionSet->actions)
+            {
+                if (session->currentProfile == XR_NULL_PATH && action->bindings.count(profile))
+                {
+                    session->currentProfile = profile;
+                }
+            }
+        }
+    }
+    for (XrActionSet actionSet : session->attachedActionSets)
+    {
+        for (XrAction action : actionSet->actions)
+        {
+            if (session->currentProfile == XR_NULL_PATH && !action->bindings.empty())
+            {
+                session->currentProfile = action->bindings.begin()->first;
+            }
+        }
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetCurrentInteractionProfile(XrSession session, XrPath topLevelUserPath, XrInteractionProfileState* interactionProfile)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (session->attachedActionSets.empty())
+    {
+        return XR_ERROR_ACTIONSET_NOT_ATTACHED;
+    }
+    const std::string& userPath = PathString(session->instance, topLevelUserPath);
+    if (userPath != "/user/hand/left" && userPath != "/user/hand/right" && userPath != "/user/head")
+    {
+        return XR_ERROR_PATH_UNSUPPORTED;
+    }
+    interactionProfile->interactionProfile = userPath == "/user/head" ? XR_NULL_PATH : session->currentProfile;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockSyncActions(XrSession session, const XrActionsSyncInfo* syncInfo)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (syncInfo == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    for (uint32_t i = 0; i < syncInfo->countActiveActionSets; i++)
+    {
+        XrActionSet actionSet = syncInfo->activeActionSets[i].actionSet;
+        if (!IsValid(actionSet))
+        {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!actionSet->attached)
+        {
+            return XR_ERROR_ACTIONSET_NOT_ATTACHED;
+        }
+    }
+    if (session->state != XR_SESSION_STATE_FOCUSED)
+    {
+        session->inputs.clear();
+        return XR_SESSION_NOT_FOCUSED;
+    }
+
+    // Inputs are sampled at the last predicted display time so replays are independent of wall clock time.
+    session->lastSyncTime = session->lastPredictedDisplayTime;
+    session->inputs.clear();
+    XrTime scriptTime = ScriptTime(session->lastSyncTime);
+    for (const auto& [path, keys] : session->instance->script.m_inputs)
+    {
+        (void)keys;
+        session->inputs[path] = session->instance->script.SampleInput(path, scriptTime);
+    }
+    return XR_SUCCESS;
+}
+
+namespace
+{
+// Combines all the bound inputs of an action for a subaction path: largest magnitude for floats, OR for booleans.
+bool ReadActionValue(XrSession session, XrAction action, XrPath subactionPath, float& value)
+{
+    auto it = action->bindings.find(session->currentProfile);
+    if (it == action->bindings.end() || !action->actionSet->attached)
+    {
+        return false;
+    }
+    const std::string& subaction = PathString(session->instance, subactionPath);
+    bool active = false;
+    value = 0.0f;
+    for (XrPath binding : it->second)
+    {
+        const std::string& bindingPath = PathString(session->instance, binding);
+        if (subactionPath != XR_NULL_PATH && !StartsWith(bindingPath, subaction))
+        {
+            continue;
+        }
+        active = true;
+        auto input = session->inputs.find(bindingPath);
+        float inputValue = input == session->inputs.end() ? 0.0f : input->second;
+        if (std::fabs(inputValue) > std::fabs(value))
+        {
+            value = inputValue;
+        }
+    }
+    return active;
+}
+
+template <typename State>
+XrResult GetActionState(XrSession session, const XrActionStateGetInfo* getInfo, XrActionType type, State* state, float& value)
+{
+    if (!IsValid(getInfo->action))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    XrAction action = getInfo->action;
+    if (action->type != type)
+    {
+        return XR_ERROR_ACTION_TYPE_MISMATCH;
+    }
+    if (!action->actionSet->attached)
+    {
+        return XR_ERROR_ACTIONSET_NOT_ATTACHED;
+    }
+    if (getInfo->subactionPath != XR_NULL_PATH &&
+        std::find(action->subactionPaths.begin(), action->subactionPaths.end(), getInfo->subactionPath) == action->subactionPaths.end())
+    {
+        return XR_ERROR_PATH_UNSUPPORTED;
+    }
+
+    bool active = ReadActionValue(session, action, getInfo->subactionPath, value) && session->state == XR_SESSION_STATE_FOCUSED;
+    float& lastValue = action->lastValues[getInfo->subactionPath];
+    XrTime& lastChangeTime = action->lastChangeTimes[getInfo->subactionPath];
+    bool changed = active && value != lastValue;
+    if (changed)
+    {
+        lastChangeTime = session->lastSyncTime;
+    }
+    lastValue = value;
+
+    state->isActive = active ? XR_TRUE : XR_FALSE;
+    state->changedSinceLastSync = changed ? XR_TRUE : XR_FALSE;
+    state->lastChangeTime = lastChangeTime;
+    return XR_SUCCESS;
+}
+}  // namespace
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetActionStateBoolean(XrSession session, const XrActionStateGetInfo* getInfo, XrActionStateBoolean* state)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    float value = 0.0f;
+    XrResult result = GetActionState(session, getInfo, XR_ACTION_TYPE_BOOLEAN_INPUT, state, value);
+    state->currentState = value != 0.0f ? XR_TRUE : XR_FALSE;
+    return result;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetActionStateFloat(XrSession session, const XrActionStateGetInfo* getInfo, XrActionStateFloat* state)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    float value = 0.0f;
+    XrResult result = GetActionState(session, getInfo, XR_ACTION_TYPE_FLOAT_INPUT, state, value);
+    state->currentState = value;
+    return result;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetActionStateVector2f(XrSession session, const XrActionStateGetInfo* getInfo, XrActionStateVector2f* state)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (!IsValid(getInfo->action))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (getInfo->action->type != XR_ACTION_TYPE_VECTOR2F_INPUT)
+    {
+        return XR_ERROR_ACTION_TYPE_MISMATCH;
+    }
+    // Vector inputs are scripted as their /x and /y components.
+    state->currentState = {0.0f, 0.0f};
+    state->isActive = XR_FALSE;
+    state->changedSinceLastSync = XR_FALSE;
+    state->lastChangeTime = 0;
+    auto it = getInfo->action->bindings.find(session->currentProfile);
+    if (it != getInfo->action->bindings.end() && session->state == XR_SESSION_STATE_FOCUSED)
+    {
+        for (XrPath binding : it->second)
+        {
+            const std::string& bindingPath = PathString(session->instance, binding);
+            auto x = session->inputs.find(bindingPath + "/x");
+            auto y = session->inputs.find(bindingPath + "/y");
+            state->isActive = XR_TRUE;
+            state->currentState.x = x == session->inputs.end() ? 0.0f : x->second;
+            state->currentState.y = y == session->inputs.end() ? 0.0f : y->second;
+        }
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetActionStatePose(XrSession session, const XrActionStateGetInfo* getInfo, XrActionStatePose* state)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (!IsValid(getInfo->action))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (getInfo->action->type != XR_ACTION_TYPE_POSE_INPUT)
+    {
+        return XR_ERROR_ACTION_TYPE_MISMATCH;
+    }
+    float value = 0.0f;
+    state->isActive = ReadActionValue(session, getInfo->action, getInfo->subactionPath, value) ? XR_TRUE : XR_FALSE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateBoundSourcesForAction(XrSession session,
+                                                                  const XrBoundSourcesForActionEnumerateInfo* enumerateInfo,
+                                                                  uint32_t sourceCapacityInput,
+                                                                  uint32_t* sourceCountOutput,
+                                                                  XrPath* sources)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (enumerateInfo == nullptr || !IsValid(enumerateInfo->action))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    std::vector<XrPath> bound;
+    auto it = enumerateInfo->action->bindings.find(session->currentProfile);
+    if (it != enumerateInfo->action->bindings.end())
+    {
+        bound = it->second;
+    }
+    return FillArray(sourceCapacityInput, sourceCountOutput, sources, bound);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetInputSourceLocalizedName(XrSession session,
+                                                               const XrInputSourceLocalizedNameGetInfo* getInfo,
+                                                               uint32_t bufferCapacityInput,
+                                                               uint32_t* bufferCountOutput,
+                                                               char* buffer)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (getInfo == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    return FillString(bufferCapacityInput, bufferCountOutput, buffer, PathString(session->instance, getInfo->sourcePath));
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockApplyHapticFeedback(XrSession session, const XrHapticActionInfo* hapticActionInfo, const XrHapticBaseHeader* hapticFeedback)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (hapticActionInfo == nullptr || hapticFeedback == nullptr || !IsValid(hapticActionInfo->action))
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (hapticActionInfo->action->type != XR_ACTION_TYPE_VIBRATION_OUTPUT)
+    {
+        return XR_ERROR_ACTION_TYPE_MISMATCH;
+    }
+    if (session->state != XR_SESSION_STATE_FOCUSED)
+    {
+        return XR_SESSION_NOT_FOCUSED;
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockStopHapticFeedback(XrSession session, const XrHapticActionInfo* hapticActionInfo)
+{
+    MOCK_XR_CHECK_SESSION(session);
+    if (hapticActionInfo == nullptr || !IsValid(hapticActionInfo->action))
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    return XR_SUCCESS;
+}
+
+
+// XR_EXT_debug_utils
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateDebugUtilsMessengerEXT(XrInstance instance,
+                                                                const XrDebugUtilsMessengerCreateInfoEXT* createInfo,
+                                                                XrDebugUtilsMessengerEXT* messenger)
+{
+    MOCK_XR_CHECK_INSTANCE(instance);
+    if (!IsExtensionEnabled(instance, XR_EXT_DEBUG_UTILS_EXTENSION_NAME))
+    {
+        return XR_ERROR_FUNCTION_UNSUPPORTED;
+    }
+    if (createInfo == nullptr || messenger == nullptr || createInfo->userCallback == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    XrDebugUtilsMessengerEXT newMessenger = CreateHandle<XrDebugUtilsMessengerEXT>();
+    newMessenger->instance = instance;
+    newMessenger->createInfo = *createInfo;
+    newMessenger->createInfo.next = nullptr;
+    instance->messengers.push_back(newMessenger);
+    *messenger = newMessenger;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroyDebugUtilsMessengerEXT(XrDebugUtilsMessengerEXT messenger)
+{
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (!IsValid(messenger))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    std::vector<XrDebugUtilsMessengerEXT>& messengers = messenger->instance->messengers;
+    messengers.erase(std::remove(messengers.begin(), messengers.end(), messenger), messengers.end());
+    DestroyHandle(messenger);
+    return XR_SUCCESS;
+}
+
+
+// Dispatch
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
+
+namespace
+{
+struct MockFunction
+{
+    const char* name;
+    PFN_xrVoidFunction function;
+    const char* extension;          // Extension that has to be enabled, nullptr for core
+};
+
+#define MOCK_XR_FUNCTION(name, extension) {"xr" #name, reinterpret_cast<PFN_xrVoidFunction>(Mock##name), extension}
+
+const MockFunction kFunctions[] = {
+    MOCK_XR_FUNCTION(GetInstanceProcAddr, nullptr),
+    MOCK_XR_FUNCTION(EnumerateApiLayerProperties, nullptr),
+    MOCK_XR_FUNCTION(EnumerateInstanceExtensionProperties, nullptr),
+    MOCK_XR_FUNCTION(CreateInstance, nullptr),
+    MOCK_XR_FUNCTION(DestroyInstance, nullptr),
+    MOCK_XR_FUNCTION(GetInstanceProperties, nullptr),
+    MOCK_XR_FUNCTION(PollEvent, nullptr),
+    MOCK_XR_FUNCTION(ResultToString, nullptr),
+    MOCK_XR_FUNCTION(StructureTypeToString, nullptr),
+    MOCK_XR_FUNCTION(GetSystem, nullptr),
+    MOCK_XR_FUNCTION(GetSystemProperties, nullptr),
+    MOCK_XR_FUNCTION(EnumerateEnvironmentBlendModes, nullptr),
+    MOCK_XR_FUNCTION(CreateSession, nullptr),
+    MOCK_XR_FUNCTION(DestroySession, nullptr),
+    MOCK_XR_FUNCTION(EnumerateReferenceSpaces, nullptr),
+    MOCK_XR_FUNCTION(CreateReferenceSpace, nullptr),
+    MOCK_XR_FUNCTION(GetReferenceSpaceBoundsRect, nullptr),
+    MOCK_XR_FUNCTION(CreateActionSpace, nullptr),
+    MOCK_XR_FUNCTION(LocateSpace, nullptr),
+    MOCK_XR_FUNCTION(DestroySpace, nullptr),
+    MOCK_XR_FUNCTION(EnumerateViewConfigurations, nullptr),
+    MOCK_XR_FUNCTION(GetViewConfigurationProperties, nullptr),
+    MOCK_XR_FUNCTION(EnumerateViewConfigurationViews, nullptr),
+    MOCK_XR_FUNCTION(EnumerateSwapchainFormats, nullptr),
+    MOCK_XR_FUNCTION(CreateSwapchain, nullptr),
+    MOCK_XR_FUNCTION(DestroySwapchain, nullptr),
+    MOCK_XR_FUNCTION(EnumerateSwapchainImages, nullptr),
+    MOCK_XR_FUNCTION(AcquireSwapchainImage, nullptr),
+    MOCK_XR_FUNCTION(WaitSwapchainImage, nullptr),
+    MOCK_XR_FUNCTION(ReleaseSwapchainImage, nullptr),
+    MOCK_XR_FUNCTION(BeginSession, nullptr),
+    MOCK_XR_FUNCTION(EndSession, nullptr),
+    MOCK_XR_FUNCTION(RequestExitSession, nullptr),
+    MOCK_XR_FUNCTION(WaitFrame, nullptr),
+    MOCK_XR_FUNCTION(BeginFrame, nullptr),
+    MOCK_XR_FUNCTION(EndFrame, nullptr),
+    MOCK_XR_FUNCTION(LocateViews, nullptr),
+    MOCK_XR_FUNCTION(StringToPath, nullptr),
+    MOCK_XR_FUNCTION(PathToString, nullptr),
+    MOCK_XR_FUNCTION(CreateActionSet, nullptr),
+    MOCK_XR_FUNCTION(DestroyActionSet, nullptr),
+    MOCK_XR_FUNCTION(CreateAction, nullptr),
+    MOCK_XR_FUNCTION(DestroyAction, nullptr),
+    MOCK_XR_FUNCTION(SuggestInteractionProfileBindings, nullptr),
+    MOCK_XR_FUNCTION(AttachSessionActionSets, nullptr),
+    MOCK_XR_FUNCTION(GetCurrentInteractionProfile, nullptr),
+    MOCK_XR_FUNCTION(GetActionStateBoolean, nullptr),
+    MOCK_XR_FUNCTION(GetActionStateFloat, nullptr),
+    MOCK_XR_FUNCTION(GetActionStateVector2f, nullptr),
+    MOCK_XR_FUNCTION(GetActionStatePose, nullptr),
+    MOCK_XR_FUNCTION(SyncActions, nullptr),
+    MOCK_XR_FUNCTION(EnumerateBoundSourcesForAction, nullptr),
+    MOCK_XR_FUNCTION(GetInputSourceLocalizedName, nullptr),
+    MOCK_XR_FUNCTION(ApplyHapticFeedback, nullptr),
+    MOCK_XR_FUNCTION(StopHapticFeedback, nullptr),
+    MOCK_XR_FUNCTION(GetOpenGLGraphicsRequirementsKHR, XR_KHR_OPENGL_ENABLE_EXTENSION_NAME),
+    MOCK_XR_FUNCTION(CreateDebugUtilsMessengerEXT, XR_EXT_DEBUG_UTILS_EXTENSION_NAME),
+    MOCK_XR_FUNCTION(DestroyDebugUtilsMessengerEXT, XR_EXT_DEBUG_UTILS_EXTENSION_NAME),
+};
+}  // namespace
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function)
+{
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
+    if (name == nullptr || function == nullptr)
+    {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *function = nullptr;
+
+    // Without an instance only the functions needed to create one are available.
+    if (instance == XR_NULL_HANDLE)
+    {
+        if (strcmp(name, "xrEnumerateInstanceExtensionProperties") != 0 && strcmp(name, "xrEnumerateApiLayerProperties") != 0 &&
+            strcmp(name, "xrCreateInstance") != 0)
+        {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+    }
+    else if (!IsValid(instance))
+    {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+
+    for (const MockFunction& entry : kFunctions)
+    {
+        if (strcmp(entry.name, name) == 0)
+        {
+            if (entry.extension != nullptr && (instance == XR_NULL_HANDLE || !IsExtensionEnabled(instance, entry.extension)))
+            {
+                return XR_ERROR_FUNCTION_UNSUPPORTED;
+            }
+            *function = entry.function;
+            return XR_SUCCESS;
+        }
+    }
+    return XR_ERROR_FUNCTION_UNSUPPORTED;
+}
+
+MOCK_XR_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrNegotiateLoaderRuntimeInterface(const XrNegotiateLoaderInfo* loaderInfo,
+                                                                               XrNegotiateRuntimeRequest* runtimeRequest)
+{
+    if (loaderInfo == nullptr || runtimeRequest == nullptr || loaderInfo->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
+        loaderInfo->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loaderInfo->structSize != sizeof(XrNegotiateLoaderInfo) ||
+        runtimeRequest->structType != XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST ||
+        runtimeRequest->structVersion != XR_RUNTIME_INFO_STRUCT_VERSION || runtimeRequest->structSize != sizeof(XrNegotiateRuntimeRequest))
+    {
+        return XR_ERROR_INITIALIZATION_FAILED;
+    }
+    if (loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_RUNTIME_VERSION ||
+        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_RUNTIME_VERSION ||
+        XR_VERSION_MAJOR(loaderInfo->maxApiVersion) < 1 || XR_VERSION_MAJOR(loaderInfo->minApiVersion) > 1)
+    {
+        return XR_ERROR_INITIALIZATION_FAILED;
+    }
+
+    runtimeRequest->runtimeInterfaceVersion = XR_CURRENT_LOADER_RUNTIME_VERSION;
+    runtimeRequest->runtimeApiVersion = XR_CURRENT_API_VERSION;
+    runtimeRequest->getInstanceProcAddr = MockGetInstanceProcAddr;
+    return XR_SUCCESS;
+}
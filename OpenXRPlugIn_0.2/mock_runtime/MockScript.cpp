@@ -0,0 +1,212 @@
+#include "MockScript.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+
+namespace
+{
+constexpr XrTime kNanosecondsPerMillisecond = 1000000;
+
+XrPosef MakePose(float px, float py, float pz, float qx, float qy, float qz, float qw)
+{
+    XrPosef pose;
+    pose.position = {px, py, pz};
+    pose.orientation = {qx, qy, qz, qw};
+    return pose;
+}
+
+XrPosef LerpPose(const XrPosef& a, const XrPosef& b, float t)
+{
+    XrPosef result;
+    result.position.x = a.position.x + (b.position.x - a.position.x) * t;
+    result.position.y = a.position.y + (b.position.y - a.position.y) * t;
+    result.position.z = a.position.z + (b.position.z - a.position.z) * t;
+
+    // Take the shortest path between the two orientations.
+    float dot = a.orientation.x * b.orientation.x + a.orientation.y * b.orientation.y + a.orientation.z * b.orientation.z +
+                a.orientation.w * b.orientation.w;
+    float sign = dot < 0.0f ? -1.0f : 1.0f;
+    XrQuaternionf q;
+    q.x = a.orientation.x + (sign * b.orientation.x - a.orientation.x) * t;
+    q.y = a.orientation.y + (sign * b.orientation.y - a.orientation.y) * t;
+    q.z = a.orientation.z + (sign * b.orientation.z - a.orientation.z) * t;
+    q.w = a.orientation.w + (sign * b.orientation.w - a.orientation.w) * t;
+    float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    if (length > 0.0f)
+    {
+        q.x /= length;
+        q.y /= length;
+        q.z /= length;
+        q.w /= length;
+    }
+    result.orientation = q;
+    return result;
+}
+}  // namespace
+
+
+void MockScript::SetDefaults()
+{
+    // Standing user at the stage origin holding both controllers in front of them.
+    m_poses["/user/head"] = {{0, MakePose(0.0f, 1.6f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f)}};
+    m_poses["/user/hand/left"] = {{0, MakePose(-0.2f, 1.2f, -0.3f, 0.0f, 0.0f, 0.0f, 1.0f)}};
+    m_poses["/user/hand/right"] = {{0, MakePose(0.2f, 1.2f, -0.3f, 0.0f, 0.0f, 0.0f, 1.0f)}};
+}
+
+bool MockScript::Load(const std::string& filepath)
+{
+    std::ifstream stream(filepath);
+    if (!stream.is_open())
+    {
+        std::cerr << "MOCK XR: Could not read script " << filepath << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(stream, line))
+    {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.resize(comment);
+        }
+
+        std::istringstream tokens(line);
+        double timeMs = 0.0;
+        std::string command;
+        if (!(tokens >> timeMs >> command))
+        {
+            continue;
+        }
+        XrTime time = static_cast<XrTime>(timeMs * kNanosecondsPerMillisecond);
+
+        if (command == "pose")
+        {
+            std::string path;
+            float p[7] = {};
+            if (!(tokens >> path >> p[0] >> p[1] >> p[2] >> p[3] >> p[4] >> p[5] >> p[6]))
+            {
+                std::cerr << "MOCK XR: " << filepath << ":" << lineNumber << " pose expects a path, a position and a quaternion" << std::endl;
+                continue;
+            }
+            m_poses[path].push_back({time, MakePose(p[0], p[1], p[2], p[3], p[4], p[5], p[6])});
+        }
+        else if (command == "float" || command == "bool")
+        {
+            std::string path;
+            float value = 0.0f;
+            if (!(tokens >> path >> value))
+            {
+                std::cerr << "MOCK XR: " << filepath << ":" << lineNumber << " " << command << " expects a path and a value" << std::endl;
+                continue;
+            }
+            m_inputs[path].push_back({time, value});
+        }
+        else if (command == "state" || command == "event")
+        {
+            TriggerKey trigger;
+            trigger.time = time;
+            trigger.command = command;
+            tokens >> trigger.name;
+            float arg = 0.0f;
+            while (tokens >> arg)
+            {
+                trigger.args.push_back(arg);
+            }
+            m_triggers.push_back(trigger);
+        }
+        else if (command == "loop")
+        {
+            m_loopLength = time;
+        }
+        else
+        {
+            std::cerr << "MOCK XR: " << filepath << ":" << lineNumber << " unknown command " << command << std::endl;
+        }
+    }
+
+    // Keys may be written in any order.
+    for (auto& [path, keys] : m_poses)
+    {
+        std::stable_sort(keys.begin(), keys.end(), [](const PoseKey& a, const PoseKey& b) { return a.time < b.time; });
+    }
+    for (auto& [path, keys] : m_inputs)
+    {
+        std::stable_sort(keys.begin(), keys.end(), [](const InputKey& a, const InputKey& b) { return a.time < b.time; });
+    }
+    std::stable_sort(m_triggers.begin(), m_triggers.end(), [](const TriggerKey& a, const TriggerKey& b) { return a.time < b.time; });
+    return true;
+}
+
+XrTime MockScript::WrapTime(XrTime time) const
+{
+    if (m_loopLength > 0 && time >= 0)
+    {
+        return time % m_loopLength;
+    }
+    return time;
+}
+
+bool MockScript::SamplePose(const std::string& userPath, XrTime time, XrPosef& pose) const
+{
+    auto it = m_poses.find(userPath);
+    if (it == m_poses.end() || it->second.empty())
+    {
+        return false;
+    }
+
+    const std::vector<PoseKey>& keys = it->second;
+    time = WrapTime(time);
+    if (time <= keys.front().time)
+    {
+        pose = keys.front().pose;
+        return true;
+    }
+    if (time >= keys.back().time)
+    {
+        pose = keys.back().pose;
+        return true;
+    }
+
+    auto next = std::upper_bound(keys.begin(), keys.end(), time, [](XrTime t, const PoseKey& key) { return t < key.time; });
+    auto prev = next - 1;
+    float t = static_cast<float>(time - prev->time) / static_cast<float>(next->time - prev->time);
+    pose = LerpPose(prev->pose, next->pose, t);
+    return true;
+}
+
+float MockScript::SampleInput(const std::string& inputPath, XrTime time) const
+{
+    auto it = m_inputs.find(inputPath);
+    if (it == m_inputs.end() || it->second.empty())
+    {
+        return 0.0f;
+    }
+
+    const std::vector<InputKey>& keys = it->second;
+    time = WrapTime(time);
+    auto next = std::upper_bound(keys.begin(), keys.end(), time, [](XrTime t, const InputKey& key) { return t < key.time; });
+    if (next == keys.begin())
+    {
+        return 0.0f;
+    }
+    return (next - 1)->value;
+}
+
+void MockScript::CollectTriggers(XrTime fromTime, XrTime toTime, std::vector<const TriggerKey*>& triggers) const
+{
+    // Triggers are one-shot and are not repeated by a loop.
+    for (const TriggerKey& trigger : m_triggers)
+    {
+        if (trigger.time > fromTime && trigger.time <= toTime)
+        {
+            triggers.push_back(&trigger);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "openxr.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Scripted head, controller and input timeline of the mock runtime.
+// Times are in display time relative to the first predicted display time of the session, so a script
+// plays back identically no matter how fast the application runs. See README.md for the file format.
+class MockScript
+{
+public:
+    struct PoseKey
+    {
+        XrTime time = 0;
+        XrPosef pose = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
+    };
+
+    struct InputKey
+    {
+        XrTime time = 0;
+        float value = 0.0f;
+    };
+
+    // Session state or event fired once when the playback time passes it.
+    struct TriggerKey
+    {
+        XrTime time = 0;
+        std::string command;                // "state" or "event"
+        std::string name;                   // e.g. "visible", "reference_space_change"
+        std::vector<float> args;
+    };
+
+    bool Load(const std::string& filepath);
+    void SetDefaults();
+
+    // Linear position and normalized-lerp orientation between keys, clamped at both ends.
+    bool SamplePose(const std::string& userPath, XrTime time, XrPosef& pose) const;
+    // Inputs hold their last value. Unknown paths read as 0.
+    float SampleInput(const std::string& inputPath, XrTime time) const;
+    // Triggers in (fromTime, toTime].
+    void CollectTriggers(XrTime fromTime, XrTime toTime, std::vector<const TriggerKey*>& triggers) const;
+
+    // Wraps a playback time when the script declared a loop length.
+    XrTime WrapTime(XrTime time) const;
+
+    std::unordered_map<std::string, std::vector<PoseKey>> m_poses;
+    std::unordered_map<std::string, std::vector<InputKey>> m_inputs;
+    std::vector<TriggerKey> m_triggers;
+    XrTime m_loopLength = 0;
+};
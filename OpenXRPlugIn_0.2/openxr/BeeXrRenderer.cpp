@@ -0,0 +1,70 @@
+#include "openxrPlugIn.h"
+#include "BeeXrRenderer.h"
+#include "core/engine.hpp"
+#include "core/transform.hpp"
+#include "DebugOutput.h"
+
+#include "renderXR_gl.h"
+
+
+namespace
+{
+
+// Camera of the XR camera entity, the first camera when none is set.
+bee::Camera* FindCamera(bee::Entity cameraEntity, bool& warned)
+{
+    auto& registry = bee::Engine.ECS().Registry;
+    if (registry.valid(cameraEntity))
+    {
+        if (bee::Camera* camera = registry.try_get<bee::Camera>(cameraEntity))
+        {
+            return camera;
+        }
+    }
+
+    // Without SetCameraEntity() the first camera follows the eyes, as before the camera entity existed.
+    for (const auto& [e, camera] : registry.view<bee::Camera>().each())
+    {
+        if (!warned)
+        {
+            XR_TUT_LOG("No XR camera entity set with SetCameraEntity(), using the first camera.");
+            warned = true;
+        }
+        return &camera;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+
+BeeXrRenderer::BeeXrRenderer(OpenxrPlugIn& plugIn) : m_plugIn(plugIn)
+{}
+
+void BeeXrRenderer::RenderFrame(const XrRenderFrame& frame)
+{
+    bee::RendererXR& rendererxr = bee::Engine.ECS().GetSystem<bee::RendererXR>();
+
+    // RenderFlat() renders from the XR camera. Only its projection is written here; the eye view comes
+    // from GetCurrentViewCamera(), so the ECS transforms and the hierarchy are left alone.
+    bee::Camera* camera = FindCamera(m_plugIn.GetCameraEntity(), m_warnedNoCameraEntity);
+    // A layer below the projection layer (sky box) shows through where the main pass leaves alpha 0, so
+    // RendererXR skips its sky and clears to transparent black instead of spending fill on covered pixels.
+    rendererxr.m_drawSky = !m_plugIn.GetCompositionLayers().HasBackground();
+
+    for (uint32_t i = 0; i < frame.viewCount; i++)
+    {
+        const XrRenderView& renderView = frame.views[i];
+
+        if (camera != nullptr)
+        {
+            camera->Projection = renderView.camera.projection;
+        }
+
+        m_plugIn.eyeIndx = renderView.viewIndx;
+        m_plugIn.ExecuteRenderPasses(XrRenderStage::PerView, frame, &renderView);
+        rendererxr.RenderFlat();
+
+        m_plugIn.BlitToSwapchain(renderView.target, rendererxr.m_finalFramebuffer, rendererxr.m_width, rendererxr.m_height);
+    }
+}
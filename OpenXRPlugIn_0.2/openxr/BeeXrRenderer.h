@@ -0,0 +1,20 @@
+#pragma once
+
+#include "XrRenderer.h"
+
+class OpenxrPlugIn;
+
+
+// Default XrRenderer, drives the Bee RendererXR system one eye at a time and blits its final
+// framebuffer into the acquired swapchain image. The sky is left to a background layer when there is one.
+class BeeXrRenderer : public XrRenderer
+{
+public:
+    explicit BeeXrRenderer(OpenxrPlugIn& plugIn);
+
+    void RenderFrame(const XrRenderFrame& frame) override;
+
+private:
+    OpenxrPlugIn& m_plugIn;
+    bool m_warnedNoCameraEntity = false;
+};
@@ -190,8 +190,9 @@ public:
         __android_log_write(ANDROID_LOG_ERROR, XR_TUT_LOG_TAG, ostr.str().c_str()); \
     }
 #else
-#include <iostream>
+#include "XrLog.h"
 
-#define XR_TUT_LOG(...) std::cout << __VA_ARGS__ << "\n"
-#define XR_TUT_LOG_ERROR(...) std::cerr << __VA_ARGS__ << "\n"
+// Formatted on the calling thread, written by the XrLogger thread (XrLog.h).
+#define XR_TUT_LOG(...) XrLogRecord(XrLogLevel::Info).Stream() << __VA_ARGS__
+#define XR_TUT_LOG_ERROR(...) XrLogRecord(XrLogLevel::Error).Stream() << __VA_ARGS__
 #endif
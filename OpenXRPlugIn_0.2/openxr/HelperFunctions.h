@@ -9,6 +9,7 @@
 
 // C/C++ Headers
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -48,6 +49,7 @@ T Align(T value, T alignment) {
 };
 
 inline std::string GetEnv(const std::string& variable) {
+#if defined(_MSC_VER)
     char* value = nullptr;
     size_t len = 0;
 
@@ -59,6 +61,10 @@ inline std::string GetEnv(const std::string& variable) {
     }
 
     return ""; // Return an empty string if the variable is not found
+#else
+    const char* value = getenv(variable.c_str());
+    return value != nullptr ? std::string(value) : std::string();
+#endif
 };
 
 inline void SetEnv(const std::string &variable, const std::string &value) {
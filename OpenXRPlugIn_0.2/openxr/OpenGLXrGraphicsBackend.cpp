@@ -0,0 +1,293 @@
+#include "openxrPlugIn.h"
+#include "OpenGLXrGraphicsBackend.h"
+
+#include "DebugOutput.h"
+#include "OpenXRDebugUtils.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+OpenGLXrGraphicsBackend::OpenGLXrGraphicsBackend() : m_binding(CreatePlatformGraphicsBinding())
+{}
+
+OpenGLXrGraphicsBackend::~OpenGLXrGraphicsBackend()
+{
+    DestroyUploadBuffer();
+    // The GL context is still current when the plug-in is destroyed with the engine.
+    for (const auto& [image, framebuffer] : m_framebuffers)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+}
+
+const char* OpenGLXrGraphicsBackend::GetName() const
+{
+    return m_binding->GetName();
+}
+
+void OpenGLXrGraphicsBackend::GetRequiredExtensions(std::vector<std::string>& extensions) const
+{
+    extensions.push_back(XR_KHR_OPENGL_ENABLE_EXTENSION_NAME);
+    m_binding->GetRequiredExtensions(extensions);
+}
+
+bool OpenGLXrGraphicsBackend::CreateBinding(XrInstance instance, XrSystemId systemId)
+{
+    m_xrInstance = instance;
+
+    // Query OpenGL graphics requirements
+    PFN_xrGetOpenGLGraphicsRequirementsKHR pfnGetOpenGLGraphicsRequirementsKHR = nullptr;
+    OPENXR_CHECK(xrGetInstanceProcAddr(m_xrInstance,
+                                       "xrGetOpenGLGraphicsRequirementsKHR",
+                                       (PFN_xrVoidFunction*)&pfnGetOpenGLGraphicsRequirementsKHR),
+                 "Failed to get OpenGL graphics requirements function pointer");
+    if (pfnGetOpenGLGraphicsRequirementsKHR == nullptr)
+    {
+        return false;
+    }
+
+    XrGraphicsRequirementsOpenGLKHR graphicsRequirements{XR_TYPE_GRAPHICS_REQUIREMENTS_OPENGL_KHR};
+    OPENXR_CHECK(pfnGetOpenGLGraphicsRequirementsKHR(m_xrInstance, systemId, &graphicsRequirements),
+                 "Failed to get OpenGL graphics requirements");
+
+    // Fill the graphics binding structure of the platform selected at build time from the current GL context
+    if (!m_binding->Create())
+    {
+        XR_TUT_LOG_ERROR("Failed to create the " << m_binding->GetName() << " graphics binding, is a GL context current?");
+        return false;
+    }
+    return true;
+}
+
+const void* OpenGLXrGraphicsBackend::GetSessionBinding() const
+{
+    return m_binding->GetSessionBinding();
+}
+
+int64_t OpenGLXrGraphicsBackend::SelectColorSwapchainFormat(const std::vector<int64_t>& formats) const
+{
+    // The Bee renderer outputs linear color, the sRGB formats let the runtime do the conversion.
+    const int64_t supportedFormats[] = {GL_SRGB8_ALPHA8, GL_RGBA8, GL_RGBA16F};
+    for (int64_t format : formats)
+    {
+        if (std::find(std::begin(supportedFormats), std::end(supportedFormats), format) != std::end(supportedFormats))
+        {
+            return format;
+        }
+    }
+    return 0;
+}
+
+void OpenGLXrGraphicsBackend::EnumerateSwapchainImages(XrSwapchain swapchain, std::vector<uint64_t>& images)
+{
+    uint32_t imageCount = 0;
+    OPENXR_CHECK(xrEnumerateSwapchainImages(swapchain, 0, &imageCount, nullptr), "Failed to enumerate Color Swapchain Images.");
+
+    std::vector<XrSwapchainImageOpenGLKHR> glImages(imageCount, {XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_KHR});
+    OPENXR_CHECK(xrEnumerateSwapchainImages(swapchain,
+                                            imageCount,
+                                            &imageCount,
+                                            reinterpret_cast<XrSwapchainImageBaseHeader*>(glImages.data())),
+                 "Failed to enumerate Color Swapchain Images.");
+
+    images.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++)
+    {
+        images[i] = glImages[i].image;
+    }
+}
+
+uint64_t OpenGLXrGraphicsBackend::GetRenderTarget(const XrRenderTarget& target)
+{
+    auto it = m_framebuffers.find(target.image);
+    if (it != m_framebuffers.end())
+    {
+        return it->second;
+    }
+
+    // One framebuffer per swapchain texture, created once instead of for every blit.
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, static_cast<GLuint>(target.image), 0);
+    GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        XR_TUT_LOG_ERROR("Swapchain image " << target.image << " is not framebuffer complete: " << status);
+        glDeleteFramebuffers(1, &framebuffer);
+        return 0;
+    }
+    m_framebuffers[target.image] = framebuffer;
+    return framebuffer;
+}
+
+void OpenGLXrGraphicsBackend::ReleaseSwapchainImages(const std::vector<uint64_t>& images)
+{
+    for (uint64_t image : images)
+    {
+        auto it = m_framebuffers.find(image);
+        if (it != m_framebuffers.end())
+        {
+            glDeleteFramebuffers(1, &it->second);
+            m_framebuffers.erase(it);
+        }
+    }
+}
+
+void OpenGLXrGraphicsBackend::CopyToRenderTarget(const XrRenderTarget& target, const XrGraphicsImage& source)
+{
+    GLuint swapchainFramebuffer = static_cast<GLuint>(GetRenderTarget(target));
+    if (swapchainFramebuffer == 0)
+    {
+        return;  // Abort blit operation if framebuffer is not complete
+    }
+
+    GLuint sourceFramebuffer = static_cast<GLuint>(source.handle);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, swapchainFramebuffer);
+
+    glBlitFramebuffer(0,
+                      0,
+                      source.width,
+                      source.height,        // Source rectangle
+                      0,
+                      0,                    // Destination rectangle (bottom-left corner)
+                      target.width,
+                      target.height,
+                      GL_COLOR_BUFFER_BIT,  // Buffer to copy
+                      GL_NEAREST            // Sampling filter
+    );
+
+    glBindFramebuffer(GL_FRAMEBUFFER, sourceFramebuffer);
+}
+
+bool OpenGLXrGraphicsBackend::UploadToRenderTarget(const XrRenderTarget& target, const void* pixels, uint32_t rowPitch)
+{
+    const size_t rowBytes = static_cast<size_t>(target.width) * 4;
+    const size_t imageBytes = rowBytes * static_cast<size_t>(target.height);
+    if (imageBytes > m_uploadSlotSize && !CreateUploadBuffer(imageBytes))
+    {
+        return false;
+    }
+
+    if (m_uploadSlots[m_uploadSlot].fence != nullptr)
+    {
+        GLsync fence = static_cast<GLsync>(m_uploadSlots[m_uploadSlot].fence);
+        const GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED && m_uploadSlots.size() < kMaxUploadSlots && InsertUploadSlot(m_uploadSlot))
+        {
+            fence = nullptr;
+        }
+        else if (status == GL_TIMEOUT_EXPIRED)
+        {
+            if (!m_warnedUploadSlots)
+            {
+                XR_TUT_LOG_ERROR("More than " << kMaxUploadSlots << " layer uploads in flight, UploadImage() waits for the GPU.");
+                m_warnedUploadSlots = true;
+            }
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        }
+        if (fence != nullptr)
+        {
+            glDeleteSync(fence);
+            m_uploadSlots[m_uploadSlot].fence = nullptr;
+        }
+    }
+    UploadSlot& slot = m_uploadSlots[m_uploadSlot];
+    m_uploadSlot = (m_uploadSlot + 1) % m_uploadSlots.size();
+
+    const uint8_t* source = static_cast<const uint8_t*>(pixels);
+    if (rowPitch == rowBytes)
+    {
+        std::memcpy(slot.data, source, imageBytes);
+    }
+    else
+    {
+        for (int32_t y = 0; y < target.height; y++)
+        {
+            std::memcpy(slot.data + y * rowBytes, source + static_cast<size_t>(y) * rowPitch, rowBytes);
+        }
+    }
+
+    GLint previousBuffer = 0;
+    GLint previousTexture = 0;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &previousBuffer);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(target.image));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, target.width, target.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    glBindTexture(GL_TEXTURE_2D, previousTexture);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, previousBuffer);
+    return true;
+}
+
+bool OpenGLXrGraphicsBackend::CreateUploadBuffer(size_t slotSize)
+{
+    // Keeps the number of slots the ring grew to, only their size changes.
+    const size_t slotCount = std::max(m_uploadSlots.size(), kInitialUploadSlots);
+    DestroyUploadBuffer();
+
+    m_uploadSlotSize = slotSize;
+    for (size_t i = 0; i < slotCount; i++)
+    {
+        if (!InsertUploadSlot(i))
+        {
+            DestroyUploadBuffer();
+            return false;
+        }
+    }
+    m_uploadSlot = 0;
+    return true;
+}
+
+bool OpenGLXrGraphicsBackend::InsertUploadSlot(size_t index)
+{
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr size = static_cast<GLsizeiptr>(m_uploadSlotSize);
+    UploadSlot slot;
+    GLint previousBuffer = 0;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &previousBuffer);
+    glGenBuffers(1, &slot.buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+    slot.data = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, previousBuffer);
+
+    if (slot.data == nullptr)
+    {
+        XR_TUT_LOG_ERROR("Failed to map the layer upload buffer of " << size << " bytes, GL 4.4 or ARB_buffer_storage is required.");
+        glDeleteBuffers(1, &slot.buffer);
+        return false;
+    }
+    // In front of the busy slot at index, which stays the next one after it, so the ring keeps its order.
+    m_uploadSlots.insert(m_uploadSlots.begin() + static_cast<std::ptrdiff_t>(index), slot);
+    return true;
+}
+
+void OpenGLXrGraphicsBackend::DestroyUploadBuffer()
+{
+    for (UploadSlot& slot : m_uploadSlots)
+    {
+        if (slot.fence != nullptr)
+        {
+            glClientWaitSync(static_cast<GLsync>(slot.fence), GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(static_cast<GLsync>(slot.fence));
+        }
+        // Deleting the buffer also unmaps it.
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    m_uploadSlots.clear();
+    m_uploadSlotSize = 0;
+    m_uploadSlot = 0;
+}
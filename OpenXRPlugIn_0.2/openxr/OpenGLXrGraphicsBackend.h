@@ -0,0 +1,59 @@
+#pragma once
+
+#include "XrGraphicsBackend.h"
+#include "XrGraphicsBinding.h"
+#include <unordered_map>
+#include <vector>
+
+
+// OpenGL through XR_KHR_opengl_enable. The session is bound to the GL context current on the thread
+// calling Init(), through the window system binding selected at build time (XrGraphicsBinding.h).
+class OpenGLXrGraphicsBackend : public XrGraphicsBackend
+{
+public:
+    OpenGLXrGraphicsBackend();
+    ~OpenGLXrGraphicsBackend() override;
+
+    XrGraphicsApi GetApi() const override { return XrGraphicsApi::OpenGL; }
+    const char* GetName() const override;
+
+    void GetRequiredExtensions(std::vector<std::string>& extensions) const override;
+    bool CreateBinding(XrInstance instance, XrSystemId systemId) override;
+    const void* GetSessionBinding() const override;
+
+    int64_t SelectColorSwapchainFormat(const std::vector<int64_t>& formats) const override;
+    void EnumerateSwapchainImages(XrSwapchain swapchain, std::vector<uint64_t>& images) override;
+
+    uint64_t GetRenderTarget(const XrRenderTarget& target) override;
+    void ReleaseSwapchainImages(const std::vector<uint64_t>& images) override;
+    void CopyToRenderTarget(const XrRenderTarget& target, const XrGraphicsImage& source) override;
+    bool UploadToRenderTarget(const XrRenderTarget& target, const void* pixels, uint32_t rowPitch) override;
+
+private:
+    bool CreateUploadBuffer(size_t slotSize);
+    bool InsertUploadSlot(size_t index);
+    void DestroyUploadBuffer();
+
+    XrInstance m_xrInstance = XR_NULL_HANDLE;
+    std::unique_ptr<XrGraphicsBinding> m_binding;
+
+    // Swapchain texture -> framebuffer with it as color attachment.
+    std::unordered_map<uint64_t, uint32_t> m_framebuffers;
+
+    // Ring of pixel unpack buffers, each mapped once (persistent, coherent) and written in turn. The
+    // ring is sized by uploads in flight, not by frames: when the next slot's fence has not signaled
+    // yet (several streamed layers per frame), a slot is inserted in front of it instead of waiting.
+    // Past kMaxUploadSlots uploads in flight the oldest one is waited for.
+    struct UploadSlot
+    {
+        uint32_t buffer = 0;
+        uint8_t* data = nullptr;
+        void* fence = nullptr;  // GLsync
+    };
+    static constexpr size_t kInitialUploadSlots = 3;
+    static constexpr size_t kMaxUploadSlots = 8;
+    std::vector<UploadSlot> m_uploadSlots;
+    size_t m_uploadSlotSize = 0;
+    size_t m_uploadSlot = 0;
+    bool m_warnedUploadSlots = false;
+};
@@ -9,93 +9,33 @@
 
 // XR_DOCS_TAG_BEGIN_OpenXRMessageCallbackFunction
 XrBool32 OpenXRMessageCallbackFunction(XrDebugUtilsMessageSeverityFlagsEXT messageSeverity, XrDebugUtilsMessageTypeFlagsEXT messageType, const XrDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData) {
-    
-    (void)pUserData;
-    // Lambda to covert an XrDebugUtilsMessageSeverityFlagsEXT to std::string. Bitwise check to concatenate multiple severities to the output string.
-    auto GetMessageSeverityString = [](XrDebugUtilsMessageSeverityFlagsEXT messageSeverity) -> std::string {
-        bool separator = false;
-
-        std::string msgFlags;
-        if (BitwiseCheck(messageSeverity, XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)) {
-            msgFlags += "VERBOSE";
-            separator = true;
-        }
-        if (BitwiseCheck(messageSeverity, XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)) {
-            if (separator) {
-                msgFlags += ",";
-            }
-            msgFlags += "INFO";
-            separator = true;
-        }
-        if (BitwiseCheck(messageSeverity, XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)) {
-            if (separator) {
-                msgFlags += ",";
-            }
-            msgFlags += "WARN";
-            separator = true;
-        }
-        if (BitwiseCheck(messageSeverity, XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)) {
-            if (separator) {
-                msgFlags += ",";
-            }
-            msgFlags += "ERROR";
-        }
-        return msgFlags;
-    };
-    // Lambda to covert an XrDebugUtilsMessageTypeFlagsEXT to std::string. Bitwise check to concatenate multiple types to the output string.
-    auto GetMessageTypeString = [](XrDebugUtilsMessageTypeFlagsEXT messageType) -> std::string {
-        bool separator = false;
-
-        std::string msgFlags;
-        if (BitwiseCheck(messageType, XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT)) {
-            msgFlags += "GEN";
-            separator = true;
-        }
-        if (BitwiseCheck(messageType, XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT)) {
-            if (separator) {
-                msgFlags += ",";
-            }
-            msgFlags += "SPEC";
-            separator = true;
-        }
-        if (BitwiseCheck(messageType, XR_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT)) {
-            if (separator) {
-                msgFlags += ",";
-            }
-            msgFlags += "PERF";
-        }
-        return msgFlags;
-    };
-
-    // Collect message data.
-    std::string functionName = (pCallbackData->functionName) ? pCallbackData->functionName : "";
-    std::string messageSeverityStr = GetMessageSeverityString(messageSeverity);
-    std::string messageTypeStr = GetMessageTypeString(messageType);
-    std::string messageId = (pCallbackData->messageId) ? pCallbackData->messageId : "";
-    std::string message = (pCallbackData->message) ? pCallbackData->message : "";
-
-    // String stream final message.
-    std::stringstream errorMessage;
-    errorMessage << functionName << "(" << messageSeverityStr << " / " << messageTypeStr << "): msgNum: " << messageId << " - " << message;
-
-    // Log and debug break.
-    std::cerr << errorMessage.str() << std::endl;
-    if (BitwiseCheck(messageSeverity, XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)) {
-        DEBUG_BREAK;
+    // Filtering, rate limiting and formatting live in the filter the messenger was created with.
+    XrDebugMessengerFilter *filter = static_cast<XrDebugMessengerFilter *>(pUserData);
+    if (!filter) {
+        filter = &GetDefaultDebugMessengerFilter();
     }
-    return XrBool32();
+    return filter->OnMessage(messageSeverity, messageType, pCallbackData);
+}
+
+XrDebugMessengerFilter &GetDefaultDebugMessengerFilter() {
+    static XrDebugMessengerFilter filter;
+    return filter;
 }
 // XR_DOCS_TAG_END_OpenXRMessageCallbackFunction
 
 // XR_DOCS_TAG_BEGIN_Create_DestroyDebugMessenger
-XrDebugUtilsMessengerEXT CreateOpenXRDebugUtilsMessenger(XrInstance m_xrInstance) {
-    // Fill out a XrDebugUtilsMessengerCreateInfoEXT structure specifying all severities and types.
+XrDebugUtilsMessengerEXT CreateOpenXRDebugUtilsMessenger(XrInstance m_xrInstance, XrDebugMessengerFilter *filter) {
+    if (!filter) {
+        filter = &GetDefaultDebugMessengerFilter();
+    }
+    // Fill out a XrDebugUtilsMessengerCreateInfoEXT structure with the severities and types of the filter,
+    // so the runtime does not even call back for the messages it drops.
     // Set the userCallback to OpenXRMessageCallbackFunction().
     XrDebugUtilsMessengerCreateInfoEXT debugUtilsMessengerCI{XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT};
-    debugUtilsMessengerCI.messageSeverities = XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-    debugUtilsMessengerCI.messageTypes = XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_TYPE_CONFORMANCE_BIT_EXT;
+    debugUtilsMessengerCI.messageSeverities = filter->GetSubscribedSeverities();
+    debugUtilsMessengerCI.messageTypes = filter->GetSubscribedTypes();
     debugUtilsMessengerCI.userCallback = (PFN_xrDebugUtilsMessengerCallbackEXT)OpenXRMessageCallbackFunction;
-    debugUtilsMessengerCI.userData = nullptr;
+    debugUtilsMessengerCI.userData = filter;
 
     // Load xrCreateDebugUtilsMessengerEXT() function pointer as it is not default loaded by the OpenXR loader.
     XrDebugUtilsMessengerEXT debugUtilsMessenger{};
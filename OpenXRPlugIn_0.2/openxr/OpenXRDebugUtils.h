@@ -7,8 +7,13 @@
 #pragma once
 #include "HelperFunctions.h"
 #include "OpenXRHelper.h"
+#include "XrDebugMessengerFilter.h"
 
 XrBool32 OpenXRMessageCallbackFunction(XrDebugUtilsMessageSeverityFlagsEXT messageSeverity, XrDebugUtilsMessageTypeFlagsEXT messageType, const XrDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData);
 
-XrDebugUtilsMessengerEXT CreateOpenXRDebugUtilsMessenger(XrInstance m_xrInstance);
+// Filter used by messengers created without one.
+XrDebugMessengerFilter &GetDefaultDebugMessengerFilter();
+
+// The filter must outlive the messenger.
+XrDebugUtilsMessengerEXT CreateOpenXRDebugUtilsMessenger(XrInstance m_xrInstance, XrDebugMessengerFilter *filter = nullptr);
 void DestroyOpenXRDebugUtilsMessenger(XrInstance m_xrInstance, XrDebugUtilsMessengerEXT debugUtilsMessenger);
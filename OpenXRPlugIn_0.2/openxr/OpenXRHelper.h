@@ -21,19 +21,13 @@ inline void OpenXRDebugBreak() {
 }
 
 inline const char* GetXRErrorString(XrInstance xrInstance, XrResult result) {
-    static char string[XR_MAX_RESULT_STRING_SIZE];
+    // One buffer per thread, the result stays valid until the next call on the same thread.
+    thread_local char string[XR_MAX_RESULT_STRING_SIZE];
     xrResultToString(xrInstance, result, string);
     return string;
 }
 
-
-#define OPENXR_CHECK(x, y)                                                                                                                                  \
-    {                                                                                                                                                       \
-        XrResult result = (x);                                                                                                                              \
-        if (!XR_SUCCEEDED(result)) {                                                                                                                        \
-            std::cerr << "ERROR: OPENXR: " << int(result) << "(" << (m_xrInstance ? GetXRErrorString(m_xrInstance, result) : "") << ") " << y << std::endl; \
-            OpenXRDebugBreak();                                                                                                                             \
-        }                                                                                                                                                   \
-    }
+// OPENXR_CHECK(x, y): logs y and the name of the result when x fails, see XrCheck.h.
+#include "XrCheck.h"
 // XR_DOCS_TAG_END_Helper_Functions0
     
\ No newline at end of file
@@ -0,0 +1,452 @@
+#include "openxrPlugIn.h"
+
+#if defined(BEE_XR_GRAPHICS_VULKAN)
+
+#include "VulkanXrGraphicsBackend.h"
+
+#include "DebugOutput.h"
+#include "OpenXRDebugUtils.h"
+
+
+#define VULKAN_CHECK(x, y)                                                                     \
+    {                                                                                          \
+        VkResult result = (x);                                                                 \
+        if (result != VK_SUCCESS) {                                                            \
+            XR_TUT_LOG_ERROR("ERROR: VULKAN: " << y << " (0x" << std::hex << int(result)       \
+                             << std::dec << ") [" << #x << " at " << __FILE__ << ":" << __LINE__ << "]"); \
+        }                                                                                      \
+    }
+
+
+VulkanXrGraphicsBackend::~VulkanXrGraphicsBackend()
+{
+    StopWorkers();
+    if (m_device == VK_NULL_HANDLE)
+    {
+        if (m_vkInstance != VK_NULL_HANDLE)
+        {
+            vkDestroyInstance(m_vkInstance, nullptr);
+        }
+        return;
+    }
+
+    vkDeviceWaitIdle(m_device);
+    for (const auto& [image, imageView] : m_imageViews)
+    {
+        vkDestroyImageView(m_device, imageView, nullptr);
+    }
+    for (FrameResources& frame : m_frames)
+    {
+        for (ViewCommands& view : frame.views)
+        {
+            vkDestroyCommandPool(m_device, view.pool, nullptr);
+        }
+        if (frame.fence != VK_NULL_HANDLE)
+        {
+            vkDestroyFence(m_device, frame.fence, nullptr);
+        }
+    }
+    vkDestroyDevice(m_device, nullptr);
+    vkDestroyInstance(m_vkInstance, nullptr);
+}
+
+void VulkanXrGraphicsBackend::GetRequiredExtensions(std::vector<std::string>& extensions) const
+{
+    extensions.push_back(XR_KHR_VULKAN_ENABLE2_EXTENSION_NAME);
+}
+
+bool VulkanXrGraphicsBackend::CreateBinding(XrInstance instance, XrSystemId systemId)
+{
+    m_xrInstance = instance;
+
+    PFN_xrGetVulkanGraphicsRequirements2KHR xrGetVulkanGraphicsRequirements2KHR = nullptr;
+    PFN_xrCreateVulkanInstanceKHR xrCreateVulkanInstanceKHR = nullptr;
+    PFN_xrGetVulkanGraphicsDevice2KHR xrGetVulkanGraphicsDevice2KHR = nullptr;
+    PFN_xrCreateVulkanDeviceKHR xrCreateVulkanDeviceKHR = nullptr;
+    OPENXR_CHECK(xrGetInstanceProcAddr(m_xrInstance, "xrGetVulkanGraphicsRequirements2KHR", (PFN_xrVoidFunction*)&xrGetVulkanGraphicsRequirements2KHR),
+                 "Failed to get InstanceProcAddr for xrGetVulkanGraphicsRequirements2KHR.");
+    OPENXR_CHECK(xrGetInstanceProcAddr(m_xrInstance, "xrCreateVulkanInstanceKHR", (PFN_xrVoidFunction*)&xrCreateVulkanInstanceKHR),
+                 "Failed to get InstanceProcAddr for xrCreateVulkanInstanceKHR.");
+    OPENXR_CHECK(xrGetInstanceProcAddr(m_xrInstance, "xrGetVulkanGraphicsDevice2KHR", (PFN_xrVoidFunction*)&xrGetVulkanGraphicsDevice2KHR),
+                 "Failed to get InstanceProcAddr for xrGetVulkanGraphicsDevice2KHR.");
+    OPENXR_CHECK(xrGetInstanceProcAddr(m_xrInstance, "xrCreateVulkanDeviceKHR", (PFN_xrVoidFunction*)&xrCreateVulkanDeviceKHR),
+                 "Failed to get InstanceProcAddr for xrCreateVulkanDeviceKHR.");
+    if (!xrGetVulkanGraphicsRequirements2KHR || !xrCreateVulkanInstanceKHR || !xrGetVulkanGraphicsDevice2KHR || !xrCreateVulkanDeviceKHR)
+    {
+        return false;
+    }
+
+    XrGraphicsRequirementsVulkan2KHR graphicsRequirements{XR_TYPE_GRAPHICS_REQUIREMENTS_VULKAN2_KHR};
+    OPENXR_CHECK(xrGetVulkanGraphicsRequirements2KHR(m_xrInstance, systemId, &graphicsRequirements),
+                 "Failed to get Graphics Requirements for Vulkan.");
+
+    // Session re-created after a session or instance loss: the device stays valid as long as the
+    // runtime still renders on the same physical device, and with it the frame resources.
+    if (m_device != VK_NULL_HANDLE)
+    {
+        XrVulkanGraphicsDeviceGetInfoKHR deviceGetInfo{XR_TYPE_VULKAN_GRAPHICS_DEVICE_GET_INFO_KHR};
+        deviceGetInfo.systemId = systemId;
+        deviceGetInfo.vulkanInstance = m_vkInstance;
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        OPENXR_CHECK(xrGetVulkanGraphicsDevice2KHR(m_xrInstance, &deviceGetInfo, &physicalDevice), "Failed to get Graphics Device for Vulkan.");
+        if (physicalDevice != m_physicalDevice)
+        {
+            XR_TUT_LOG_ERROR("The runtime moved to another Vulkan device, the graphics backend has to be recreated.");
+            return false;
+        }
+        return true;
+    }
+
+    // Vulkan 1.1 at least, or whatever newer version the runtime asks for.
+    uint32_t apiVersion = VK_MAKE_VERSION(1, 1, 0);
+    uint32_t requiredApiVersion = VK_MAKE_VERSION(XR_VERSION_MAJOR(graphicsRequirements.minApiVersionSupported),
+                                                  XR_VERSION_MINOR(graphicsRequirements.minApiVersionSupported), 0);
+    apiVersion = std::max(apiVersion, requiredApiVersion);
+
+    // Instance, the runtime adds the extensions it needs.
+    VkApplicationInfo applicationInfo{VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    applicationInfo.pApplicationName = "OpenXR plug-in";
+    applicationInfo.applicationVersion = 1;
+    applicationInfo.pEngineName = "Bee Engine";
+    applicationInfo.engineVersion = 1;
+    applicationInfo.apiVersion = apiVersion;
+
+    VkInstanceCreateInfo instanceCI{VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    instanceCI.pApplicationInfo = &applicationInfo;
+
+    XrVulkanInstanceCreateInfoKHR xrInstanceCI{XR_TYPE_VULKAN_INSTANCE_CREATE_INFO_KHR};
+    xrInstanceCI.systemId = systemId;
+    xrInstanceCI.pfnGetInstanceProcAddr = &vkGetInstanceProcAddr;
+    xrInstanceCI.vulkanCreateInfo = &instanceCI;
+    VkResult vkResult = VK_SUCCESS;
+    OPENXR_CHECK(xrCreateVulkanInstanceKHR(m_xrInstance, &xrInstanceCI, &m_vkInstance, &vkResult), "Failed to create Vulkan Instance.");
+    VULKAN_CHECK(vkResult, "Failed to create Vulkan Instance.");
+    if (m_vkInstance == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    // Physical device, chosen by the runtime.
+    XrVulkanGraphicsDeviceGetInfoKHR deviceGetInfo{XR_TYPE_VULKAN_GRAPHICS_DEVICE_GET_INFO_KHR};
+    deviceGetInfo.systemId = systemId;
+    deviceGetInfo.vulkanInstance = m_vkInstance;
+    OPENXR_CHECK(xrGetVulkanGraphicsDevice2KHR(m_xrInstance, &deviceGetInfo, &m_physicalDevice), "Failed to get Graphics Device for Vulkan.");
+    if (m_physicalDevice == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, queueFamilies.data());
+    bool foundQueueFamily = false;
+    for (uint32_t i = 0; i < queueFamilyCount && !foundQueueFamily; i++)
+    {
+        if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        {
+            m_queueFamilyIndx = i;
+            foundQueueFamily = true;
+        }
+    }
+    if (!foundQueueFamily)
+    {
+        XR_TUT_LOG_ERROR("Failed to find a Vulkan graphics queue family.");
+        return false;
+    }
+
+    // Device, again the runtime adds the extensions it needs.
+    const float queuePriority = 1.0f;
+    VkDeviceQueueCreateInfo queueCI{VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+    queueCI.queueFamilyIndex = m_queueFamilyIndx;
+    queueCI.queueCount = 1;
+    queueCI.pQueuePriorities = &queuePriority;
+
+    VkDeviceCreateInfo deviceCI{VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+    deviceCI.queueCreateInfoCount = 1;
+    deviceCI.pQueueCreateInfos = &queueCI;
+
+    XrVulkanDeviceCreateInfoKHR xrDeviceCI{XR_TYPE_VULKAN_DEVICE_CREATE_INFO_KHR};
+    xrDeviceCI.systemId = systemId;
+    xrDeviceCI.pfnGetInstanceProcAddr = &vkGetInstanceProcAddr;
+    xrDeviceCI.vulkanPhysicalDevice = m_physicalDevice;
+    xrDeviceCI.vulkanCreateInfo = &deviceCI;
+    OPENXR_CHECK(xrCreateVulkanDeviceKHR(m_xrInstance, &xrDeviceCI, &m_device, &vkResult), "Failed to create Vulkan Device.");
+    VULKAN_CHECK(vkResult, "Failed to create Vulkan Device.");
+    if (m_device == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+    vkGetDeviceQueue(m_device, m_queueFamilyIndx, 0, &m_queue);
+
+    m_binding.instance = m_vkInstance;
+    m_binding.physicalDevice = m_physicalDevice;
+    m_binding.device = m_device;
+    m_binding.queueFamilyIndex = m_queueFamilyIndx;
+    m_binding.queueIndex = 0;
+    return true;
+}
+
+int64_t VulkanXrGraphicsBackend::SelectColorSwapchainFormat(const std::vector<int64_t>& formats) const
+{
+    const int64_t supportedFormats[] = {VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_B8G8R8A8_UNORM};
+    for (int64_t format : formats)
+    {
+        if (std::find(std::begin(supportedFormats), std::end(supportedFormats), format) != std::end(supportedFormats))
+        {
+            return format;
+        }
+    }
+    return 0;
+}
+
+void VulkanXrGraphicsBackend::EnumerateSwapchainImages(XrSwapchain swapchain, std::vector<uint64_t>& images)
+{
+    uint32_t imageCount = 0;
+    OPENXR_CHECK(xrEnumerateSwapchainImages(swapchain, 0, &imageCount, nullptr), "Failed to enumerate Color Swapchain Images.");
+
+    std::vector<XrSwapchainImageVulkan2KHR> vkImages(imageCount, {XR_TYPE_SWAPCHAIN_IMAGE_VULKAN2_KHR});
+    OPENXR_CHECK(xrEnumerateSwapchainImages(swapchain,
+                                            imageCount,
+                                            &imageCount,
+                                            reinterpret_cast<XrSwapchainImageBaseHeader*>(vkImages.data())),
+                 "Failed to enumerate Color Swapchain Images.");
+
+    images.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++)
+    {
+        images[i] = (uint64_t)vkImages[i].image;
+    }
+}
+
+uint64_t VulkanXrGraphicsBackend::GetRenderTarget(const XrRenderTarget& target)
+{
+    std::lock_guard<std::mutex> lock(m_renderTargetMutex);
+    auto it = m_imageViews.find(target.image);
+    if (it != m_imageViews.end())
+    {
+        return (uint64_t)it->second;
+    }
+
+    VkImageViewCreateInfo imageViewCI{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    imageViewCI.image = (VkImage)target.image;
+    imageViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCI.format = static_cast<VkFormat>(target.format);
+    imageViewCI.components = {VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                              VK_COMPONENT_SWIZZLE_IDENTITY};
+    imageViewCI.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    VkImageView imageView = VK_NULL_HANDLE;
+    VULKAN_CHECK(vkCreateImageView(m_device, &imageViewCI, nullptr, &imageView), "Failed to create swapchain ImageView.");
+    m_imageViews[target.image] = imageView;
+    return (uint64_t)imageView;
+}
+
+void VulkanXrGraphicsBackend::ReleaseSwapchainImages(const std::vector<uint64_t>& images)
+{
+    if (m_device == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    // The copies of the frames in flight may still use the views.
+    vkDeviceWaitIdle(m_device);
+    std::lock_guard<std::mutex> lock(m_renderTargetMutex);
+    for (uint64_t image : images)
+    {
+        auto it = m_imageViews.find(image);
+        if (it != m_imageViews.end())
+        {
+            vkDestroyImageView(m_device, it->second, nullptr);
+            m_imageViews.erase(it);
+        }
+    }
+}
+
+void VulkanXrGraphicsBackend::CreateFrameResources(uint32_t viewCount)
+{
+    for (FrameResources& frame : m_frames)
+    {
+        if (frame.fence == VK_NULL_HANDLE)
+        {
+            // Created signalled so the first wait of every slot returns immediately.
+            VkFenceCreateInfo fenceCI{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+            fenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+            VULKAN_CHECK(vkCreateFence(m_device, &fenceCI, nullptr, &frame.fence), "Failed to create Fence.");
+        }
+
+        // One pool per view, a command pool may only be used by one thread at a time.
+        while (frame.views.size() < viewCount)
+        {
+            ViewCommands view;
+            VkCommandPoolCreateInfo commandPoolCI{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+            commandPoolCI.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            commandPoolCI.queueFamilyIndex = m_queueFamilyIndx;
+            VULKAN_CHECK(vkCreateCommandPool(m_device, &commandPoolCI, nullptr, &view.pool), "Failed to create CommandPool.");
+
+            VkCommandBufferAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+            allocateInfo.commandPool = view.pool;
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocateInfo.commandBufferCount = 1;
+            VULKAN_CHECK(vkAllocateCommandBuffers(m_device, &allocateInfo, &view.commandBuffer), "Failed to allocate CommandBuffers.");
+            frame.views.push_back(view);
+        }
+    }
+}
+
+void VulkanXrGraphicsBackend::BeginFrame(const XrRenderFrame& frame)
+{
+    CreateFrameResources(frame.viewCount);
+
+    // Wait until the GPU is done with the frame that used this slot before.
+    m_frameSlot = static_cast<uint32_t>(frame.frameIndx % kFramesInFlight);
+    FrameResources& resources = m_frames[m_frameSlot];
+    VULKAN_CHECK(vkWaitForFences(m_device, 1, &resources.fence, VK_TRUE, UINT64_MAX), "Failed to wait for Fence.");
+    VULKAN_CHECK(vkResetFences(m_device, 1, &resources.fence), "Failed to reset Fence.");
+
+    for (uint32_t i = 0; i < frame.viewCount; i++)
+    {
+        ViewCommands& view = resources.views[i];
+        VULKAN_CHECK(vkResetCommandPool(m_device, view.pool, 0), "Failed to reset CommandPool.");
+
+        VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VULKAN_CHECK(vkBeginCommandBuffer(view.commandBuffer, &beginInfo), "Failed to begin CommandBuffer.");
+    }
+}
+
+VkCommandBuffer VulkanXrGraphicsBackend::GetViewCommandBuffer(uint32_t viewIndx) const
+{
+    return m_frames[m_frameSlot].views[viewIndx].commandBuffer;
+}
+
+void VulkanXrGraphicsBackend::CopyToRenderTarget(const XrRenderTarget& target, const XrGraphicsImage& source)
+{
+    VkCommandBuffer commandBuffer = GetViewCommandBuffer(target.viewIndx);
+    VkImage swapchainImage = (VkImage)target.image;
+
+    // Swapchain images are handed out in COLOR_ATTACHMENT_OPTIMAL and have to be given back in it.
+    VkImageMemoryBarrier toTransfer{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toTransfer.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = swapchainImage;
+    toTransfer.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                         nullptr, 1, &toTransfer);
+
+    VkImageBlit region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.srcOffsets[1] = {source.width, source.height, 1};
+    region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.dstOffsets[1] = {target.width, target.height, 1};
+    vkCmdBlitImage(commandBuffer, (VkImage)source.handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapchainImage,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_NEAREST);
+
+    VkImageMemoryBarrier toAttachment = toTransfer;
+    toAttachment.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toAttachment.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    toAttachment.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    toAttachment.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0,
+                         nullptr, 1, &toAttachment);
+}
+
+void VulkanXrGraphicsBackend::EndFrame(const XrRenderFrame& frame)
+{
+    FrameResources& resources = m_frames[m_frameSlot];
+    std::vector<VkCommandBuffer> commandBuffers(frame.viewCount);
+    for (uint32_t i = 0; i < frame.viewCount; i++)
+    {
+        commandBuffers[i] = resources.views[i].commandBuffer;
+        VULKAN_CHECK(vkEndCommandBuffer(commandBuffers[i]), "Failed to end CommandBuffer.");
+    }
+
+    // One submission for all the views. The work must be submitted before the images are released.
+    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    submitInfo.pCommandBuffers = commandBuffers.data();
+    VULKAN_CHECK(vkQueueSubmit(m_queue, 1, &submitInfo, resources.fence), "Failed to submit to Queue.");
+}
+
+void VulkanXrGraphicsBackend::RecordViews(const XrRenderFrame& frame, const ViewRecordFunction& record)
+{
+    if (frame.viewCount == 0)
+    {
+        return;
+    }
+    StartWorkers(frame.viewCount - 1);
+
+    {
+        std::lock_guard<std::mutex> lock(m_workMutex);
+        m_workFrame = &frame;
+        m_workFunction = &record;
+        m_workPending = frame.viewCount - 1;
+        m_workGeneration++;
+    }
+    m_workCondition.notify_all();
+
+    record(frame.views[0], GetViewCommandBuffer(0));
+
+    std::unique_lock<std::mutex> lock(m_workMutex);
+    m_workDoneCondition.wait(lock, [this]() { return m_workPending == 0; });
+    m_workFrame = nullptr;
+    m_workFunction = nullptr;
+}
+
+void VulkanXrGraphicsBackend::StartWorkers(uint32_t workerCount)
+{
+    while (m_workers.size() < workerCount)
+    {
+        // Started before the generation of the upcoming RecordViews() call is published, so the worker picks it up.
+        uint32_t viewIndx = static_cast<uint32_t>(m_workers.size()) + 1;
+        m_workers.emplace_back(&VulkanXrGraphicsBackend::WorkerLoop, this, viewIndx, m_workGeneration);
+    }
+}
+
+void VulkanXrGraphicsBackend::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_workMutex);
+        m_stopWorkers = true;
+    }
+    m_workCondition.notify_all();
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+void VulkanXrGraphicsBackend::WorkerLoop(uint32_t viewIndx, uint64_t generation)
+{
+    std::unique_lock<std::mutex> lock(m_workMutex);
+    while (true)
+    {
+        m_workCondition.wait(lock, [&]() { return m_stopWorkers || m_workGeneration != generation; });
+        if (m_stopWorkers)
+        {
+            return;
+        }
+        generation = m_workGeneration;
+        const XrRenderFrame* frame = m_workFrame;
+        const ViewRecordFunction* record = m_workFunction;
+        if (viewIndx >= frame->viewCount)
+        {
+            continue;
+        }
+
+        lock.unlock();
+        (*record)(frame->views[viewIndx], GetViewCommandBuffer(viewIndx));
+        lock.lock();
+
+        if (--m_workPending == 0)
+        {
+            m_workDoneCondition.notify_one();
+        }
+    }
+}
+
+#endif
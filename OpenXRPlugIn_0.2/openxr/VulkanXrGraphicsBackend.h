@@ -0,0 +1,115 @@
+#pragma once
+
+#if defined(BEE_XR_GRAPHICS_VULKAN)
+
+#include <vulkan/vulkan.h>
+#ifndef XR_USE_GRAPHICS_API_VULKAN
+#define XR_USE_GRAPHICS_API_VULKAN
+#endif
+#include "openxr.h"
+#include "openxr_platform.h"     // openxrPlugIn.h enables Vulkan for it when BEE_XR_GRAPHICS_VULKAN is defined
+
+#include "XrGraphicsBackend.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+
+// Vulkan through XR_KHR_vulkan_enable2. The backend creates the VkInstance and VkDevice through the
+// runtime so they get the extensions the compositor needs; the application renders with GetDevice().
+//
+// Every view records into its own command buffer from its own command pool, so the eyes can be
+// recorded in parallel with RecordViews(). EndFrame() submits all of them in one vkQueueSubmit,
+// signalling a fence per frame in flight that BeginFrame() waits on before reusing the pools.
+// The runtime synchronizes with the submitted work through the queue of the binding.
+class VulkanXrGraphicsBackend : public XrGraphicsBackend
+{
+public:
+    using ViewRecordFunction = std::function<void(const XrRenderView& view, VkCommandBuffer commandBuffer)>;
+
+    VulkanXrGraphicsBackend() = default;
+    ~VulkanXrGraphicsBackend() override;
+
+    XrGraphicsApi GetApi() const override { return XrGraphicsApi::Vulkan; }
+    const char* GetName() const override { return "Vulkan"; }
+
+    void GetRequiredExtensions(std::vector<std::string>& extensions) const override;
+    bool CreateBinding(XrInstance instance, XrSystemId systemId) override;
+    const void* GetSessionBinding() const override { return &m_binding; }
+
+    int64_t SelectColorSwapchainFormat(const std::vector<int64_t>& formats) const override;
+    void EnumerateSwapchainImages(XrSwapchain swapchain, std::vector<uint64_t>& images) override;
+
+    uint64_t GetRenderTarget(const XrRenderTarget& target) override;
+    void ReleaseSwapchainImages(const std::vector<uint64_t>& images) override;
+
+    void BeginFrame(const XrRenderFrame& frame) override;
+    // Records into the command buffer of the target view, safe to call for different views concurrently.
+    void CopyToRenderTarget(const XrRenderTarget& target, const XrGraphicsImage& source) override;
+    void EndFrame(const XrRenderFrame& frame) override;
+
+    // Records every view of the frame at the same time: the first on the calling thread, the others on
+    // one worker thread each. Returns once all of them are recorded. Only valid between BeginFrame()
+    // and EndFrame(), that is inside XrRenderer::RenderFrame().
+    void RecordViews(const XrRenderFrame& frame, const ViewRecordFunction& record);
+    // Command buffer the current frame records for a view.
+    VkCommandBuffer GetViewCommandBuffer(uint32_t viewIndx) const;
+
+    VkInstance GetInstance() const { return m_vkInstance; }
+    VkPhysicalDevice GetPhysicalDevice() const { return m_physicalDevice; }
+    VkDevice GetDevice() const { return m_device; }
+    VkQueue GetQueue() const { return m_queue; }
+    uint32_t GetQueueFamilyIndex() const { return m_queueFamilyIndx; }
+
+private:
+    static constexpr uint32_t kFramesInFlight = 2;
+
+    struct ViewCommands
+    {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    };
+
+    struct FrameResources
+    {
+        std::vector<ViewCommands> views;
+        VkFence fence = VK_NULL_HANDLE;
+    };
+
+    void CreateFrameResources(uint32_t viewCount);
+    void StartWorkers(uint32_t workerCount);
+    void StopWorkers();
+    void WorkerLoop(uint32_t viewIndx, uint64_t generation);
+
+    XrInstance m_xrInstance = XR_NULL_HANDLE;
+    XrGraphicsBindingVulkan2KHR m_binding = {XR_TYPE_GRAPHICS_BINDING_VULKAN2_KHR};
+
+    VkInstance m_vkInstance = VK_NULL_HANDLE;
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    uint32_t m_queueFamilyIndx = 0;
+
+    FrameResources m_frames[kFramesInFlight];
+    uint32_t m_frameSlot = 0;
+
+    // Swapchain image -> image view, shared by the recording threads.
+    std::mutex m_renderTargetMutex;
+    std::unordered_map<uint64_t, VkImageView> m_imageViews;
+
+    // Recording workers, worker i records view i + 1.
+    std::vector<std::thread> m_workers;
+    std::mutex m_workMutex;
+    std::condition_variable m_workCondition;
+    std::condition_variable m_workDoneCondition;
+    const XrRenderFrame* m_workFrame = nullptr;
+    const ViewRecordFunction* m_workFunction = nullptr;
+    uint64_t m_workGeneration = 0;
+    uint32_t m_workPending = 0;
+    bool m_stopWorkers = false;
+};
+
+#endif
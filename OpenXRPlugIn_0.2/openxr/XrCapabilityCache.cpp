@@ -0,0 +1,266 @@
+#include "XrCapabilityCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+
+
+namespace
+{
+
+const char kMagic[4] = {'B', 'X', 'R', 'C'};
+
+// FNV-1a over the payload, catches truncated and partially written files.
+uint64_t Checksum(const std::string& data)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : data)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+class Writer
+{
+public:
+    template <typename T>
+    void Value(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only plain values are written as bytes");
+        m_data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void String(const std::string& value)
+    {
+        Value(static_cast<uint32_t>(value.size()));
+        m_data.append(value);
+    }
+
+    template <typename T>
+    void Values(const std::vector<T>& values)
+    {
+        Value(static_cast<uint32_t>(values.size()));
+        for (const T& value : values)
+        {
+            Value(value);
+        }
+    }
+
+    void Strings(const std::vector<std::string>& values)
+    {
+        Value(static_cast<uint32_t>(values.size()));
+        for (const std::string& value : values)
+        {
+            String(value);
+        }
+    }
+
+    const std::string& Data() const { return m_data; }
+
+private:
+    std::string m_data;
+};
+
+class Reader
+{
+public:
+    explicit Reader(const std::string& data) : m_data(data) {}
+
+    template <typename T>
+    bool Value(T& value)
+    {
+        if (m_offset + sizeof(T) > m_data.size())
+        {
+            return false;
+        }
+        std::memcpy(&value, m_data.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
+
+    bool String(std::string& value)
+    {
+        uint32_t size = 0;
+        if (!Value(size) || m_offset + size > m_data.size())
+        {
+            return false;
+        }
+        value.assign(m_data.data() + m_offset, size);
+        m_offset += size;
+        return true;
+    }
+
+    template <typename T>
+    bool Values(std::vector<T>& values)
+    {
+        uint32_t count = 0;
+        if (!Value(count) || m_offset + static_cast<size_t>(count) * sizeof(T) > m_data.size())
+        {
+            return false;
+        }
+        values.resize(count);
+        for (T& value : values)
+        {
+            Value(value);
+        }
+        return true;
+    }
+
+    bool Strings(std::vector<std::string>& values)
+    {
+        uint32_t count = 0;
+        if (!Value(count))
+        {
+            return false;
+        }
+        values.clear();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            std::string value;
+            if (!String(value))
+            {
+                return false;
+            }
+            values.push_back(std::move(value));
+        }
+        return true;
+    }
+
+    bool AtEnd() const { return m_offset == m_data.size(); }
+
+private:
+    const std::string& m_data;
+    size_t m_offset = 0;
+};
+
+// XrViewConfigurationView carries a type and next pointer, only its sizes are stored.
+struct ViewSizes
+{
+    uint32_t recommendedImageRectWidth;
+    uint32_t maxImageRectWidth;
+    uint32_t recommendedImageRectHeight;
+    uint32_t maxImageRectHeight;
+    uint32_t recommendedSwapchainSampleCount;
+    uint32_t maxSwapchainSampleCount;
+};
+
+}  // namespace
+
+
+bool XrCapabilityCache::Load(const std::string& path)
+{
+    Clear();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    const size_t headerSize = sizeof(kMagic) + sizeof(uint32_t) + sizeof(uint64_t);
+    if (contents.size() < headerSize || std::memcmp(contents.data(), kMagic, sizeof(kMagic)) != 0)
+    {
+        return false;
+    }
+    uint32_t fileVersion = 0;
+    uint64_t checksum = 0;
+    std::memcpy(&fileVersion, contents.data() + sizeof(kMagic), sizeof(fileVersion));
+    std::memcpy(&checksum, contents.data() + sizeof(kMagic) + sizeof(fileVersion), sizeof(checksum));
+    std::string payload = contents.substr(headerSize);
+    if (fileVersion != kFileVersion || checksum != Checksum(payload))
+    {
+        return false;
+    }
+
+    Reader reader(payload);
+    std::vector<ViewSizes> viewSizes;
+    bool ok = reader.String(runtimeName) && reader.Value(runtimeVersion) && reader.String(graphicsBackend) &&
+              reader.Strings(apiLayers) && reader.Strings(instanceExtensions) &&
+              reader.Value(systemVendorId) && reader.String(systemName) &&
+              reader.Values(viewConfigurations) && reader.Value(viewConfiguration) && reader.Values(viewSizes) &&
+              reader.Values(environmentBlendModes) && reader.Values(swapchainFormats) && reader.AtEnd();
+    if (!ok)
+    {
+        Clear();
+        return false;
+    }
+
+    viewConfigurationViews.resize(viewSizes.size(), {XR_TYPE_VIEW_CONFIGURATION_VIEW});
+    for (size_t i = 0; i < viewSizes.size(); i++)
+    {
+        XrViewConfigurationView& view = viewConfigurationViews[i];
+        view.recommendedImageRectWidth = viewSizes[i].recommendedImageRectWidth;
+        view.maxImageRectWidth = viewSizes[i].maxImageRectWidth;
+        view.recommendedImageRectHeight = viewSizes[i].recommendedImageRectHeight;
+        view.maxImageRectHeight = viewSizes[i].maxImageRectHeight;
+        view.recommendedSwapchainSampleCount = viewSizes[i].recommendedSwapchainSampleCount;
+        view.maxSwapchainSampleCount = viewSizes[i].maxSwapchainSampleCount;
+    }
+    return true;
+}
+
+bool XrCapabilityCache::Save(const std::string& path) const
+{
+    std::vector<ViewSizes> viewSizes;
+    for (const XrViewConfigurationView& view : viewConfigurationViews)
+    {
+        viewSizes.push_back({view.recommendedImageRectWidth,
+                             view.maxImageRectWidth,
+                             view.recommendedImageRectHeight,
+                             view.maxImageRectHeight,
+                             view.recommendedSwapchainSampleCount,
+                             view.maxSwapchainSampleCount});
+    }
+
+    Writer payload;
+    payload.String(runtimeName);
+    payload.Value(runtimeVersion);
+    payload.String(graphicsBackend);
+    payload.Strings(apiLayers);
+    payload.Strings(instanceExtensions);
+    payload.Value(systemVendorId);
+    payload.String(systemName);
+    payload.Values(viewConfigurations);
+    payload.Value(viewConfiguration);
+    payload.Values(viewSizes);
+    payload.Values(environmentBlendModes);
+    payload.Values(swapchainFormats);
+
+    Writer header;
+    header.Value(kMagic);
+    header.Value(kFileVersion);
+    header.Value(Checksum(payload.Data()));
+
+    // Write next to the cache and swap, a crash halfway leaves the previous file intact.
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            return false;
+        }
+        file.write(header.Data().data(), header.Data().size());
+        file.write(payload.Data().data(), payload.Data().size());
+        if (!file)
+        {
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+void XrCapabilityCache::Clear()
+{
+    *this = XrCapabilityCache();
+}
+
+bool XrCapabilityCache::MatchesRuntime(const char* name, XrVersion version) const
+{
+    return runtimeName == name && runtimeVersion == version;
+}
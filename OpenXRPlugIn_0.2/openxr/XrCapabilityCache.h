@@ -0,0 +1,47 @@
+#pragma once
+
+#include "openxr.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Results of the runtime capability enumerations of the last launch, stored in a small binary file
+// so the next startup can make its decisions without the two-call queries.
+//
+// The cache is keyed by the runtime name and version and the graphics backend. A cache for a different
+// key is ignored, and the plug-in checks the cached system and view sizes against the live runtime
+// when the session is created, see OpenxrPlugIn::ValidateCapabilityCache().
+struct XrCapabilityCache
+{
+    // Bump when the layout of the file changes, older files are ignored.
+    static constexpr uint32_t kFileVersion = 1;
+
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+    void Clear();
+
+    bool MatchesRuntime(const char* name, XrVersion version) const;
+
+    // Key
+    std::string runtimeName;
+    XrVersion runtimeVersion = 0;
+    std::string graphicsBackend;
+
+    // Instance
+    std::vector<std::string> apiLayers;
+    std::vector<std::string> instanceExtensions;
+
+    // System, checked against the live runtime when the session is created
+    uint32_t systemVendorId = 0;
+    std::string systemName;
+
+    // Views and blend modes of the selected view configuration
+    std::vector<XrViewConfigurationType> viewConfigurations;
+    XrViewConfigurationType viewConfiguration = XR_VIEW_CONFIGURATION_TYPE_MAX_ENUM;
+    std::vector<XrViewConfigurationView> viewConfigurationViews;
+    std::vector<XrEnvironmentBlendMode> environmentBlendModes;
+
+    // Session
+    std::vector<int64_t> swapchainFormats;
+};
@@ -0,0 +1,77 @@
+#include "XrCheck.h"
+
+#include "DebugOutput.h"
+#include "HelperFunctions.h"
+
+#include <sstream>
+
+
+namespace
+{
+
+std::atomic<XrCheckSite*> g_failedSites{nullptr};
+std::atomic<uint64_t> g_failureCount{0};
+
+}  // namespace
+
+
+uint32_t RecordXrCheckFailure(XrCheckSite& site, XrResult result)
+{
+    g_failureCount.fetch_add(1, std::memory_order_relaxed);
+    site.lastResult.store(static_cast<int32_t>(result), std::memory_order_relaxed);
+    uint32_t count = site.failures.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // Sites are never unlinked, so pushing to the head is all the list needs.
+    if (!site.registered.exchange(true, std::memory_order_acq_rel))
+    {
+        XrCheckSite* head = g_failedSites.load(std::memory_order_relaxed);
+        do
+        {
+            site.next = head;
+        } while (!g_failedSites.compare_exchange_weak(head, &site, std::memory_order_release, std::memory_order_relaxed));
+    }
+    return count;
+}
+
+void LogXrCheckFailure(const XrCheckSite& site, XrResult result, void (*format)(std::ostream&, const void*), const void* message)
+{
+    std::ostringstream stream;
+    format(stream, message);
+    XR_TUT_LOG_ERROR("ERROR: OPENXR: " << XrResultName(result) << " (" << int(result) << ") " << stream.str() << " ["
+                                       << site.expression << " at " << site.file << ":" << site.line << "]");
+#if XR_CHECK_BREAK_ON_FAILURE
+    DEBUG_BREAK;
+#endif
+}
+
+std::vector<XrCheckFailure> GetXrCheckFailures()
+{
+    std::vector<XrCheckFailure> failures;
+    for (XrCheckSite* site = g_failedSites.load(std::memory_order_acquire); site != nullptr; site = site->next)
+    {
+        uint32_t count = site->failures.load(std::memory_order_relaxed);
+        if (count > 0)
+        {
+            failures.push_back({site->expression,
+                                site->file,
+                                site->line,
+                                count,
+                                static_cast<XrResult>(site->lastResult.load(std::memory_order_relaxed))});
+        }
+    }
+    return failures;
+}
+
+uint64_t GetXrCheckFailureCount()
+{
+    return g_failureCount.load(std::memory_order_relaxed);
+}
+
+void ResetXrCheckFailures()
+{
+    for (XrCheckSite* site = g_failedSites.load(std::memory_order_acquire); site != nullptr; site = site->next)
+    {
+        site->failures.store(0, std::memory_order_relaxed);
+    }
+    g_failureCount.store(0, std::memory_order_relaxed);
+}
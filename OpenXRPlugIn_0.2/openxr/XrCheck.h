@@ -0,0 +1,106 @@
+#pragma once
+
+#include "openxr.h"
+#include "openxr_reflection.h"
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+
+// Checking of OpenXR results behind OPENXR_CHECK.
+//
+// The success path is a single branch: everything done on a failure (counting, formatting, logging,
+// breaking into the debugger) lives in a cold out of line function. Every call site has a statically
+// initialized XrCheckSite counting its failures, queryable with GetXrCheckFailures().
+
+#if defined(__GNUC__) || defined(__clang__)
+#define XR_CHECK_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define XR_CHECK_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define XR_CHECK_UNLIKELY(x) (x)
+#define XR_CHECK_COLD __declspec(noinline)
+#else
+#define XR_CHECK_UNLIKELY(x) (x)
+#define XR_CHECK_COLD
+#endif
+
+// Break into the debugger on a failed check. On by default in debug builds only, define
+// XR_CHECK_BREAK_ON_FAILURE to 0 or 1 to override.
+#ifndef XR_CHECK_BREAK_ON_FAILURE
+#if defined(NDEBUG)
+#define XR_CHECK_BREAK_ON_FAILURE 0
+#else
+#define XR_CHECK_BREAK_ON_FAILURE 1
+#endif
+#endif
+
+
+// Name of a result from the XR_LIST_ENUM_XrResult table of openxr_reflection.h. Unlike
+// xrResultToString() it needs no instance and returns a string literal, so it is thread safe.
+constexpr const char* XrResultName(XrResult result)
+{
+    switch (result)
+    {
+#define XR_CHECK_RESULT_NAME(name, value) \
+    case name:                            \
+        return #name;
+        XR_LIST_ENUM_XrResult(XR_CHECK_RESULT_NAME)
+#undef XR_CHECK_RESULT_NAME
+    default:
+        return "XR_UNKNOWN_RESULT";
+    }
+}
+
+struct XrCheckSite
+{
+    constexpr XrCheckSite(const char* expression, const char* file, int line)
+        : expression(expression), file(file), line(line)
+    {}
+
+    const char* expression;
+    const char* file;
+    int line;
+
+    std::atomic<uint32_t> failures{0};
+    std::atomic<int32_t> lastResult{0};
+    // Linked into the list GetXrCheckFailures() walks on the first failure.
+    std::atomic<bool> registered{false};
+    XrCheckSite* next = nullptr;
+};
+
+struct XrCheckFailure
+{
+    const char* expression;
+    const char* file;
+    int line;
+    uint32_t count;
+    XrResult lastResult;
+};
+
+// Every call site that failed at least once, with its failure count.
+std::vector<XrCheckFailure> GetXrCheckFailures();
+uint64_t GetXrCheckFailureCount();
+void ResetXrCheckFailures();
+
+// Counts the failure and registers the site. Returns the failure count of the site.
+uint32_t RecordXrCheckFailure(XrCheckSite& site, XrResult result);
+void LogXrCheckFailure(const XrCheckSite& site, XrResult result, void (*format)(std::ostream&, const void*), const void* message);
+
+template <typename Message>
+XR_CHECK_COLD void ReportXrCheckFailure(XrCheckSite& site, XrResult result, const Message& message)
+{
+    RecordXrCheckFailure(site, result);
+    LogXrCheckFailure(site, result, [](std::ostream& stream, const void* context) { (*static_cast<const Message*>(context))(stream); }, &message);
+}
+
+
+#define OPENXR_CHECK(x, y)                                                                                   \
+    {                                                                                                        \
+        XrResult xrCheckResult = (x);                                                                        \
+        if (XR_CHECK_UNLIKELY(XR_FAILED(xrCheckResult)))                                                     \
+        {                                                                                                    \
+            static XrCheckSite xrCheckSite(#x, __FILE__, __LINE__);                                          \
+            ReportXrCheckFailure(xrCheckSite, xrCheckResult, [&](std::ostream& xrCheckMessage) { xrCheckMessage << y; }); \
+        }                                                                                                    \
+    }
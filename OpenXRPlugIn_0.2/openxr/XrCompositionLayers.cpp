@@ -0,0 +1,433 @@
+#include "XrCompositionLayers.h"
+
+#include "DebugOutput.h"
+#include "OpenXRDebugUtils.h"
+#include "XrFrameTrace.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace
+{
+
+XrVector3f RotateVector(const XrQuaternionf& q, const XrVector3f& v)
+{
+    // v + 2w (q x v) + 2 q x (q x v)
+    const XrVector3f t = {2.0f * (q.y * v.z - q.z * v.y), 2.0f * (q.z * v.x - q.x * v.z), 2.0f * (q.x * v.y - q.y * v.x)};
+    return {v.x + q.w * t.x + (q.y * t.z - q.z * t.y), v.y + q.w * t.y + (q.z * t.x - q.x * t.z),
+            v.z + q.w * t.z + (q.x * t.y - q.y * t.x)};
+}
+
+}  // namespace
+
+
+XrCompositionLayers::~XrCompositionLayers()
+{
+    DestroySwapchains();
+}
+
+uint32_t XrCompositionLayers::AddQuadLayer(const XrQuadLayerDesc& desc, XrLayerRenderFunction render)
+{
+    Layer& layer = Add(desc.order, std::move(render));
+    layer.space = desc.space;
+    layer.pose = desc.pose;
+    layer.swapchainCI.width = static_cast<uint32_t>(desc.width);
+    layer.swapchainCI.height = static_cast<uint32_t>(desc.height);
+
+    layer.size = desc.size;
+    XrCompositionLayerQuad& quad = layer.composition.quad;
+    quad = {XR_TYPE_COMPOSITION_LAYER_QUAD};
+    quad.layerFlags = XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT;
+    quad.eyeVisibility = desc.eyeVisibility;
+    quad.size = desc.size;
+    quad.subImage.imageRect = {{0, 0}, {desc.width, desc.height}};
+
+    CreateSwapchain(layer);
+    return layer.id;
+}
+
+uint32_t XrCompositionLayers::AddCubeLayer(const XrCubeLayerDesc& desc, XrLayerRenderFunction upload)
+{
+    Layer& layer = Add(desc.order, std::move(upload));
+    layer.space = desc.space;
+    layer.pose.orientation = desc.orientation;
+    layer.staticImage = true;
+    layer.swapchainCI.createFlags = XR_SWAPCHAIN_CREATE_STATIC_IMAGE_BIT;
+    layer.swapchainCI.usageFlags |= XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT;
+    layer.swapchainCI.width = static_cast<uint32_t>(desc.faceSize);
+    layer.swapchainCI.height = static_cast<uint32_t>(desc.faceSize);
+    layer.swapchainCI.faceCount = 6;
+
+    XrCompositionLayerCubeKHR& cube = layer.composition.cube;
+    cube = {XR_TYPE_COMPOSITION_LAYER_CUBE_KHR};
+    cube.eyeVisibility = desc.eyeVisibility;
+    cube.imageArrayIndex = 0;
+
+    CreateSwapchain(layer);
+    return layer.id;
+}
+
+uint32_t XrCompositionLayers::AddCylinderLayer(const XrCylinderLayerDesc& desc, XrLayerRenderFunction render)
+{
+    Layer& layer = Add(desc.order, std::move(render));
+    layer.space = desc.space;
+    layer.pose = desc.pose;
+    layer.swapchainCI.usageFlags |= XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT;
+    layer.swapchainCI.width = static_cast<uint32_t>(desc.width);
+    layer.swapchainCI.height = static_cast<uint32_t>(desc.height);
+
+    XrCompositionLayerCylinderKHR& cylinder = layer.composition.cylinder;
+    cylinder = {XR_TYPE_COMPOSITION_LAYER_CYLINDER_KHR};
+    cylinder.eyeVisibility = desc.eyeVisibility;
+    cylinder.subImage.imageRect = {{0, 0}, {desc.width, desc.height}};
+    cylinder.radius = desc.radius;
+    cylinder.centralAngle = desc.centralAngle;
+    cylinder.aspectRatio = static_cast<float>(desc.width) / static_cast<float>(desc.height);
+
+    CreateSwapchain(layer);
+    return layer.id;
+}
+
+uint32_t XrCompositionLayers::AddEquirectLayer(const XrEquirectLayerDesc& desc, XrLayerRenderFunction render)
+{
+    Layer& layer = Add(desc.order, std::move(render));
+    layer.space = desc.space;
+    layer.pose = desc.pose;
+    layer.swapchainCI.usageFlags |= XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT;
+    layer.swapchainCI.width = static_cast<uint32_t>(desc.width);
+    layer.swapchainCI.height = static_cast<uint32_t>(desc.height);
+
+    XrCompositionLayerEquirect2KHR& equirect = layer.composition.equirect;
+    equirect = {XR_TYPE_COMPOSITION_LAYER_EQUIRECT2_KHR};
+    equirect.eyeVisibility = desc.eyeVisibility;
+    equirect.subImage.imageRect = {{0, 0}, {desc.width, desc.height}};
+    equirect.radius = desc.radius;
+    equirect.centralHorizontalAngle = desc.centralHorizontalAngle;
+    equirect.upperVerticalAngle = desc.upperVerticalAngle;
+    equirect.lowerVerticalAngle = desc.lowerVerticalAngle;
+
+    CreateSwapchain(layer);
+    return layer.id;
+}
+
+XrCompositionLayers::Layer& XrCompositionLayers::Add(int32_t order, XrLayerRenderFunction render)
+{
+    Layer layer;
+    layer.id = m_nextLayerId++;
+    layer.order = order;
+    layer.render = std::move(render);
+    layer.swapchainCI.usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+    layer.swapchainCI.sampleCount = 1;
+    layer.swapchainCI.faceCount = 1;
+    layer.swapchainCI.arraySize = 1;
+    layer.swapchainCI.mipCount = 1;
+
+    auto it = std::upper_bound(m_layers.begin(), m_layers.end(), order,
+                               [](int32_t value, const Layer& other) { return value < other.order; });
+    return *m_layers.insert(it, std::move(layer));
+}
+
+void XrCompositionLayers::RemoveLayer(uint32_t layerId)
+{
+    Layer* layer = Find(layerId);
+    if (layer == nullptr)
+    {
+        return;
+    }
+    DestroySwapchain(*layer);
+    m_layers.erase(m_layers.begin() + (layer - m_layers.data()));
+}
+
+void XrCompositionLayers::MarkDirty(uint32_t layerId)
+{
+    if (Layer* layer = Find(layerId))
+    {
+        layer->dirty = true;
+    }
+}
+
+void XrCompositionLayers::SetPose(uint32_t layerId, const XrPosef& pose)
+{
+    if (Layer* layer = Find(layerId))
+    {
+        layer->pose = pose;
+    }
+}
+
+void XrCompositionLayers::SetFill(uint32_t layerId, float fill)
+{
+    if (Layer* layer = Find(layerId))
+    {
+        layer->fill = std::clamp(fill, 0.0f, 1.0f);
+    }
+}
+
+void XrCompositionLayers::SetVisible(uint32_t layerId, bool visible)
+{
+    if (Layer* layer = Find(layerId))
+    {
+        layer->visible = visible;
+    }
+}
+
+bool XrCompositionLayers::UploadImage(uint32_t layerId, const void* pixels, uint32_t rowPitch)
+{
+    Layer* layer = Find(layerId);
+    if (layer == nullptr || layer->swapchain == XR_NULL_HANDLE || layer->staticImage)
+    {
+        return false;
+    }
+
+    XR_TRACE_SCOPE("UploadLayerImage");
+    XrRenderTarget target;
+    if (!AcquireImage(*layer, target))
+    {
+        return false;
+    }
+    const bool uploaded = m_backend->UploadToRenderTarget(target, pixels, rowPitch);
+    ReleaseImage(*layer);
+    // The released image is submitted from now on, a failed upload hides the layer.
+    layer->hasContent = uploaded;
+    layer->dirty = false;
+    return uploaded;
+}
+
+XrCompositionLayers::Layer* XrCompositionLayers::Find(uint32_t layerId)
+{
+    auto it = std::find_if(m_layers.begin(), m_layers.end(), [layerId](const Layer& layer) { return layer.id == layerId; });
+    return it != m_layers.end() ? &*it : nullptr;
+}
+
+void XrCompositionLayers::SetEnabledExtensions(const std::vector<const char*>& instanceExtensions)
+{
+    auto enabled = [&instanceExtensions](const char* name)
+    {
+        return std::any_of(instanceExtensions.begin(), instanceExtensions.end(),
+                           [name](const char* extension) { return strcmp(extension, name) == 0; });
+    };
+    m_cubeSupported = enabled(XR_KHR_COMPOSITION_LAYER_CUBE_EXTENSION_NAME);
+    m_cylinderSupported = enabled(XR_KHR_COMPOSITION_LAYER_CYLINDER_EXTENSION_NAME);
+    m_equirectSupported = enabled(XR_KHR_COMPOSITION_LAYER_EQUIRECT2_EXTENSION_NAME);
+}
+
+bool XrCompositionLayers::IsSupported(XrStructureType layerType) const
+{
+    switch (layerType)
+    {
+        case XR_TYPE_COMPOSITION_LAYER_QUAD:
+            return true;
+        case XR_TYPE_COMPOSITION_LAYER_CUBE_KHR:
+            return m_cubeSupported;
+        case XR_TYPE_COMPOSITION_LAYER_CYLINDER_KHR:
+            return m_cylinderSupported;
+        case XR_TYPE_COMPOSITION_LAYER_EQUIRECT2_KHR:
+            return m_equirectSupported;
+        default:
+            return false;
+    }
+}
+
+bool XrCompositionLayers::HasBackground() const
+{
+    return std::any_of(m_layers.begin(), m_layers.end(),
+                       [](const Layer& layer) { return layer.order < 0 && layer.visible && layer.hasContent; });
+}
+
+void XrCompositionLayers::CreateSwapchains(XrSession session, XrGraphicsBackend& backend, int64_t colorFormat)
+{
+    m_session = session;
+    m_backend = &backend;
+    m_colorFormat = colorFormat;
+    for (Layer& layer : m_layers)
+    {
+        CreateSwapchain(layer);
+    }
+}
+
+void XrCompositionLayers::DestroySwapchains()
+{
+    for (Layer& layer : m_layers)
+    {
+        DestroySwapchain(layer);
+    }
+    m_session = XR_NULL_HANDLE;
+    m_backend = nullptr;
+}
+
+void XrCompositionLayers::CreateSwapchain(Layer& layer)
+{
+    // Created with the session when the layer was added before it.
+    if (m_session == XR_NULL_HANDLE || layer.swapchain != XR_NULL_HANDLE)
+    {
+        return;
+    }
+    if (!IsSupported(layer.composition.header.type))
+    {
+        XR_TUT_LOG_ERROR("Composition layer " << layer.id << " is not supported by the runtime and is not submitted.");
+        return;
+    }
+
+    layer.swapchainCI.format = m_colorFormat;
+    OPENXR_CHECK(xrCreateSwapchain(m_session, &layer.swapchainCI, &layer.swapchain), "Failed to create the layer Swapchain");
+    if (layer.swapchain == XR_NULL_HANDLE)
+    {
+        return;
+    }
+    m_backend->EnumerateSwapchainImages(layer.swapchain, layer.images);
+    layer.dirty = true;
+    layer.hasContent = false;
+}
+
+void XrCompositionLayers::DestroySwapchain(Layer& layer)
+{
+    if (layer.swapchain == XR_NULL_HANDLE)
+    {
+        return;
+    }
+    m_backend->ReleaseSwapchainImages(layer.images);
+    OPENXR_CHECK(xrDestroySwapchain(layer.swapchain), "Failed to destroy the layer Swapchain");
+    layer.swapchain = XR_NULL_HANDLE;
+    layer.images.clear();
+    layer.hasContent = false;
+}
+
+void XrCompositionLayers::RenderDirtyLayers()
+{
+    XR_TRACE_SCOPE("CompositionLayers");
+    for (Layer& layer : m_layers)
+    {
+        if (!layer.dirty || !layer.visible || layer.swapchain == XR_NULL_HANDLE || !layer.render)
+        {
+            continue;
+        }
+        // A static image cannot be acquired twice, new content needs a new swapchain.
+        if (layer.staticImage && layer.hasContent)
+        {
+            DestroySwapchain(layer);
+            CreateSwapchain(layer);
+        }
+        RenderLayer(layer);
+    }
+}
+
+void XrCompositionLayers::RenderLayer(Layer& layer)
+{
+    XrRenderTarget target;
+    if (!AcquireImage(layer, target))
+    {
+        return;
+    }
+    layer.render(target);
+    ReleaseImage(layer);
+    layer.dirty = false;
+    layer.hasContent = true;
+}
+
+bool XrCompositionLayers::AcquireImage(Layer& layer, XrRenderTarget& target)
+{
+    uint32_t imageIndx = 0;
+    XrSwapchainImageAcquireInfo acquireInfo{XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+    if (XR_FAILED(xrAcquireSwapchainImage(layer.swapchain, &acquireInfo, &imageIndx)))
+    {
+        XR_TUT_LOG_ERROR("Failed to acquire Image from the Swapchain of layer " << layer.id);
+        return false;
+    }
+    XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+    waitInfo.timeout = XR_INFINITE_DURATION;
+    OPENXR_CHECK(xrWaitSwapchainImage(layer.swapchain, &waitInfo), "Failed to wait for Image from the layer Swapchain");
+
+    target.swapchainImageIndx = imageIndx;
+    target.image = imageIndx < layer.images.size() ? layer.images[imageIndx] : 0;
+    target.format = layer.swapchainCI.format;
+    target.width = static_cast<int32_t>(layer.swapchainCI.width);
+    target.height = static_cast<int32_t>(layer.swapchainCI.height);
+    return true;
+}
+
+void XrCompositionLayers::ReleaseImage(Layer& layer)
+{
+    XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+    OPENXR_CHECK(xrReleaseSwapchainImage(layer.swapchain, &releaseInfo), "Failed to release Image back to the layer Swapchain");
+}
+
+void XrCompositionLayers::AppendLayers(std::vector<XrCompositionLayerBaseHeader*>& layers, bool background,
+                                       const XrReferenceSpace& referenceSpace)
+{
+    for (Layer& layer : m_layers)
+    {
+        if ((layer.order < 0) == background)
+        {
+            AppendLayer(layers, layer, referenceSpace);
+        }
+    }
+}
+
+void XrCompositionLayers::AppendLayers(std::vector<XrCompositionLayerBaseHeader*>& layers, const std::vector<uint32_t>& layerIds,
+                                       const XrReferenceSpace& referenceSpace)
+{
+    for (uint32_t layerId : layerIds)
+    {
+        if (Layer* layer = Find(layerId))
+        {
+            AppendLayer(layers, *layer, referenceSpace);
+        }
+    }
+}
+
+void XrCompositionLayers::AppendLayer(std::vector<XrCompositionLayerBaseHeader*>& layers, Layer& layer,
+                                      const XrReferenceSpace& referenceSpace)
+{
+    if (!layer.visible || !layer.hasContent || layer.fill <= 0.0f)
+    {
+        return;
+    }
+
+    XrSpace space = layer.space == XrLayerSpace::Head ? referenceSpace.GetViewSpace() : referenceSpace.GetSpace();
+    XrPosef pose = layer.space == XrLayerSpace::Head ? layer.pose : referenceSpace.FromApplicationSpace(layer.pose);
+    switch (layer.composition.header.type)
+    {
+        case XR_TYPE_COMPOSITION_LAYER_QUAD:
+        {
+            XrCompositionLayerQuad& quad = layer.composition.quad;
+            // The left part of the image on the left part of the quad, the center moves along its x axis.
+            quad.size.width = layer.size.width * layer.fill;
+            quad.subImage.imageRect.extent.width = std::max(1, static_cast<int32_t>(layer.swapchainCI.width * layer.fill));
+            const XrVector3f offset = RotateVector(pose.orientation, {(quad.size.width - layer.size.width) * 0.5f, 0.0f, 0.0f});
+            pose.position = {pose.position.x + offset.x, pose.position.y + offset.y, pose.position.z + offset.z};
+            quad.space = space;
+            quad.pose = pose;
+            quad.subImage.swapchain = layer.swapchain;
+            break;
+        }
+        case XR_TYPE_COMPOSITION_LAYER_CUBE_KHR:
+        {
+            XrCompositionLayerCubeKHR& cube = layer.composition.cube;
+            cube.space = space;
+            cube.orientation = pose.orientation;
+            cube.swapchain = layer.swapchain;
+            break;
+        }
+        case XR_TYPE_COMPOSITION_LAYER_CYLINDER_KHR:
+        {
+            XrCompositionLayerCylinderKHR& cylinder = layer.composition.cylinder;
+            cylinder.space = space;
+            cylinder.pose = pose;
+            cylinder.subImage.swapchain = layer.swapchain;
+            break;
+        }
+        case XR_TYPE_COMPOSITION_LAYER_EQUIRECT2_KHR:
+        {
+            XrCompositionLayerEquirect2KHR& equirect = layer.composition.equirect;
+            equirect.space = space;
+            equirect.pose = pose;
+            equirect.subImage.swapchain = layer.swapchain;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+    layers.push_back(&layer.composition.header);
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "openxr.h"
+#include "XrGraphicsBackend.h"
+#include "XrReferenceSpace.h"
+#include "XrRenderer.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+// Space a layer is placed in. World poses are in the recentered application space, Head poses are
+// relative to the head and follow it.
+enum class XrLayerSpace
+{
+    World,
+    Head
+};
+
+// Draws the content of a layer into its acquired swapchain image. Only called after the layer was
+// created or marked dirty, on the render thread. target.image is a GL texture (the backend's
+// GetRenderTarget() wraps it in a framebuffer) or a VkImage in COLOR_ATTACHMENT_OPTIMAL whose work
+// has to be submitted before the function returns.
+using XrLayerRenderFunction = std::function<void(const XrRenderTarget& target)>;
+
+// Flat rectangle composited by the runtime (XrCompositionLayerQuad), e.g. a menu or a HUD.
+struct XrQuadLayerDesc
+{
+    XrLayerSpace space = XrLayerSpace::World;
+    XrPosef pose = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 1.5f, -1.0f}};
+    XrExtent2Df size = {1.0f, 0.5f};   // Meters
+    int32_t width = 1024;               // Pixels of the layer swapchain
+    int32_t height = 512;
+    XrEyeVisibility eyeVisibility = XR_EYE_VISIBILITY_BOTH;
+    // Layers with a negative order are composited below the projection layer, the others above it,
+    // in increasing order.
+    int32_t order = 1;
+};
+
+// Sky box composited by the runtime at display rate (XR_KHR_composition_layer_cube). The cube map is
+// uploaded once into a static swapchain: the render function receives a GL_TEXTURE_CUBE_MAP or a
+// VkImage with 6 layers (+X, -X, +Y, -Y, +Z, -Z) and is called again only after MarkDirty(), which
+// re-creates the swapchain. While it has content BeeXrRenderer skips the sky of the main pass and
+// clears to alpha 0, see HasBackground().
+struct XrCubeLayerDesc
+{
+    XrLayerSpace space = XrLayerSpace::World;
+    XrQuaternionf orientation = {0.0f, 0.0f, 0.0f, 1.0f};
+    int32_t faceSize = 1024;            // Pixels of each face
+    XrEyeVisibility eyeVisibility = XR_EYE_VISIBILITY_BOTH;
+    int32_t order = -1;
+};
+
+// Curved screen (XR_KHR_composition_layer_cylinder), e.g. a theater screen. pose is the center of the
+// cylinder, the image covers centralAngle radians of it.
+struct XrCylinderLayerDesc
+{
+    XrLayerSpace space = XrLayerSpace::World;
+    XrPosef pose = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 1.5f, 0.0f}};
+    float radius = 3.0f;                // Meters
+    float centralAngle = 1.57f;         // Radians
+    int32_t width = 1920;
+    int32_t height = 1080;
+    XrEyeVisibility eyeVisibility = XR_EYE_VISIBILITY_BOTH;
+    int32_t order = 1;
+};
+
+// Equirectangular image on a sphere (XR_KHR_composition_layer_equirect2), e.g. 360 video. A radius of
+// 0 places the sphere at infinity. Stereo video uses one layer per eye (eyeVisibility).
+struct XrEquirectLayerDesc
+{
+    XrLayerSpace space = XrLayerSpace::World;
+    XrPosef pose = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
+    float radius = 0.0f;
+    float centralHorizontalAngle = 6.2831853f;
+    float upperVerticalAngle = 1.5707963f;
+    float lowerVerticalAngle = -1.5707963f;
+    int32_t width = 3840;
+    int32_t height = 1920;
+    XrEyeVisibility eyeVisibility = XR_EYE_VISIBILITY_BOTH;
+    int32_t order = -1;
+};
+
+
+// Composition layers submitted with the projection layer. Every layer has its own swapchain and is
+// only rendered when its content changed (MarkDirty()); otherwise the last released image is submitted
+// again, which costs the application nothing but the layer struct.
+//
+// The swapchains live as long as the session, a re-created session re-renders every layer.
+// Everything runs on the render thread, or on the loading thread between OpenxrPlugIn::BeginLoading()
+// and EndLoading().
+class XrCompositionLayers
+{
+public:
+    ~XrCompositionLayers();
+
+    // Returns an id for the calls below.
+    uint32_t AddQuadLayer(const XrQuadLayerDesc& desc, XrLayerRenderFunction render);
+    // Submitted only when the runtime has XR_KHR_composition_layer_cube, see IsSupported().
+    uint32_t AddCubeLayer(const XrCubeLayerDesc& desc, XrLayerRenderFunction upload);
+    // Without a render function the content is streamed with UploadImage().
+    uint32_t AddCylinderLayer(const XrCylinderLayerDesc& desc, XrLayerRenderFunction render = nullptr);
+    uint32_t AddEquirectLayer(const XrEquirectLayerDesc& desc, XrLayerRenderFunction render = nullptr);
+    void RemoveLayer(uint32_t layerId);
+    void MarkDirty(uint32_t layerId);
+    void SetPose(uint32_t layerId, const XrPosef& pose);
+    void SetVisible(uint32_t layerId, bool visible);
+    // Shows the left part (0 to 1) of a quad and of its image, e.g. a progress bar.
+    void SetFill(uint32_t layerId, float fill);
+    // Streams a decoded frame (RGBA8, the size of the layer, rows rowPitch bytes apart) into the next
+    // image of the layer, through XrGraphicsBackend::UploadToRenderTarget(). Render thread, the pixels
+    // are copied before it returns. Returns false when the backend has no streaming upload (Vulkan).
+    bool UploadImage(uint32_t layerId, const void* pixels, uint32_t rowPitch);
+
+    // Layer types of optional extensions are available once the instance enabled them.
+    void SetEnabledExtensions(const std::vector<const char*>& instanceExtensions);
+    bool IsSupported(XrStructureType layerType) const;
+    // A layer below the projection layer has content: the renderer can skip its sky and clear to alpha 0.
+    bool HasBackground() const;
+
+    // Session objects, called by the plug-in with the swapchains of the projection layer.
+    void CreateSwapchains(XrSession session, XrGraphicsBackend& backend, int64_t colorFormat);
+    void DestroySwapchains();
+
+    // Per frame: renders the dirty layers, then appends the layers below (background) or above the
+    // projection layer. The structs stay valid until the next frame.
+    void RenderDirtyLayers();
+    void AppendLayers(std::vector<XrCompositionLayerBaseHeader*>& layers, bool background, const XrReferenceSpace& referenceSpace);
+    // Only these layers, in this order, for frames without the projection layer (loading screen).
+    void AppendLayers(std::vector<XrCompositionLayerBaseHeader*>& layers, const std::vector<uint32_t>& layerIds,
+                      const XrReferenceSpace& referenceSpace);
+
+private:
+    union LayerStruct
+    {
+        XrCompositionLayerBaseHeader header;
+        XrCompositionLayerQuad quad;
+        XrCompositionLayerCubeKHR cube;
+        XrCompositionLayerCylinderKHR cylinder;
+        XrCompositionLayerEquirect2KHR equirect;
+    };
+
+    struct Layer
+    {
+        uint32_t id = 0;
+        int32_t order = 0;
+        bool visible = true;
+        XrLayerSpace space = XrLayerSpace::World;
+        XrPosef pose = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
+        XrExtent2Df size = {0.0f, 0.0f};   // Quads, at a fill of 1
+        float fill = 1.0f;
+        XrLayerRenderFunction render;
+        // Created with XR_SWAPCHAIN_CREATE_STATIC_IMAGE_BIT, the image can be acquired only once.
+        bool staticImage = false;
+
+        XrSwapchainCreateInfo swapchainCI = {XR_TYPE_SWAPCHAIN_CREATE_INFO};
+        XrSwapchain swapchain = XR_NULL_HANDLE;
+        std::vector<uint64_t> images;
+        bool dirty = true;
+        // An image was released, the layer can be submitted.
+        bool hasContent = false;
+
+        LayerStruct composition = {};
+    };
+
+    Layer* Find(uint32_t layerId);
+    Layer& Add(int32_t order, XrLayerRenderFunction render);
+    void CreateSwapchain(Layer& layer);
+    void DestroySwapchain(Layer& layer);
+    void RenderLayer(Layer& layer);
+    void AppendLayer(std::vector<XrCompositionLayerBaseHeader*>& layers, Layer& layer, const XrReferenceSpace& referenceSpace);
+    bool AcquireImage(Layer& layer, XrRenderTarget& target);
+    void ReleaseImage(Layer& layer);
+
+    // Sorted by order, so the layers go to xrEndFrame in order.
+    std::vector<Layer> m_layers;
+    uint32_t m_nextLayerId = 1;
+
+    bool m_cubeSupported = false;
+    bool m_cylinderSupported = false;
+    bool m_equirectSupported = false;
+
+    XrSession m_session = XR_NULL_HANDLE;
+    XrGraphicsBackend* m_backend = nullptr;
+    int64_t m_colorFormat = 0;
+};
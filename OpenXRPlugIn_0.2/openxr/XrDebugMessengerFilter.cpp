@@ -0,0 +1,254 @@
+#include "XrDebugMessengerFilter.h"
+
+#include "DebugOutput.h"
+#include "HelperFunctions.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+
+namespace
+{
+
+uint64_t HashString(const char* text)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (; text != nullptr && *text != '\0'; text++)
+    {
+        hash ^= static_cast<uint8_t>(*text);
+        hash *= 1099511628211ull;
+    }
+    return hash != 0 ? hash : 1;  // 0 marks an empty slot
+}
+
+// Appends the names of the set bits, comma separated, into a fixed buffer.
+template <size_t Size>
+const char* FlagNames(char (&buffer)[Size], uint64_t flags, const std::pair<uint64_t, const char*>* names, size_t nameCount)
+{
+    size_t length = 0;
+    buffer[0] = '\0';
+    for (size_t i = 0; i < nameCount; i++)
+    {
+        if (!BitwiseCheck(flags, names[i].first))
+        {
+            continue;
+        }
+        length += snprintf(buffer + length, Size - length, "%s%s", length > 0 ? "," : "", names[i].second);
+        if (length >= Size)
+        {
+            break;
+        }
+    }
+    return buffer;
+}
+
+const std::pair<uint64_t, const char*> kSeverityNames[] = {
+    {XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT, "VERBOSE"},
+    {XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT, "INFO"},
+    {XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT, "WARN"},
+    {XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT, "ERROR"},
+};
+
+const std::pair<uint64_t, const char*> kTypeNames[] = {
+    {XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT, "GEN"},
+    {XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT, "SPEC"},
+    {XR_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT, "PERF"},
+    {XR_DEBUG_UTILS_MESSAGE_TYPE_CONFORMANCE_BIT_EXT, "CONF"},
+};
+
+}  // namespace
+
+
+XrDebugMessengerFilter::~XrDebugMessengerFilter()
+{
+    FlushSuppressed(true);
+}
+
+XrDebugUtilsMessageSeverityFlagsEXT XrDebugMessengerFilter::GetSubscribedSeverities() const
+{
+    if (m_settings.countAllPerformanceMessages)
+    {
+        return XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
+               XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    }
+    return m_settings.severities;
+}
+
+XrDebugUtilsMessageTypeFlagsEXT XrDebugMessengerFilter::GetSubscribedTypes() const
+{
+    if (m_settings.countAllPerformanceMessages)
+    {
+        return m_settings.types | XR_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+    }
+    return m_settings.types;
+}
+
+XrBool32 XrDebugMessengerFilter::OnMessage(XrDebugUtilsMessageSeverityFlagsEXT severity,
+                                           XrDebugUtilsMessageTypeFlagsEXT types,
+                                           const XrDebugUtilsMessengerCallbackDataEXT* data)
+{
+    if (BitwiseCheck(types, static_cast<XrDebugUtilsMessageTypeFlagsEXT>(XR_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT)))
+    {
+        m_performance.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Messages only subscribed to for the performance count end here, before any formatting.
+    if ((severity & m_settings.severities) == 0 || (types & m_settings.types) == 0)
+    {
+        return XR_FALSE;
+    }
+
+    if (BitwiseCheck(severity, static_cast<XrDebugUtilsMessageSeverityFlagsEXT>(XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)))
+        m_error.fetch_add(1, std::memory_order_relaxed);
+    else if (BitwiseCheck(severity, static_cast<XrDebugUtilsMessageSeverityFlagsEXT>(XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)))
+        m_warning.fetch_add(1, std::memory_order_relaxed);
+    else if (BitwiseCheck(severity, static_cast<XrDebugUtilsMessageSeverityFlagsEXT>(XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)))
+        m_info.fetch_add(1, std::memory_order_relaxed);
+    else
+        m_verbose.fetch_add(1, std::memory_order_relaxed);
+
+    const char* functionName = data->functionName ? data->functionName : "";
+    const char* messageId = data->messageId ? data->messageId : "";
+    const char* message = data->message ? data->message : "";
+
+    if (!Admit(severity, messageId, message))
+    {
+        m_suppressed.fetch_add(1, std::memory_order_relaxed);
+        return XR_FALSE;
+    }
+    m_logged.fetch_add(1, std::memory_order_relaxed);
+
+    char severityNames[32];
+    char typeNames[32];
+    XR_TUT_LOG_ERROR(functionName << "(" << FlagNames(severityNames, severity, kSeverityNames, std::size(kSeverityNames))
+                                  << " / " << FlagNames(typeNames, types, kTypeNames, std::size(kTypeNames))
+                                  << "): msgNum: " << messageId << " - " << message);
+
+    if (m_settings.breakOnError &&
+        BitwiseCheck(severity, static_cast<XrDebugUtilsMessageSeverityFlagsEXT>(XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)))
+    {
+        DEBUG_BREAK;
+    }
+    return XR_FALSE;
+}
+
+bool XrDebugMessengerFilter::Admit(XrDebugUtilsMessageSeverityFlagsEXT severity, const char* messageId, const char* message)
+{
+    const uint64_t idHash = HashString(messageId);
+    const uint64_t messageHash = HashString(message);
+    const auto now = std::chrono::steady_clock::now();
+    const uint32_t kMaxProbes = 8;
+
+    std::lock_guard<std::mutex> lock(m_idMutex);
+
+    // Find the id, or take an empty slot, or evict the probed slot with the oldest window.
+    IdState* state = nullptr;
+    IdState* oldest = nullptr;
+    for (uint32_t probe = 0; probe < kMaxProbes; probe++)
+    {
+        IdState& slot = m_ids[(idHash + probe) & (kIdSlots - 1)];
+        if (slot.idHash == idHash || slot.idHash == 0)
+        {
+            state = &slot;
+            break;
+        }
+        if (oldest == nullptr || slot.windowStart < oldest->windowStart)
+        {
+            oldest = &slot;
+        }
+    }
+    if (state == nullptr || state->idHash != idHash)
+    {
+        state = state != nullptr ? state : oldest;
+        ReportSuppressed(*state);
+        *state = IdState();
+        state->idHash = idHash;
+        state->windowStart = now;
+        strncpy(state->messageId, messageId, kMaxIdLength - 1);
+    }
+
+    if (now - state->windowStart >= m_settings.rateLimitWindow)
+    {
+        ReportSuppressed(*state);
+        state->windowStart = now;
+        state->logged = 0;
+    }
+
+    bool duplicate = m_settings.deduplicate && state->logged > 0 && state->lastMessageHash == messageHash;
+    if (duplicate || state->logged >= m_settings.maxMessagesPerId)
+    {
+        if (state->suppressed++ == 0)
+        {
+            m_pendingReports.fetch_add(1, std::memory_order_relaxed);
+        }
+        state->suppressedSeverity = std::max(state->suppressedSeverity, severity);
+        return false;
+    }
+    state->logged++;
+    state->lastMessageHash = messageHash;
+    return true;
+}
+
+void XrDebugMessengerFilter::ReportSuppressed(IdState& state)
+{
+    if (state.suppressed == 0)
+    {
+        return;
+    }
+    // Logged like the messages it stands for: warnings and errors as errors, the rest as info.
+    if (state.suppressedSeverity >= XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+    {
+        XR_TUT_LOG_ERROR("msgNum: " << state.messageId << " - " << state.suppressed << " similar messages suppressed");
+    }
+    else
+    {
+        XR_TUT_LOG("msgNum: " << state.messageId << " - " << state.suppressed << " similar messages suppressed");
+    }
+    state.suppressed = 0;
+    state.suppressedSeverity = 0;
+    m_pendingReports.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void XrDebugMessengerFilter::FlushSuppressed(bool force)
+{
+    if (m_pendingReports.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_idMutex);
+    for (IdState& state : m_ids)
+    {
+        if (force || now - state.windowStart >= m_settings.rateLimitWindow)
+        {
+            ReportSuppressed(state);
+        }
+    }
+}
+
+XrDebugMessengerStats XrDebugMessengerFilter::GetStats() const
+{
+    XrDebugMessengerStats stats;
+    stats.verbose = m_verbose.load(std::memory_order_relaxed);
+    stats.info = m_info.load(std::memory_order_relaxed);
+    stats.warning = m_warning.load(std::memory_order_relaxed);
+    stats.error = m_error.load(std::memory_order_relaxed);
+    stats.performance = m_performance.load(std::memory_order_relaxed);
+    stats.logged = m_logged.load(std::memory_order_relaxed);
+    stats.suppressed = m_suppressed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void XrDebugMessengerFilter::ResetStats()
+{
+    m_verbose.store(0, std::memory_order_relaxed);
+    m_info.store(0, std::memory_order_relaxed);
+    m_warning.store(0, std::memory_order_relaxed);
+    m_error.store(0, std::memory_order_relaxed);
+    m_performance.store(0, std::memory_order_relaxed);
+    m_logged.store(0, std::memory_order_relaxed);
+    m_suppressed.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "openxr.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+
+// Which XR_EXT_debug_utils messages get logged, and how often.
+struct XrDebugMessengerSettings
+{
+    XrDebugUtilsMessageSeverityFlagsEXT severities =
+        XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    XrDebugUtilsMessageTypeFlagsEXT types =
+        XR_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+        XR_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_TYPE_CONFORMANCE_BIT_EXT;
+
+    // Messages logged per message id and window, the rest are counted and summarized when the window ends,
+    // at the highest severity among them.
+    uint32_t maxMessagesPerId = 5;
+    std::chrono::milliseconds rateLimitWindow = std::chrono::milliseconds(1000);
+    // A message identical to the previous one with the same id is never logged twice within a window.
+    bool deduplicate = true;
+
+    // Also receives performance messages below the logged severities, to count them. Off by default: one
+    // messenger cannot widen the severities for a single type, so every type is then delivered at every
+    // severity and dropped in the callback.
+    bool countAllPerformanceMessages = false;
+    bool breakOnError = true;
+};
+
+struct XrDebugMessengerStats
+{
+    uint64_t verbose = 0;
+    uint64_t info = 0;
+    uint64_t warning = 0;
+    uint64_t error = 0;
+    // XR_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT messages of any severity.
+    uint64_t performance = 0;
+    uint64_t logged = 0;
+    uint64_t suppressed = 0;
+};
+
+
+// State behind the debug utils messenger callback (OpenXRDebugUtils.h): filters the messages by
+// severity and type, rate limits and deduplicates them per message id and formats the survivors
+// straight into the log without building intermediate strings.
+class XrDebugMessengerFilter
+{
+public:
+    ~XrDebugMessengerFilter();
+
+    void SetSettings(const XrDebugMessengerSettings& settings) { m_settings = settings; }
+    const XrDebugMessengerSettings& GetSettings() const { return m_settings; }
+
+    // Masks to create the messenger with, wider than the logged ones when performance messages are counted.
+    XrDebugUtilsMessageSeverityFlagsEXT GetSubscribedSeverities() const;
+    XrDebugUtilsMessageTypeFlagsEXT GetSubscribedTypes() const;
+
+    XrBool32 OnMessage(XrDebugUtilsMessageSeverityFlagsEXT severity,
+                       XrDebugUtilsMessageTypeFlagsEXT types,
+                       const XrDebugUtilsMessengerCallbackDataEXT* data);
+
+    // Logs the suppression summaries of the windows that ended without another message of their id, or
+    // of every window with force. Called every frame by the plug-in and when the messenger is destroyed.
+    void FlushSuppressed(bool force = false);
+
+    XrDebugMessengerStats GetStats() const;
+    void ResetStats();
+
+private:
+    // Open addressed table of the recently seen message ids, fixed size so the callback never allocates.
+    static constexpr uint32_t kIdSlots = 256;
+    // Message ids longer than this are truncated in the summaries.
+    static constexpr uint32_t kMaxIdLength = 64;
+
+    struct IdState
+    {
+        uint64_t idHash = 0;
+        uint64_t lastMessageHash = 0;
+        std::chrono::steady_clock::time_point windowStart;
+        uint32_t logged = 0;
+        uint32_t suppressed = 0;
+        XrDebugUtilsMessageSeverityFlagsEXT suppressedSeverity = 0;   // Highest severity suppressed
+        char messageId[kMaxIdLength] = {};
+    };
+
+    // Decides under m_idMutex whether the message gets logged.
+    bool Admit(XrDebugUtilsMessageSeverityFlagsEXT severity, const char* messageId, const char* message);
+    // Logs and clears the suppression count of a slot, under m_idMutex.
+    void ReportSuppressed(IdState& state);
+
+    XrDebugMessengerSettings m_settings;
+
+    std::mutex m_idMutex;
+    IdState m_ids[kIdSlots];
+    // Slots with an unreported suppression count, lets FlushSuppressed() return without the lock.
+    std::atomic<uint32_t> m_pendingReports{0};
+
+    std::atomic<uint64_t> m_verbose{0};
+    std::atomic<uint64_t> m_info{0};
+    std::atomic<uint64_t> m_warning{0};
+    std::atomic<uint64_t> m_error{0};
+    std::atomic<uint64_t> m_performance{0};
+    std::atomic<uint64_t> m_logged{0};
+    std::atomic<uint64_t> m_suppressed{0};
+};
@@ -0,0 +1,101 @@
+#include "XrEventBus.h"
+
+#include <algorithm>
+
+
+uint32_t XrEventBus::Add(XrStructureType type, Delivery deliver)
+{
+    Subscription subscription;
+    subscription.id = m_nextSubscriptionId++;
+    subscription.deliver = std::move(deliver);
+    const uint32_t id = subscription.id;
+    if (m_dispatchDepth > 0)
+    {
+        m_pending.push_back({type, std::move(subscription)});
+    }
+    else
+    {
+        m_subscriptions[type].push_back(std::move(subscription));
+    }
+    return id;
+}
+
+void XrEventBus::Unsubscribe(uint32_t subscriptionId)
+{
+    auto pending = std::find_if(m_pending.begin(), m_pending.end(),
+                                [subscriptionId](const PendingSubscription& entry) { return entry.subscription.id == subscriptionId; });
+    if (pending != m_pending.end())
+    {
+        m_pending.erase(pending);
+        return;
+    }
+
+    for (auto& [type, subscriptions] : m_subscriptions)
+    {
+        for (Subscription& subscription : subscriptions)
+        {
+            if (subscription.id == subscriptionId)
+            {
+                subscription.removed = true;
+                if (m_dispatchDepth > 0)
+                {
+                    m_removedDuringDispatch = true;
+                }
+                else
+                {
+                    RemoveUnsubscribed();
+                }
+                return;
+            }
+        }
+    }
+}
+
+bool XrEventBus::Dispatch(const XrEventDataBuffer& event)
+{
+    auto it = m_subscriptions.find(event.type);
+    if (it == m_subscriptions.end() || it->second.empty())
+    {
+        return false;
+    }
+
+    m_dispatchDepth++;
+    for (const Subscription& subscription : it->second)
+    {
+        if (!subscription.removed)
+        {
+            subscription.deliver(event);
+        }
+    }
+    m_dispatchDepth--;
+
+    if (m_dispatchDepth == 0)
+    {
+        if (m_removedDuringDispatch)
+        {
+            RemoveUnsubscribed();
+            m_removedDuringDispatch = false;
+        }
+        AddPending();
+    }
+    return true;
+}
+
+void XrEventBus::AddPending()
+{
+    for (PendingSubscription& entry : m_pending)
+    {
+        m_subscriptions[entry.type].push_back(std::move(entry.subscription));
+    }
+    m_pending.clear();
+}
+
+void XrEventBus::RemoveUnsubscribed()
+{
+    for (auto& [type, subscriptions] : m_subscriptions)
+    {
+        subscriptions.erase(std::remove_if(subscriptions.begin(), subscriptions.end(),
+                                           [](const Subscription& subscription) { return subscription.removed; }),
+                            subscriptions.end());
+    }
+}
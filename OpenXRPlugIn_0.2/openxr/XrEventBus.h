@@ -0,0 +1,67 @@
+#pragma once
+
+#include "XrStructSerializer.h"
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+
+// Typed delivery of the events polled from the runtime. A system subscribes to one XrEventData* struct
+// and its handler receives the event already cast to it, e.g.
+//
+//   bus.Subscribe<XrEventDataInteractionProfileChanged>([](const XrEventDataInteractionProfileChanged& event) { ... });
+//
+// The handler lists are built by Subscribe(). Dispatch() looks up the list of the event type and calls
+// the handlers in subscription order, without allocating. Everything runs on the thread that polls
+// the events (the render thread).
+class XrEventBus
+{
+public:
+    template <typename T>
+    using Handler = std::function<void(const T& event)>;
+
+    // Returns an id for Unsubscribe(). A handler subscribed during a dispatch gets the next event on.
+    template <typename T>
+    uint32_t Subscribe(Handler<T> handler)
+    {
+        static_assert(XrStructReflection<T>::kReflected && XrStructReflection<T>::kType != XR_TYPE_UNKNOWN,
+                      "Subscribe to an XrEventData struct with a type member");
+        static_assert(sizeof(T) <= sizeof(XrEventDataBuffer), "Not an event struct");
+        return Add(XrStructReflection<T>::kType,
+                   [handler = std::move(handler)](const XrEventDataBuffer& event) { handler(reinterpret_cast<const T&>(event)); });
+    }
+    // Safe from inside a handler, also for the handler itself.
+    void Unsubscribe(uint32_t subscriptionId);
+
+    // Delivers one polled event. Returns false when nothing subscribed to its type.
+    bool Dispatch(const XrEventDataBuffer& event);
+
+private:
+    using Delivery = std::function<void(const XrEventDataBuffer& event)>;
+
+    struct Subscription
+    {
+        uint32_t id = 0;
+        bool removed = false;
+        Delivery deliver;
+    };
+
+    struct PendingSubscription
+    {
+        XrStructureType type = XR_TYPE_UNKNOWN;
+        Subscription subscription;
+    };
+
+    uint32_t Add(XrStructureType type, Delivery deliver);
+    void AddPending();
+    void RemoveUnsubscribed();
+
+    std::unordered_map<XrStructureType, std::vector<Subscription>> m_subscriptions;
+    uint32_t m_nextSubscriptionId = 1;
+
+    // The lists cannot change while a handler runs, changes made by handlers are applied afterwards.
+    uint32_t m_dispatchDepth = 0;
+    std::vector<PendingSubscription> m_pending;
+    bool m_removedDuringDispatch = false;
+};
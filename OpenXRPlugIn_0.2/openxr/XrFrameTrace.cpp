@@ -0,0 +1,266 @@
+#include "XrFrameTrace.h"
+
+#include "DebugOutput.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+
+
+namespace
+{
+
+uint64_t NowNs()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+const char* PhaseName(XrFrameTrace::Phase phase)
+{
+    switch (phase)
+    {
+    case XrFrameTrace::Phase::Begin:
+        return "B";
+    case XrFrameTrace::Phase::End:
+        return "E";
+    default:
+        return "i";
+    }
+}
+
+// Names are literals chosen by the plug-in, only quotes and backslashes need escaping.
+void WriteJsonString(FILE* file, const char* text)
+{
+    fputc('"', file);
+    for (; *text != '\0'; text++)
+    {
+        if (*text == '"' || *text == '\\')
+        {
+            fputc('\\', file);
+        }
+        fputc(*text, file);
+    }
+    fputc('"', file);
+}
+
+}  // namespace
+
+
+XrFrameTrace& XrFrameTrace::Get()
+{
+    static XrFrameTrace trace;
+    return trace;
+}
+
+XrFrameTrace::~XrFrameTrace()
+{
+    m_recording.store(false, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_dumpMutex);
+    if (m_dumpThread.joinable())
+    {
+        m_dumpThread.join();
+    }
+}
+
+void XrFrameTrace::Start(uint32_t capacity)
+{
+    Stop();
+
+    uint64_t size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    // The ring is only reallocated when its size changes, threads still finishing a scope of the previous
+    // recording keep writing into valid slots.
+    if (m_slots == nullptr || m_mask != size - 1)
+    {
+        m_slots.reset(new Slot[size]);
+        m_mask = size - 1;
+    }
+    for (uint64_t i = 0; i < size; i++)
+    {
+        m_slots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+    m_writeIndx.store(0, std::memory_order_relaxed);
+    m_startNs = NowNs();
+    m_recording.store(true, std::memory_order_release);
+}
+
+void XrFrameTrace::Stop()
+{
+    m_recording.store(false, std::memory_order_relaxed);
+}
+
+uint16_t XrFrameTrace::RegisterName(const char* name)
+{
+    std::lock_guard<std::mutex> lock(m_nameMutex);
+    for (size_t i = 0; i < m_names.size(); i++)
+    {
+        if (m_names[i] == name)
+        {
+            return static_cast<uint16_t>(i);
+        }
+    }
+    m_names.push_back(name);
+    return static_cast<uint16_t>(m_names.size() - 1);
+}
+
+void XrFrameTrace::SetFrame(uint64_t frameIndx, XrTime predictedDisplayTime)
+{
+    m_frameIndx.store(frameIndx, std::memory_order_relaxed);
+    m_predictedDisplayTime.store(predictedDisplayTime, std::memory_order_relaxed);
+}
+
+void XrFrameTrace::Record(uint16_t nameId, Phase phase)
+{
+    if (m_slots == nullptr)
+    {
+        return;
+    }
+
+    const uint64_t indx = m_writeIndx.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = m_slots[indx & m_mask];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.event.timestampNs = NowNs() - m_startNs;
+    slot.event.frameIndx = m_frameIndx.load(std::memory_order_relaxed);
+    slot.event.predictedDisplayTime = m_predictedDisplayTime.load(std::memory_order_relaxed);
+    slot.event.nameId = nameId;
+    slot.event.phase = phase;
+    slot.event.threadId = GetThreadId();
+
+    slot.sequence.store(indx + 1, std::memory_order_release);
+}
+
+uint32_t XrFrameTrace::GetThreadId()
+{
+    static std::atomic<uint32_t> s_nextThreadId{1};
+    thread_local uint32_t t_threadId = s_nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return t_threadId;
+}
+
+void XrFrameTrace::TakeSnapshot(std::vector<Event>& events, std::vector<const char*>& names)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_nameMutex);
+        names = m_names;
+    }
+    if (m_slots == nullptr)
+    {
+        return;
+    }
+
+    const uint64_t end = m_writeIndx.load(std::memory_order_acquire);
+    const uint64_t begin = end > m_mask + 1 ? end - (m_mask + 1) : 0;
+    events.reserve(static_cast<size_t>(end - begin));
+    for (uint64_t indx = begin; indx < end; indx++)
+    {
+        const Slot& slot = m_slots[indx & m_mask];
+        if (slot.sequence.load(std::memory_order_acquire) != indx + 1)
+        {
+            continue;
+        }
+        Event event = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != indx + 1)
+        {
+            continue;  // Overwritten while copying
+        }
+        events.push_back(event);
+    }
+}
+
+bool XrFrameTrace::WriteEvents(const std::string& path, const std::vector<Event>& events, const std::vector<const char*>& names)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        XR_TUT_LOG_ERROR("Failed to open frame trace file " << path);
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"OpenXR plug-in\"}}");
+    for (const Event& event : events)
+    {
+        fprintf(file, ",\n{\"name\":");
+        WriteJsonString(file, event.nameId < names.size() ? names[event.nameId] : "?");
+        fprintf(file, ",\"cat\":\"xr\",\"ph\":\"%s\",\"ts\":%" PRIu64 ".%03u,\"pid\":1,\"tid\":%u", PhaseName(event.phase),
+                event.timestampNs / 1000, static_cast<unsigned>(event.timestampNs % 1000), event.threadId);
+        if (event.phase == Phase::Instant)
+        {
+            fprintf(file, ",\"s\":\"p\"");
+        }
+        fprintf(file, ",\"args\":{\"frame\":%" PRIu64 ",\"predictedDisplayTime\":%" PRId64 "}}", event.frameIndx,
+                static_cast<int64_t>(event.predictedDisplayTime));
+    }
+    fprintf(file, "\n]}\n");
+
+    bool written = ferror(file) == 0;
+    written = fclose(file) == 0 && written;
+    if (!written)
+    {
+        XR_TUT_LOG_ERROR("Failed to write frame trace file " << path);
+    }
+    return written;
+}
+
+bool XrFrameTrace::WriteChromeTrace(const std::string& path)
+{
+    std::vector<Event> events;
+    std::vector<const char*> names;
+    TakeSnapshot(events, names);
+    bool written = WriteEvents(path, events, names);
+    if (written)
+    {
+        XR_TUT_LOG("Frame trace: " << events.size() << " events written to " << path);
+    }
+    return written;
+}
+
+void XrFrameTrace::SetMissedFrameDump(const std::string& pathPrefix, uint32_t maxDumps)
+{
+    std::lock_guard<std::mutex> lock(m_dumpMutex);
+    m_missedFrameDumpPrefix = pathPrefix;
+    m_maxDumps = maxDumps;
+    m_dumpCount = 0;
+}
+
+void XrFrameTrace::OnMissedFrame(uint64_t frameIndx)
+{
+    std::lock_guard<std::mutex> lock(m_dumpMutex);
+    if (m_missedFrameDumpPrefix.empty() || m_dumpCount >= m_maxDumps || !IsRecording())
+    {
+        return;
+    }
+    // One dump at a time: misses while the previous file is being written are part of the same stall.
+    if (m_dumpRunning.load(std::memory_order_acquire))
+    {
+        return;
+    }
+    if (m_dumpThread.joinable())
+    {
+        m_dumpThread.join();
+    }
+    m_dumpCount++;
+    m_dumpRunning.store(true, std::memory_order_relaxed);
+
+    // The copy is taken on the frame thread so the dump ends at the missed frame, formatting and file
+    // I/O happen on the dump thread.
+    std::vector<Event> events;
+    std::vector<const char*> names;
+    TakeSnapshot(events, names);
+    std::string path = m_missedFrameDumpPrefix + std::to_string(frameIndx) + ".json";
+    m_dumpThread = std::thread(
+        [this, path = std::move(path), events = std::move(events), names = std::move(names)]()
+        {
+            if (WriteEvents(path, events, names))
+            {
+                XR_TUT_LOG("Frame trace: missed frame, " << events.size() << " events written to " << path);
+            }
+            m_dumpRunning.store(false, std::memory_order_release);
+        });
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "openxr.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Timeline of the XR frame loop, exported as Chrome Trace Event JSON (chrome://tracing, ui.perfetto.dev).
+//
+// Events go into a fixed size ring of 32 byte records: no allocation and no formatting while recording,
+// and the ring always holds the most recent events. Every event carries the frame index and the predicted
+// display time of the frame being produced. WriteChromeTrace() dumps the ring on demand, and with
+// SetMissedFrameDump() the plug-in dumps it on its own when the runtime skips a display period.
+//
+// Recording is off until Start(); a disabled trace scope costs one relaxed load.
+class XrFrameTrace
+{
+public:
+    enum class Phase : uint8_t
+    {
+        Begin,
+        End,
+        Instant
+    };
+
+    // 32 bytes per event.
+    struct Event
+    {
+        uint64_t timestampNs = 0;  // Since Start()
+        uint64_t frameIndx = 0;
+        XrTime predictedDisplayTime = 0;
+        uint16_t nameId = 0;
+        Phase phase = Phase::Begin;
+        uint8_t reserved = 0;
+        uint32_t threadId = 0;
+    };
+
+    static XrFrameTrace& Get();
+
+    XrFrameTrace(const XrFrameTrace&) = delete;
+    XrFrameTrace& operator=(const XrFrameTrace&) = delete;
+
+    // capacity: events kept, rounded up to a power of two.
+    void Start(uint32_t capacity = 65536);
+    void Stop();
+    bool IsRecording() const { return m_recording.load(std::memory_order_relaxed); }
+
+    // Ids for string literals or other strings that outlive the trace. Call once per name, e.g. from a static.
+    uint16_t RegisterName(const char* name);
+
+    // Annotation copied into every following event.
+    void SetFrame(uint64_t frameIndx, XrTime predictedDisplayTime);
+    void Record(uint16_t nameId, Phase phase);
+
+    // Writes the events in the ring. Returns once the file is written.
+    bool WriteChromeTrace(const std::string& path);
+    // Dumps the ring to <pathPrefix><frame index>.json, written on a background thread, whenever
+    // OnMissedFrame() is called. An empty prefix disables it.
+    void SetMissedFrameDump(const std::string& pathPrefix, uint32_t maxDumps = 8);
+    void OnMissedFrame(uint64_t frameIndx);
+
+private:
+    // sequence is the index of the event + 1 once the slot is fully written, so a snapshot taken while
+    // other threads record skips the slots being overwritten.
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence{0};
+        Event event;
+    };
+
+    XrFrameTrace() = default;
+    ~XrFrameTrace();
+
+    void TakeSnapshot(std::vector<Event>& events, std::vector<const char*>& names);
+    static bool WriteEvents(const std::string& path, const std::vector<Event>& events, const std::vector<const char*>& names);
+    static uint32_t GetThreadId();
+
+    std::atomic<bool> m_recording{false};
+    std::unique_ptr<Slot[]> m_slots;
+    uint64_t m_mask = 0;
+    std::atomic<uint64_t> m_writeIndx{0};
+    uint64_t m_startNs = 0;
+
+    std::atomic<uint64_t> m_frameIndx{0};
+    std::atomic<int64_t> m_predictedDisplayTime{0};
+
+    std::mutex m_nameMutex;
+    std::vector<const char*> m_names;
+
+    std::mutex m_dumpMutex;
+    std::string m_missedFrameDumpPrefix;
+    uint32_t m_maxDumps = 0;
+    uint32_t m_dumpCount = 0;
+    std::atomic<bool> m_dumpRunning{false};
+    std::thread m_dumpThread;
+};
+
+// Begin and end event around a scope.
+class XrTraceScope
+{
+public:
+    explicit XrTraceScope(uint16_t nameId) : m_nameId(nameId), m_active(XrFrameTrace::Get().IsRecording())
+    {
+        if (m_active)
+        {
+            XrFrameTrace::Get().Record(m_nameId, XrFrameTrace::Phase::Begin);
+        }
+    }
+    ~XrTraceScope()
+    {
+        if (m_active)
+        {
+            XrFrameTrace::Get().Record(m_nameId, XrFrameTrace::Phase::End);
+        }
+    }
+
+    XrTraceScope(const XrTraceScope&) = delete;
+    XrTraceScope& operator=(const XrTraceScope&) = delete;
+
+private:
+    uint16_t m_nameId;
+    bool m_active;
+};
+
+#define XR_TRACE_CONCAT_INNER(a, b) a##b
+#define XR_TRACE_CONCAT(a, b) XR_TRACE_CONCAT_INNER(a, b)
+
+// XR_TRACE_SCOPE("name"): traces the enclosing scope. The name must be a string literal.
+#define XR_TRACE_SCOPE(name)                                                                            \
+    static const uint16_t XR_TRACE_CONCAT(xrTraceName, __LINE__) = XrFrameTrace::Get().RegisterName(name); \
+    XrTraceScope XR_TRACE_CONCAT(xrTraceScope, __LINE__)(XR_TRACE_CONCAT(xrTraceName, __LINE__))
+
+#define XR_TRACE_INSTANT(name)                                                                          \
+    do                                                                                                  \
+    {                                                                                                   \
+        static const uint16_t xrTraceName = XrFrameTrace::Get().RegisterName(name);                     \
+        if (XrFrameTrace::Get().IsRecording())                                                          \
+        {                                                                                               \
+            XrFrameTrace::Get().Record(xrTraceName, XrFrameTrace::Phase::Instant);                      \
+        }                                                                                               \
+    } while (0)
@@ -0,0 +1,17 @@
+#include "openxrPlugIn.h"
+#include "XrGraphicsBackend.h"
+
+#include "OpenGLXrGraphicsBackend.h"
+#if defined(BEE_XR_GRAPHICS_VULKAN)
+#include "VulkanXrGraphicsBackend.h"
+#endif
+
+
+std::unique_ptr<XrGraphicsBackend> CreateDefaultGraphicsBackend()
+{
+#if defined(BEE_XR_GRAPHICS_VULKAN)
+    return std::make_unique<VulkanXrGraphicsBackend>();
+#else
+    return std::make_unique<OpenGLXrGraphicsBackend>();
+#endif
+}
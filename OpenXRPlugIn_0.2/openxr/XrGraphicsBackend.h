@@ -0,0 +1,81 @@
+#pragma once
+
+#include "openxr.h"
+#include "XrRenderer.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// The graphics API is selected at build time, OpenGL unless BEE_XR_GRAPHICS_VULKAN is defined.
+// OpenxrPlugIn::SetGraphicsBackend() overrides it before Init().
+enum class XrGraphicsApi
+{
+    OpenGL,
+    Vulkan
+};
+
+// Image rendered by the application that gets copied into a swapchain image.
+//  OpenGL: framebuffer name, read from GL_COLOR_ATTACHMENT0
+//  Vulkan: VkImage in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+struct XrGraphicsImage
+{
+    uint64_t handle = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+};
+
+
+// Everything graphics API specific the plug-in needs: the session binding, the swapchain images,
+// wrapping an acquired image as a render target and copying into it.
+//
+// Per frame the plug-in acquires the swapchain image of every view, calls BeginFrame(), hands the frame
+// to the XrRenderer, calls EndFrame() and releases the images.
+class XrGraphicsBackend
+{
+public:
+    virtual ~XrGraphicsBackend() = default;
+
+    virtual XrGraphicsApi GetApi() const = 0;
+    virtual const char* GetName() const = 0;
+
+    // Instance extensions the backend needs.
+    virtual void GetRequiredExtensions(std::vector<std::string>& extensions) const = 0;
+
+    // Checks the graphics requirements of the system and creates or captures the device the session
+    // renders with. Returns false when the session cannot be created.
+    virtual bool CreateBinding(XrInstance instance, XrSystemId systemId) = 0;
+    // Structure to chain into XrSessionCreateInfo::next. Valid after CreateBinding() succeeded.
+    virtual const void* GetSessionBinding() const = 0;
+
+    // First format in the runtime preference order the backend renders to, 0 if there is none.
+    virtual int64_t SelectColorSwapchainFormat(const std::vector<int64_t>& formats) const = 0;
+    // Native images of a swapchain, in swapchain image index order.
+    virtual void EnumerateSwapchainImages(XrSwapchain swapchain, std::vector<uint64_t>& images) = 0;
+
+    // Object to render into the acquired image of a target: a GL framebuffer or a VkImageView.
+    // Created on first use and cached for the lifetime of the swapchain.
+    virtual uint64_t GetRenderTarget(const XrRenderTarget& target) = 0;
+    // Drops the render targets of these swapchain images, called before their swapchain is destroyed.
+    virtual void ReleaseSwapchainImages(const std::vector<uint64_t>& images) = 0;
+
+    // Called once all swapchain images of the frame are acquired and waited on.
+    virtual void BeginFrame(const XrRenderFrame& frame) { (void)frame; }
+    // Copies and scales an application image into the acquired image of a view.
+    virtual void CopyToRenderTarget(const XrRenderTarget& target, const XrGraphicsImage& source) = 0;
+    // Called after the renderer returned, before the swapchain images are released.
+    virtual void EndFrame(const XrRenderFrame& frame) { (void)frame; }
+
+    // Streams CPU pixels (RGBA8, target size, rows rowPitch bytes apart) into an acquired layer image
+    // without waiting for the GPU. Returns false when the backend has no streaming path.
+    virtual bool UploadToRenderTarget(const XrRenderTarget& target, const void* pixels, uint32_t rowPitch)
+    {
+        (void)target;
+        (void)pixels;
+        (void)rowPitch;
+        return false;
+    }
+};
+
+std::unique_ptr<XrGraphicsBackend> CreateDefaultGraphicsBackend();
@@ -0,0 +1,237 @@
+#include "XrGraphicsBinding.h"
+
+// The platform defines have to be set before openxr_platform.h is included, and the native headers
+// before the platform structures are declared.
+#define XR_USE_GRAPHICS_API_OPENGL
+
+#if defined(BEE_XR_PLATFORM_WIN32)
+#define XR_USE_PLATFORM_WIN32
+#define NOMINMAX
+#include "Windows.h"
+#include <glad/glad.h>
+#include "core/engine.hpp"
+#include "core/device.hpp"
+#define GLFW_EXPOSE_NATIVE_WIN32
+#include <GLFW/glfw3.h>
+#include <GLFW/glfw3native.h>
+#elif defined(BEE_XR_PLATFORM_XLIB)
+#define XR_USE_PLATFORM_XLIB
+#include <glad/glad.h>   // Before glx.h, glad replaces GL/gl.h
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <GL/glx.h>
+#elif defined(BEE_XR_PLATFORM_EGL)
+#define XR_USE_PLATFORM_EGL
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "openxr_platform.h"
+#include "DebugOutput.h"
+
+
+#if defined(BEE_XR_PLATFORM_WIN32)
+
+class XrGraphicsBindingWin32 : public XrGraphicsBinding
+{
+public:
+    const char* GetName() const override { return "OpenGL Win32"; }
+
+    bool Create() override
+    {
+        GLFWwindow* window = bee::Engine.Device().GetWindow();
+        HWND hwnd = glfwGetWin32Window(window);     // Get the Win32 window handle
+        HDC hdc = GetDC(hwnd);                      // Get the window device context
+        HGLRC hglrc = wglGetCurrentContext();       // Get the OpenGl context
+        if (hdc == nullptr || hglrc == nullptr)
+        {
+            return false;
+        }
+
+        m_binding.hDC = hdc;
+        m_binding.hGLRC = hglrc;
+        return true;
+    }
+
+    const void* GetSessionBinding() const override { return &m_binding; }
+
+private:
+    XrGraphicsBindingOpenGLWin32KHR m_binding = {XR_TYPE_GRAPHICS_BINDING_OPENGL_WIN32_KHR};
+};
+
+std::unique_ptr<XrGraphicsBinding> CreatePlatformGraphicsBinding()
+{
+    return std::make_unique<XrGraphicsBindingWin32>();
+}
+
+#elif defined(BEE_XR_PLATFORM_XLIB)
+
+class XrGraphicsBindingXlib : public XrGraphicsBinding
+{
+public:
+    const char* GetName() const override { return "OpenGL Xlib/GLX"; }
+
+    bool Create() override
+    {
+        Display* display = glXGetCurrentDisplay();
+        GLXContext context = glXGetCurrentContext();
+        if (display == nullptr || context == nullptr)
+        {
+            return false;
+        }
+
+        // The runtime needs the framebuffer config and the visual the context was created with.
+        int fbConfigId = 0;
+        glXQueryContext(display, context, GLX_FBCONFIG_ID, &fbConfigId);
+        const int attributes[] = {GLX_FBCONFIG_ID, fbConfigId, None};
+        int configCount = 0;
+        GLXFBConfig* configs = glXChooseFBConfig(display, DefaultScreen(display), attributes, &configCount);
+        if (configs == nullptr || configCount == 0)
+        {
+            XR_TUT_LOG_ERROR("Failed to find the GLXFBConfig of the current context.");
+            return false;
+        }
+
+        m_binding.xDisplay = display;
+        m_binding.glxFBConfig = configs[0];
+        m_binding.glxDrawable = glXGetCurrentDrawable();
+        m_binding.glxContext = context;
+        XVisualInfo* visualInfo = glXGetVisualFromFBConfig(display, configs[0]);
+        if (visualInfo != nullptr)
+        {
+            m_binding.visualid = static_cast<uint32_t>(visualInfo->visualid);
+            XFree(visualInfo);
+        }
+        XFree(configs);
+        return true;
+    }
+
+    const void* GetSessionBinding() const override { return &m_binding; }
+
+private:
+    XrGraphicsBindingOpenGLXlibKHR m_binding = {XR_TYPE_GRAPHICS_BINDING_OPENGL_XLIB_KHR};
+};
+
+std::unique_ptr<XrGraphicsBinding> CreatePlatformGraphicsBinding()
+{
+    return std::make_unique<XrGraphicsBindingXlib>();
+}
+
+#elif defined(BEE_XR_PLATFORM_EGL)
+
+class XrGraphicsBindingEGL : public XrGraphicsBinding
+{
+public:
+    ~XrGraphicsBindingEGL() override
+    {
+        if (m_ownedContext != EGL_NO_CONTEXT)
+        {
+            eglMakeCurrent(m_binding.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(m_binding.display, m_ownedContext);
+            eglTerminate(m_binding.display);
+        }
+    }
+
+    const char* GetName() const override { return m_ownedContext != EGL_NO_CONTEXT ? "EGL surfaceless" : "EGL"; }
+
+    void GetRequiredExtensions(std::vector<std::string>& extensions) const override
+    {
+        extensions.push_back(XR_MNDX_EGL_ENABLE_EXTENSION_NAME);
+    }
+
+    bool Create() override
+    {
+        EGLDisplay display = eglGetCurrentDisplay();
+        EGLContext context = eglGetCurrentContext();
+        if (display == EGL_NO_DISPLAY || context == EGL_NO_CONTEXT)
+        {
+            // Nothing current: fully headless, create a surfaceless context the renderer can draw offscreen with.
+            if (!CreateSurfacelessContext(display, context))
+            {
+                return false;
+            }
+        }
+
+        EGLint configId = 0;
+        eglQueryContext(display, context, EGL_CONFIG_ID, &configId);
+        const EGLint attributes[] = {EGL_CONFIG_ID, configId, EGL_NONE};
+        EGLConfig config = nullptr;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(display, attributes, &config, 1, &configCount) || configCount == 0)
+        {
+            XR_TUT_LOG_ERROR("Failed to find the EGLConfig of the current context.");
+            return false;
+        }
+
+        m_binding.getProcAddress = reinterpret_cast<PFN_xrEglGetProcAddressMNDX>(eglGetProcAddress);
+        m_binding.display = display;
+        m_binding.config = config;
+        m_binding.context = context;
+        return true;
+    }
+
+    const void* GetSessionBinding() const override { return &m_binding; }
+
+private:
+    bool CreateSurfacelessContext(EGLDisplay& display, EGLContext& context)
+    {
+        display = EGL_NO_DISPLAY;
+        PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (eglGetPlatformDisplayEXT != nullptr)
+        {
+            display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (display == EGL_NO_DISPLAY)
+        {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+        {
+            XR_TUT_LOG_ERROR("Failed to initialize an EGL display.");
+            return false;
+        }
+
+        const EGLint configAttributes[] = {EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8, EGL_DEPTH_SIZE, 24,
+                                           EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        EGLConfig config = nullptr;
+        EGLint configCount = 0;
+        if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+        {
+            XR_TUT_LOG_ERROR("Failed to find an EGL config for desktop OpenGL.");
+            eglTerminate(display);
+            return false;
+        }
+
+        const EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 5,
+                                            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            XR_TUT_LOG_ERROR("Failed to create a surfaceless EGL context (EGL_KHR_surfaceless_context).");
+            if (context != EGL_NO_CONTEXT)
+            {
+                eglDestroyContext(display, context);
+            }
+            eglTerminate(display);
+            return false;
+        }
+        m_ownedContext = context;
+        m_binding.display = display;
+
+        // There was no window, so nobody loaded the GL functions for this context yet.
+        gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+        return true;
+    }
+
+    XrGraphicsBindingEGLMNDX m_binding = {XR_TYPE_GRAPHICS_BINDING_EGL_MNDX};
+    EGLContext m_ownedContext = EGL_NO_CONTEXT;
+};
+
+std::unique_ptr<XrGraphicsBinding> CreatePlatformGraphicsBinding()
+{
+    return std::make_unique<XrGraphicsBindingEGL>();
+}
+
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "openxr.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// The graphics binding handed to xrCreateSession is selected at build time. Define one of these in the
+// project to override the default, Win32 on Windows and Xlib/GLX everywhere else:
+//  BEE_XR_PLATFORM_WIN32   XrGraphicsBindingOpenGLWin32KHR, from the Bee GLFW window and the current WGL context
+//  BEE_XR_PLATFORM_XLIB    XrGraphicsBindingOpenGLXlibKHR, from the current GLX context
+//  BEE_XR_PLATFORM_EGL     XrGraphicsBindingEGLMNDX, from the current EGL context or a surfaceless one (headless)
+#if !defined(BEE_XR_PLATFORM_WIN32) && !defined(BEE_XR_PLATFORM_XLIB) && !defined(BEE_XR_PLATFORM_EGL)
+#if defined(_WIN32)
+#define BEE_XR_PLATFORM_WIN32
+#else
+#define BEE_XR_PLATFORM_XLIB
+#endif
+#endif
+
+
+// Platform specific part of session creation. The native window system headers stay in
+// XrGraphicsBinding.cpp so they never leak into the engine through openxrPlugIn.h.
+class XrGraphicsBinding
+{
+public:
+    virtual ~XrGraphicsBinding() = default;
+
+    virtual const char* GetName() const = 0;
+    // Instance extensions needed on top of XR_KHR_opengl_enable.
+    virtual void GetRequiredExtensions(std::vector<std::string>& extensions) const { (void)extensions; }
+    // Fills the binding from the GL context current on the calling thread. Returns false without one.
+    virtual bool Create() = 0;
+    // Structure to chain into XrSessionCreateInfo::next. Valid after Create() succeeded.
+    virtual const void* GetSessionBinding() const = 0;
+};
+
+std::unique_ptr<XrGraphicsBinding> CreatePlatformGraphicsBinding();
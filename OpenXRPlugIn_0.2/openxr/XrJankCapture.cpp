@@ -0,0 +1,260 @@
+#include "XrJankCapture.h"
+
+#include "DebugOutput.h"
+#include "openxr_reflection.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+
+namespace
+{
+
+const char* kPhaseNames[] = {"pollEvents", "waitFrame", "beginFrame", "pollActions", "renderLayer", "endFrame"};
+static_assert(sizeof(kPhaseNames) / sizeof(kPhaseNames[0]) == static_cast<size_t>(XrFramePhase::Count));
+
+const char* SessionStateName(XrSessionState state)
+{
+    switch (state)
+    {
+#define XR_JANK_ENUM_NAME(name, value) \
+    case name:                         \
+        return #name;
+        XR_LIST_ENUM_XrSessionState(XR_JANK_ENUM_NAME)
+    default:
+        return "XR_SESSION_STATE_?";
+    }
+}
+
+const char* StructureTypeName(XrStructureType type)
+{
+    switch (type)
+    {
+        XR_LIST_ENUM_XrStructureType(XR_JANK_ENUM_NAME)
+#undef XR_JANK_ENUM_NAME
+    default:
+        return "XR_TYPE_?";
+    }
+}
+
+// Entries of a ring in insertion order.
+template <typename T>
+std::vector<T> Unroll(const std::vector<T>& ring, uint64_t count)
+{
+    std::vector<T> ordered;
+    ordered.reserve(ring.size());
+    const uint64_t size = ring.size();
+    const uint64_t first = count > size ? count - size : 0;
+    for (uint64_t i = first; i < count; i++)
+    {
+        ordered.push_back(ring[static_cast<size_t>(i % size)]);
+    }
+    return ordered;
+}
+
+}  // namespace
+
+
+XrJankCapture::~XrJankCapture()
+{
+    if (m_writer.joinable())
+    {
+        m_writer.join();
+    }
+}
+
+void XrJankCapture::SetSettings(const XrJankCaptureSettings& settings)
+{
+    m_settings = settings;
+    m_frames.clear();
+    m_frameCount = 0;
+    m_events.clear();
+    m_eventCount = 0;
+    m_captureCount = 0;
+}
+
+void XrJankCapture::BeginFrame(uint64_t frameIndx, XrSessionState sessionState)
+{
+    m_current = XrJankFrame();
+    m_current.frameIndx = frameIndx;
+    m_current.sessionState = sessionState;
+}
+
+bool XrJankCapture::SetFrameState(const XrFrameState& frameState)
+{
+    m_current.predictedDisplayTime = frameState.predictedDisplayTime;
+    m_current.predictedDisplayPeriod = frameState.predictedDisplayPeriod;
+    m_current.shouldRender = frameState.shouldRender == XR_TRUE;
+
+    // Consecutive xrWaitFrame calls predict consecutive display periods, a larger step means the
+    // runtime dropped at least one frame.
+    const XrTime previousDisplayTime = m_lastPredictedDisplayTime;
+    m_lastPredictedDisplayTime = frameState.predictedDisplayTime;
+    if (previousDisplayTime == 0 || frameState.predictedDisplayPeriod <= 0)
+    {
+        return false;
+    }
+    const XrDuration step = frameState.predictedDisplayTime - previousDisplayTime;
+    if (static_cast<double>(step) <= m_settings.missedPeriods * static_cast<double>(frameState.predictedDisplayPeriod))
+    {
+        return false;
+    }
+
+    m_missedFrameCount++;
+    m_pendingSlip = step - frameState.predictedDisplayPeriod;
+    return true;
+}
+
+void XrJankCapture::AddPhaseTime(XrFramePhase phase, std::chrono::steady_clock::duration duration)
+{
+    m_current.phaseMs[static_cast<size_t>(phase)] += std::chrono::duration<float, std::milli>(duration).count();
+}
+
+void XrJankCapture::EndFrame()
+{
+    if (!m_settings.enabled || m_settings.historyFrames == 0)
+    {
+        m_pendingSlip = 0;
+        return;
+    }
+
+    if (m_frames.size() < m_settings.historyFrames)
+    {
+        m_frames.push_back(m_current);
+    }
+    else
+    {
+        m_frames[static_cast<size_t>(m_frameCount % m_frames.size())] = m_current;
+    }
+    m_frameCount++;
+
+    // The slip shows up in the xrWaitFrame of the frame after the late one, writing at its end
+    // keeps both in the capture.
+    if (m_pendingSlip != 0)
+    {
+        WriteCapture();
+        m_pendingSlip = 0;
+    }
+}
+
+void XrJankCapture::RecordEvent(uint64_t frameIndx, const XrEventDataBuffer& eventData)
+{
+    if (!m_settings.enabled || m_settings.historyEvents == 0)
+    {
+        return;
+    }
+
+    XrJankEvent event;
+    event.frameIndx = frameIndx;
+    event.type = eventData.type;
+    if (eventData.type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED)
+    {
+        event.sessionState = reinterpret_cast<const XrEventDataSessionStateChanged*>(&eventData)->state;
+    }
+
+    if (m_events.size() < m_settings.historyEvents)
+    {
+        m_events.push_back(event);
+    }
+    else
+    {
+        m_events[static_cast<size_t>(m_eventCount % m_events.size())] = event;
+    }
+    m_eventCount++;
+}
+
+void XrJankCapture::WriteCapture()
+{
+    // One capture at a time: misses while the previous file is being written are part of the same hitch.
+    if (m_captureCount >= m_settings.maxCaptures || m_settings.pathPrefix.empty() || m_writing.load(std::memory_order_acquire))
+    {
+        return;
+    }
+    if (m_writer.joinable())
+    {
+        m_writer.join();
+    }
+    m_captureCount++;
+    m_writing.store(true, std::memory_order_relaxed);
+
+    std::string path = m_settings.pathPrefix + std::to_string(m_current.frameIndx) + ".txt";
+    m_writer = std::thread(
+        [this, path = std::move(path), frames = Unroll(m_frames, m_frameCount), events = Unroll(m_events, m_eventCount),
+         slip = m_pendingSlip]()
+        {
+            if (WriteFile(path, frames, events, slip))
+            {
+                XR_TUT_LOG("Missed frame, " << frames.size() << " frames of history written to " << path);
+            }
+            m_writing.store(false, std::memory_order_release);
+        });
+}
+
+bool XrJankCapture::WriteFile(const std::string& path, const std::vector<XrJankFrame>& frames, const std::vector<XrJankEvent>& events,
+                              XrDuration slip)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        XR_TUT_LOG_ERROR("Failed to open jank capture file " << path);
+        return false;
+    }
+
+    const XrJankFrame& last = frames.back();
+    fprintf(file, "Missed frame %" PRIu64 ": predicted display time %.3f ms later than the display period of %.3f ms\n\n",
+            last.frameIndx, slip / 1e6, last.predictedDisplayPeriod / 1e6);
+
+    fprintf(file, "%-8s %-18s %-8s %-6s", "frame", "displayTime", "deltaMs", "render");
+    for (const char* phaseName : kPhaseNames)
+    {
+        fprintf(file, " %11s", phaseName);
+    }
+    fprintf(file, "  sessionState\n");
+    XrTime previousDisplayTime = 0;
+    for (const XrJankFrame& frame : frames)
+    {
+        double deltaMs = previousDisplayTime != 0 ? (frame.predictedDisplayTime - previousDisplayTime) / 1e6 : 0.0;
+        previousDisplayTime = frame.predictedDisplayTime;
+        fprintf(file, "%-8" PRIu64 " %-18" PRId64 " %-8.3f %-6s", frame.frameIndx, static_cast<int64_t>(frame.predictedDisplayTime),
+                deltaMs, frame.shouldRender ? "yes" : "no");
+        for (float phaseMs : frame.phaseMs)
+        {
+            fprintf(file, " %11.3f", phaseMs);
+        }
+        fprintf(file, "  %s\n", SessionStateName(frame.sessionState));
+    }
+
+    fprintf(file, "\nInput (hand: active position trigger grip joystick)\n");
+    for (const XrJankFrame& frame : frames)
+    {
+        const XrJankInput& input = frame.input;
+        fprintf(file, "%-8" PRIu64, frame.frameIndx);
+        for (int hand = 0; hand < 2; hand++)
+        {
+            const XrVector3f& position = input.handPose[hand].position;
+            fprintf(file, "  %s %d (%.3f %.3f %.3f) %.2f %.2f (%.2f %.2f)", hand == 0 ? "L" : "R", input.handActive[hand] ? 1 : 0,
+                    position.x, position.y, position.z, input.trigger[hand], input.grip[hand], input.joystick[hand][0],
+                    input.joystick[hand][1]);
+        }
+        fprintf(file, "  buttons 0x%02x\n", input.buttons);
+    }
+
+    fprintf(file, "\nEvents\n");
+    for (const XrJankEvent& event : events)
+    {
+        fprintf(file, "%-8" PRIu64 " %s", event.frameIndx, StructureTypeName(event.type));
+        if (event.type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED)
+        {
+            fprintf(file, " %s", SessionStateName(event.sessionState));
+        }
+        fprintf(file, "\n");
+    }
+
+    bool written = ferror(file) == 0;
+    written = fclose(file) == 0 && written;
+    if (!written)
+    {
+        XR_TUT_LOG_ERROR("Failed to write jank capture file " << path);
+    }
+    return written;
+}
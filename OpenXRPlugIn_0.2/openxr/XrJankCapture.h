@@ -0,0 +1,134 @@
+#pragma once
+
+#include "openxr.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+enum class XrFramePhase : uint8_t
+{
+    PollEvents,
+    WaitFrame,
+    BeginFrame,
+    PollActions,
+    RenderLayer,
+    EndFrame,
+    Count
+};
+
+// Controller state sampled by PollActions() in one frame.
+struct XrJankInput
+{
+    bool handActive[2] = {false, false};
+    XrPosef handPose[2] = {};
+    float trigger[2] = {0.0f, 0.0f};
+    float grip[2] = {0.0f, 0.0f};
+    float joystick[2][2] = {};
+    // Pressed buttons: x, y, left thumbstick, a, b, right thumbstick from bit 0 up.
+    uint32_t buttons = 0;
+};
+
+struct XrJankFrame
+{
+    uint64_t frameIndx = 0;
+    XrTime predictedDisplayTime = 0;
+    XrDuration predictedDisplayPeriod = 0;
+    bool shouldRender = false;
+    XrSessionState sessionState = XR_SESSION_STATE_UNKNOWN;
+    float phaseMs[static_cast<size_t>(XrFramePhase::Count)] = {};
+    XrJankInput input;
+};
+
+struct XrJankEvent
+{
+    uint64_t frameIndx = 0;
+    XrStructureType type = XR_TYPE_UNKNOWN;
+    // New state of XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED events.
+    XrSessionState sessionState = XR_SESSION_STATE_UNKNOWN;
+};
+
+struct XrJankCaptureSettings
+{
+    // Off by default: missed frames are still counted, but no history is kept and nothing is written.
+    bool enabled = false;
+    // Frames and events kept in the rolling history and written with every capture.
+    uint32_t historyFrames = 90;
+    uint32_t historyEvents = 32;
+    // Captures are written to <pathPrefix><frame index>.txt, at most maxCaptures per session.
+    std::string pathPrefix = "xr_jank_";
+    uint32_t maxCaptures = 16;
+    // A frame is missed when the predicted display time moves more than this many display periods.
+    float missedPeriods = 1.5f;
+};
+
+
+// Opt-in rolling history of the last frames: phase timings, controller state and runtime events,
+// a few hundred bytes per frame with no allocation once the history is full. When the predicted
+// display time of a frame slips past the next display period, the history up to the end of that
+// frame is written to disk on a background thread, so rare hitches leave post-mortem data behind.
+class XrJankCapture
+{
+public:
+    ~XrJankCapture();
+
+    void SetSettings(const XrJankCaptureSettings& settings);
+    const XrJankCaptureSettings& GetSettings() const { return m_settings; }
+
+    // Times one phase of the current frame.
+    class PhaseTimer
+    {
+    public:
+        PhaseTimer(XrJankCapture& capture, XrFramePhase phase)
+            : m_capture(capture), m_phase(phase), m_start(std::chrono::steady_clock::now())
+        {}
+        ~PhaseTimer() { m_capture.AddPhaseTime(m_phase, std::chrono::steady_clock::now() - m_start); }
+
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    private:
+        XrJankCapture& m_capture;
+        XrFramePhase m_phase;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    void BeginFrame(uint64_t frameIndx, XrSessionState sessionState);
+    // Called after xrWaitFrame. Returns true when the frame slipped; the capture is then written by EndFrame().
+    bool SetFrameState(const XrFrameState& frameState);
+    // Forgets the last display time, so the first frame of a (re)started session does not count as a slip.
+    void ResetFrameTiming() { m_lastPredictedDisplayTime = 0; }
+    XrJankInput& GetInput() { return m_current.input; }
+    void AddPhaseTime(XrFramePhase phase, std::chrono::steady_clock::duration duration);
+    void EndFrame();
+
+    void RecordEvent(uint64_t frameIndx, const XrEventDataBuffer& eventData);
+
+    uint64_t GetMissedFrameCount() const { return m_missedFrameCount; }
+    uint32_t GetCaptureCount() const { return m_captureCount; }
+
+private:
+    void WriteCapture();
+    static bool WriteFile(const std::string& path, const std::vector<XrJankFrame>& frames, const std::vector<XrJankEvent>& events,
+                          XrDuration slip);
+
+    XrJankCaptureSettings m_settings;
+
+    XrJankFrame m_current;
+    XrTime m_lastPredictedDisplayTime = 0;
+    XrDuration m_pendingSlip = 0;
+    uint64_t m_missedFrameCount = 0;
+
+    // Rings, oldest entry at m_frameCount % size once full.
+    std::vector<XrJankFrame> m_frames;
+    uint64_t m_frameCount = 0;
+    std::vector<XrJankEvent> m_events;
+    uint64_t m_eventCount = 0;
+
+    uint32_t m_captureCount = 0;
+    std::atomic<bool> m_writing{false};
+    std::thread m_writer;
+};
@@ -0,0 +1,316 @@
+#include "XrLog.h"
+
+#include <chrono>
+#include <cstring>
+#include <streambuf>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#endif
+
+
+namespace
+{
+
+uint64_t NowNs()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Fixed size put area, characters past the end are discarded.
+class RecordStreamBuf : public std::streambuf
+{
+public:
+    void Reset() { setp(m_buffer, m_buffer + sizeof(m_buffer)); }
+    const char* Data() const { return pbase(); }
+    size_t Length() const { return static_cast<size_t>(pptr() - pbase()); }
+
+private:
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+
+    char m_buffer[XrLogger::kMaxRecordLength];
+};
+
+// Constructing an ostream is expensive (locale), every thread keeps one for each nesting level.
+struct RecordFormatter
+{
+    RecordFormatter() : stream(&buffer) {}
+
+    RecordStreamBuf buffer;
+    std::ostream stream;
+};
+
+thread_local RecordFormatter t_formatters[XrLogRecord::kMaxNesting];
+// Records being formatted on this thread. They nest strictly, the inner one ends first.
+thread_local uint32_t t_depth = 0;
+// No stream buffer: every write fails and is ignored.
+thread_local std::ostream t_discard(nullptr);
+
+}  // namespace
+
+
+XrLogger& XrLogger::Get()
+{
+    static XrLogger logger;
+    return logger;
+}
+
+XrLogger::XrLogger()
+{
+    for (size_t i = 0; i < kCapacity; i++)
+    {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    uint32_t sinks = XR_LOG_SINK_CONSOLE;
+#if defined(_WIN32)
+    sinks |= XR_LOG_SINK_DEBUGGER;
+#endif
+    m_sinks.store(sinks, std::memory_order_relaxed);
+    m_startNs = NowNs();
+
+    m_worker = std::thread(&XrLogger::WorkerLoop, this);
+}
+
+XrLogger::~XrLogger()
+{
+    m_stop.store(true, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wakePending = true;
+    }
+    m_wake.notify_one();
+    m_worker.join();
+    Flush();
+    CloseFile();
+}
+
+bool XrLogger::Write(XrLogLevel level, const char* text, size_t length)
+{
+    // Bounded multi producer ring: a slot is free for position pos when its sequence equals pos, and
+    // holds a record for the drain once its sequence is pos + 1.
+    uint64_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (;;)
+    {
+        slot = &m_slots[pos & (kCapacity - 1)];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+        if (difference == 0)
+        {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    length = length < kMaxRecordLength ? length : kMaxRecordLength;
+    slot->timestampNs = NowNs();
+    slot->level = level;
+    slot->length = static_cast<uint16_t>(length);
+    std::memcpy(slot->text, text, length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    // Pairs with the fence in WorkerLoop(): either the worker sees the record before it waits, or this
+    // sees it waiting. Only then the call pays for the lock and the notification.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_workerWaiting.load(std::memory_order_relaxed))
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_wakePending = true;
+        }
+        m_wake.notify_one();
+    }
+    return true;
+}
+
+bool XrLogger::OpenFile(const char* path)
+{
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    if (m_file != nullptr)
+    {
+        fclose(m_file);
+    }
+    m_file = fopen(path, "a");
+    if (m_file == nullptr)
+    {
+        return false;
+    }
+    m_sinks.fetch_or(XR_LOG_SINK_FILE, std::memory_order_relaxed);
+    return true;
+}
+
+void XrLogger::CloseFile()
+{
+    std::lock_guard<std::mutex> lock(m_fileMutex);
+    m_sinks.fetch_and(~static_cast<uint32_t>(XR_LOG_SINK_FILE), std::memory_order_relaxed);
+    if (m_file != nullptr)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+void XrLogger::Flush()
+{
+    uint64_t target = m_enqueuePos.load(std::memory_order_acquire);
+    while (m_dequeuePos.load(std::memory_order_acquire) < target)
+    {
+        // A producer may still be copying into a claimed slot, give it time to publish.
+        if (!Drain())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool XrLogger::Drain()
+{
+    std::lock_guard<std::mutex> lock(m_drainMutex);
+
+    bool wroteAny = false;
+    for (;;)
+    {
+        uint64_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Slot& slot = m_slots[pos & (kCapacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+        {
+            break;
+        }
+        WriteToSinks(slot);
+        slot.sequence.store(pos + kCapacity, std::memory_order_release);
+        m_dequeuePos.store(pos + 1, std::memory_order_release);
+        wroteAny = true;
+    }
+
+    uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped != m_reportedDropped)
+    {
+        char text[64];
+        int length = snprintf(text, sizeof(text), "%llu log records dropped, the log ring was full",
+                              static_cast<unsigned long long>(dropped - m_reportedDropped));
+        Slot report;
+        report.timestampNs = NowNs();
+        report.level = XrLogLevel::Error;
+        report.length = static_cast<uint16_t>(length);
+        std::memcpy(report.text, text, static_cast<size_t>(length));
+        WriteToSinks(report);
+        m_reportedDropped = dropped;
+        wroteAny = true;
+    }
+
+    if (wroteAny)
+    {
+        fflush(stdout);
+        std::lock_guard<std::mutex> fileLock(m_fileMutex);
+        if (m_file != nullptr)
+        {
+            fflush(m_file);
+        }
+    }
+    return wroteAny;
+}
+
+void XrLogger::WriteToSinks(const Slot& slot)
+{
+    uint32_t sinks = m_sinks.load(std::memory_order_relaxed);
+
+    if (sinks & XR_LOG_SINK_CONSOLE)
+    {
+        FILE* console = slot.level == XrLogLevel::Error ? stderr : stdout;
+        fwrite(slot.text, 1, slot.length, console);
+        fputc('\n', console);
+    }
+#if defined(_WIN32)
+    if (sinks & XR_LOG_SINK_DEBUGGER)
+    {
+        char line[kMaxRecordLength + 2];
+        std::memcpy(line, slot.text, slot.length);
+        line[slot.length] = '\n';
+        line[slot.length + 1] = '\0';
+        OutputDebugStringA(line);
+    }
+#endif
+    if (sinks & XR_LOG_SINK_FILE)
+    {
+        std::lock_guard<std::mutex> lock(m_fileMutex);
+        if (m_file != nullptr)
+        {
+            fprintf(m_file,
+                    "%10.3f %s %.*s\n",
+                    static_cast<double>(slot.timestampNs - m_startNs) / 1e6,
+                    slot.level == XrLogLevel::Error ? "E" : "I",
+                    static_cast<int>(slot.length),
+                    slot.text);
+        }
+    }
+}
+
+void XrLogger::WorkerLoop()
+{
+    while (!m_stop.load(std::memory_order_relaxed))
+    {
+        if (Drain())
+        {
+            continue;
+        }
+
+        // Sleep until a producer publishes a record, see Write().
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_workerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        if (m_slots[pos & (kCapacity - 1)].sequence.load(std::memory_order_acquire) != pos + 1)
+        {
+            m_wake.wait(lock, [this]() { return m_wakePending; });
+        }
+        m_workerWaiting.store(false, std::memory_order_relaxed);
+        m_wakePending = false;
+    }
+}
+
+
+XrLogRecord::XrLogRecord(XrLogLevel level) : m_level(level), m_depth(t_depth++)
+{
+    if (m_depth >= kMaxNesting)
+    {
+        return;
+    }
+    RecordFormatter& formatter = t_formatters[m_depth];
+    formatter.buffer.Reset();
+    formatter.stream.clear();
+    formatter.stream.flags(std::ios_base::dec | std::ios_base::skipws);
+    formatter.stream.precision(6);
+    formatter.stream.width(0);
+    formatter.stream.fill(' ');
+}
+
+XrLogRecord::~XrLogRecord()
+{
+    t_depth--;
+    if (m_depth < kMaxNesting)
+    {
+        const RecordFormatter& formatter = t_formatters[m_depth];
+        XrLogger::Get().Write(m_level, formatter.buffer.Data(), formatter.buffer.Length());
+    }
+}
+
+std::ostream& XrLogRecord::Stream()
+{
+    return m_depth < kMaxNesting ? t_formatters[m_depth].stream : t_discard;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+
+// Asynchronous logging behind XR_TUT_LOG and XR_TUT_LOG_ERROR.
+//
+// A log call formats its record on the calling thread into a thread local buffer, without allocating,
+// and pushes it into a bounded lock-free ring. A background thread drains the ring into the sinks,
+// so the frame loop never waits on the console, the debugger or a file. The thread sleeps while the
+// ring is empty; a log call only signals it when it sleeps. When the ring is full the record is
+// dropped and counted instead of blocking the caller.
+enum class XrLogLevel : uint8_t
+{
+    Info,
+    Error
+};
+
+enum XrLogSink : uint32_t
+{
+    XR_LOG_SINK_CONSOLE = 1 << 0,    // stdout for info, stderr for errors
+    XR_LOG_SINK_DEBUGGER = 1 << 1,   // OutputDebugStringA, Windows only
+    XR_LOG_SINK_FILE = 1 << 2        // see XrLogger::OpenFile()
+};
+
+class XrLogger
+{
+public:
+    // Longer records are truncated.
+    static constexpr size_t kMaxRecordLength = 240;
+    // Records the ring holds before producers start dropping, a power of two.
+    static constexpr size_t kCapacity = 1024;
+
+    static XrLogger& Get();
+
+    XrLogger(const XrLogger&) = delete;
+    XrLogger& operator=(const XrLogger&) = delete;
+
+    // Queues a record, safe from any thread. Returns false when it was dropped.
+    bool Write(XrLogLevel level, const char* text, size_t length);
+
+    void SetSinks(uint32_t sinks) { m_sinks.store(sinks, std::memory_order_relaxed); }
+    uint32_t GetSinks() const { return m_sinks.load(std::memory_order_relaxed); }
+    // Appends every record to a file, prefixed with the milliseconds since the logger started.
+    bool OpenFile(const char* path);
+    void CloseFile();
+
+    // Blocks until every record queued before the call is written.
+    void Flush();
+    uint64_t GetDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence = 0;
+        uint64_t timestampNs = 0;
+        XrLogLevel level = XrLogLevel::Info;
+        uint16_t length = 0;
+        char text[kMaxRecordLength];
+    };
+
+    XrLogger();
+    ~XrLogger();
+
+    bool Drain();
+    void WriteToSinks(const Slot& slot);
+    void WorkerLoop();
+
+    Slot m_slots[kCapacity];
+    alignas(64) std::atomic<uint64_t> m_enqueuePos = 0;
+    alignas(64) std::atomic<uint64_t> m_dequeuePos = 0;   // Only advanced by the drain
+    std::atomic<uint64_t> m_dropped = 0;
+    uint64_t m_reportedDropped = 0;
+
+    std::atomic<uint32_t> m_sinks;
+    std::mutex m_fileMutex;
+    FILE* m_file = nullptr;
+    uint64_t m_startNs = 0;
+
+    // Serializes the drain between the worker and Flush() callers.
+    std::mutex m_drainMutex;
+    std::atomic<bool> m_stop = false;
+    std::thread m_worker;
+
+    // The worker waits on m_wake while the ring is empty, producers only take m_wakeMutex while it does.
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_workerWaiting = false;
+    bool m_wakePending = false;
+};
+
+// One log call. Stream() writes into a thread local record buffer, the destructor queues it at the
+// end of the full expression, so XR_TUT_LOG(a << b) stays a single statement. A log call made while
+// formatting another one (a check failing inside a log expression) gets a buffer of its own, up to
+// kMaxNesting deep; deeper records are discarded.
+class XrLogRecord
+{
+public:
+    static constexpr uint32_t kMaxNesting = 4;
+
+    explicit XrLogRecord(XrLogLevel level);
+    ~XrLogRecord();
+
+    XrLogRecord(const XrLogRecord&) = delete;
+    XrLogRecord& operator=(const XrLogRecord&) = delete;
+
+    std::ostream& Stream();
+
+private:
+    XrLogLevel m_level;
+    uint32_t m_depth;
+};
@@ -0,0 +1,217 @@
+#include "XrReferenceSpace.h"
+
+#include "DebugOutput.h"
+#include "OpenXRDebugUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+namespace
+{
+
+const XrPosef kIdentityPose = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
+
+XrQuaternionf Multiply(const XrQuaternionf& a, const XrQuaternionf& b)
+{
+    return {a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+
+XrVector3f Rotate(const XrQuaternionf& q, const XrVector3f& v)
+{
+    // v + 2w (u x v) + 2 u x (u x v)
+    const XrVector3f t = {2.0f * (q.y * v.z - q.z * v.y), 2.0f * (q.z * v.x - q.x * v.z), 2.0f * (q.x * v.y - q.y * v.x)};
+    return {v.x + q.w * t.x + (q.y * t.z - q.z * t.y),
+            v.y + q.w * t.y + (q.z * t.x - q.x * t.z),
+            v.z + q.w * t.z + (q.x * t.y - q.y * t.x)};
+}
+
+// a * b: b given in the frame of a.
+XrPosef Compose(const XrPosef& a, const XrPosef& b)
+{
+    const XrVector3f position = Rotate(a.orientation, b.position);
+    return {Multiply(a.orientation, b.orientation),
+            {a.position.x + position.x, a.position.y + position.y, a.position.z + position.z}};
+}
+
+XrPosef Invert(const XrPosef& pose)
+{
+    const XrQuaternionf inverse = {-pose.orientation.x, -pose.orientation.y, -pose.orientation.z, pose.orientation.w};
+    const XrVector3f position = Rotate(inverse, pose.position);
+    return {inverse, {-position.x, -position.y, -position.z}};
+}
+
+const char* TypeName(XrReferenceSpaceType type)
+{
+    switch (type)
+    {
+        case XR_REFERENCE_SPACE_TYPE_VIEW:
+            return "VIEW";
+        case XR_REFERENCE_SPACE_TYPE_LOCAL:
+            return "LOCAL";
+        case XR_REFERENCE_SPACE_TYPE_STAGE:
+            return "STAGE";
+        case XR_REFERENCE_SPACE_TYPE_LOCAL_FLOOR_EXT:
+            return "LOCAL_FLOOR";
+        default:
+            return "?";
+    }
+}
+
+}  // namespace
+
+
+bool XrReferenceSpace::Create(XrSession session, bool localFloorEnabled)
+{
+    uint32_t typeCount = 0;
+    OPENXR_CHECK(xrEnumerateReferenceSpaces(session, 0, &typeCount, nullptr), "Failed to enumerate ReferenceSpaces.");
+    std::vector<XrReferenceSpaceType> supportedTypes(typeCount);
+    OPENXR_CHECK(xrEnumerateReferenceSpaces(session, typeCount, &typeCount, supportedTypes.data()), "Failed to enumerate ReferenceSpaces.");
+    supportedTypes.resize(typeCount);
+    auto IsSupported = [&](XrReferenceSpaceType type) -> bool
+    {
+        if (type == XR_REFERENCE_SPACE_TYPE_LOCAL_FLOOR_EXT && !localFloorEnabled)
+        {
+            return false;
+        }
+        return std::find(supportedTypes.begin(), supportedTypes.end(), type) != supportedTypes.end();
+    };
+
+    // LOCAL is required by the specification.
+    m_type = m_requestedType;
+    if (m_type == XR_REFERENCE_SPACE_TYPE_LOCAL_FLOOR_EXT && !IsSupported(m_type))
+    {
+        m_type = XR_REFERENCE_SPACE_TYPE_STAGE;
+    }
+    if (m_type != XR_REFERENCE_SPACE_TYPE_LOCAL && !IsSupported(m_type))
+    {
+        m_type = XR_REFERENCE_SPACE_TYPE_LOCAL;
+    }
+    if (m_type != m_requestedType)
+    {
+        XR_TUT_LOG("Reference space " << TypeName(m_requestedType) << " is not supported, using " << TypeName(m_type));
+    }
+
+    XrReferenceSpaceCreateInfo referenceSpaceCI{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+    referenceSpaceCI.referenceSpaceType = m_type;
+    referenceSpaceCI.poseInReferenceSpace = kIdentityPose;
+    OPENXR_CHECK(xrCreateReferenceSpace(session, &referenceSpaceCI, &m_space), "Failed to create ReferenceSpace.");
+
+    referenceSpaceCI.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_VIEW;
+    OPENXR_CHECK(xrCreateReferenceSpace(session, &referenceSpaceCI, &m_viewSpace), "Failed to create the VIEW ReferenceSpace.");
+
+    // A change announced for the destroyed session does not apply to the new one.
+    m_changePending = false;
+    return m_space != XR_NULL_HANDLE;
+}
+
+void XrReferenceSpace::Destroy()
+{
+    for (XrSpace* space : {&m_space, &m_viewSpace})
+    {
+        if (*space != XR_NULL_HANDLE)
+        {
+            OPENXR_CHECK(xrDestroySpace(*space), "Failed to destroy ReferenceSpace.");
+            *space = XR_NULL_HANDLE;
+        }
+    }
+    m_changePending = false;
+}
+
+void XrReferenceSpace::OnChangePending(const XrEventDataReferenceSpaceChangePending& event)
+{
+    if (event.referenceSpaceType != m_type || m_space == XR_NULL_HANDLE)
+    {
+        return;
+    }
+    // A second change before the first one is due replaces it, the runtime reports it against the
+    // space as it will be after the first.
+    if (m_changePending)
+    {
+        ApplyChange();
+    }
+    m_pendingChange = event;
+    m_changePending = true;
+}
+
+void XrReferenceSpace::Update(XrTime displayTime)
+{
+    if (m_changePending && displayTime >= m_pendingChange.changeTime)
+    {
+        ApplyChange();
+    }
+    if (m_recenterRequested.exchange(false, std::memory_order_relaxed))
+    {
+        Recenter(displayTime);
+    }
+}
+
+void XrReferenceSpace::ApplyChange()
+{
+    m_changePending = false;
+    if (m_type != XR_REFERENCE_SPACE_TYPE_STAGE)
+    {
+        if (m_recentered)
+        {
+            XR_TUT_LOG("Reference space " << TypeName(m_type) << " recentered by the runtime, application recentering reset");
+        }
+        ResetRecenter();
+        return;
+    }
+
+    if (m_recentered && m_pendingChange.poseValid)
+    {
+        // poseInPreviousSpace is the new origin in the old space.
+        SetRecenterPose(Compose(Invert(m_pendingChange.poseInPreviousSpace), m_recenterPose));
+    }
+    XR_TUT_LOG("Reference space STAGE changed" << (m_pendingChange.poseValid ? "" : ", pose unknown"));
+}
+
+void XrReferenceSpace::Recenter(XrTime displayTime)
+{
+    XrSpaceLocation headLocation{XR_TYPE_SPACE_LOCATION};
+    XrResult result = xrLocateSpace(m_viewSpace, m_space, displayTime, &headLocation);
+    const XrSpaceLocationFlags requiredFlags = XR_SPACE_LOCATION_POSITION_VALID_BIT | XR_SPACE_LOCATION_ORIENTATION_VALID_BIT;
+    if (XR_FAILED(result) || (headLocation.locationFlags & requiredFlags) != requiredFlags)
+    {
+        XR_TUT_LOG_ERROR("Recentering skipped, the head is not tracked.");
+        return;
+    }
+
+    // Heading of the head's forward (-Z) on the floor plane.
+    const XrPosef& head = headLocation.pose;
+    const XrVector3f forward = Rotate(head.orientation, {0.0f, 0.0f, -1.0f});
+    const float yaw = std::atan2(-forward.x, -forward.z);
+
+    XrPosef recenterPose;
+    recenterPose.orientation = {0.0f, std::sin(yaw * 0.5f), 0.0f, std::cos(yaw * 0.5f)};
+    recenterPose.position = {head.position.x, m_type == XR_REFERENCE_SPACE_TYPE_LOCAL ? head.position.y : 0.0f, head.position.z};
+    SetRecenterPose(recenterPose);
+    m_recentered = true;
+}
+
+void XrReferenceSpace::ResetRecenter()
+{
+    SetRecenterPose(kIdentityPose);
+    m_recentered = false;
+}
+
+void XrReferenceSpace::SetRecenterPose(const XrPosef& pose)
+{
+    m_recenterPose = pose;
+    m_applicationFromSpace = Invert(pose);
+}
+
+XrPosef XrReferenceSpace::ToApplicationSpace(const XrPosef& poseInSpace) const
+{
+    return Compose(m_applicationFromSpace, poseInSpace);
+}
+
+XrPosef XrReferenceSpace::FromApplicationSpace(const XrPosef& poseInApplicationSpace) const
+{
+    return Compose(m_recenterPose, poseInApplicationSpace);
+}
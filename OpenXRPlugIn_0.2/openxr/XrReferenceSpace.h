@@ -0,0 +1,67 @@
+#pragma once
+
+#include "openxr.h"
+#include <atomic>
+
+
+// The reference space the views, hands and layers are located in, and the recentering on top of it.
+//
+// The space is created once per session. Recentering does not touch it: the application origin is a
+// cached pose in the reference space (GetRecenterPose()) and ToApplicationSpace() moves located poses
+// into it, so recentering costs one xrLocateSpace and reallocates nothing.
+//
+// A REFERENCE_SPACE_CHANGE_PENDING of the active type is applied at its changeTime. For LOCAL and
+// LOCAL_FLOOR the runtime recentered (system menu), which replaces the application recentering. For
+// STAGE the play area moved; an application recentering is carried over with poseInPreviousSpace so
+// its origin stays where the user put it.
+class XrReferenceSpace
+{
+public:
+    // The type to create, falls back to the next supported one: LOCAL_FLOOR -> STAGE -> LOCAL.
+    // Takes effect with the next session.
+    void SetRequestedType(XrReferenceSpaceType type) { m_requestedType = type; }
+    XrReferenceSpaceType GetRequestedType() const { return m_requestedType; }
+
+    // localFloorEnabled: XR_EXT_local_floor is enabled on the instance.
+    bool Create(XrSession session, bool localFloorEnabled);
+    void Destroy();
+
+    XrSpace GetSpace() const { return m_space; }
+    // Head locked space, for layers that follow the head.
+    XrSpace GetViewSpace() const { return m_viewSpace; }
+    XrReferenceSpaceType GetType() const { return m_type; }
+
+    void OnChangePending(const XrEventDataReferenceSpaceChangePending& event);
+    // Once per frame with the predicted display time: applies a due change and a requested recentering.
+    void Update(XrTime displayTime);
+
+    // Recentering on the head at the next Update(): position on the floor plane (with the head height
+    // for LOCAL) and the heading, without pitch and roll. Callable from any thread.
+    void RequestRecenter() { m_recenterRequested.store(true, std::memory_order_relaxed); }
+    void ResetRecenter();
+    const XrPosef& GetRecenterPose() const { return m_recenterPose; }
+
+    // Pose located in the reference space -> the same pose in the recentered application space.
+    XrPosef ToApplicationSpace(const XrPosef& poseInSpace) const;
+    // And back, for poses the application submits (layers).
+    XrPosef FromApplicationSpace(const XrPosef& poseInApplicationSpace) const;
+
+private:
+    void ApplyChange();
+    void Recenter(XrTime displayTime);
+    void SetRecenterPose(const XrPosef& pose);
+
+    XrReferenceSpaceType m_requestedType = XR_REFERENCE_SPACE_TYPE_STAGE;
+    XrReferenceSpaceType m_type = XR_REFERENCE_SPACE_TYPE_STAGE;
+    XrSpace m_space = XR_NULL_HANDLE;
+    // Head, located in m_space to recenter.
+    XrSpace m_viewSpace = XR_NULL_HANDLE;
+
+    XrPosef m_recenterPose = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
+    XrPosef m_applicationFromSpace = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
+    bool m_recentered = false;
+    std::atomic<bool> m_recenterRequested{false};
+
+    bool m_changePending = false;
+    XrEventDataReferenceSpaceChangePending m_pendingChange = {XR_TYPE_EVENT_DATA_REFERENCE_SPACE_CHANGE_PENDING};
+};
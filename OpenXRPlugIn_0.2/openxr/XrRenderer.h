@@ -0,0 +1,86 @@
+#pragma once
+
+#include "openxr.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
+
+
+// Everything the renderer needs to draw one eye. Filled once per frame for all views. The plug-in
+// never writes an ECS transform; BeeXrRenderer only sets the projection of the XR camera.
+struct XrViewCamera
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 position = glm::vec3(0.0f);
+};
+
+// Swapchain image acquired for a view. It stays acquired until RenderFrame() returns.
+struct XrRenderTarget
+{
+    uint32_t viewIndx = 0;
+    uint32_t swapchainImageIndx = 0;
+    uint64_t image = 0;               // Acquired swapchain image: GL texture name or VkImage, see XrGraphicsBackend
+    int64_t format = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+};
+
+struct XrRenderView
+{
+    uint32_t viewIndx = 0;
+    XrView view = {XR_TYPE_VIEW};
+    XrViewCamera camera = {};
+    XrRenderTarget target = {};
+};
+
+// One frame worth of views, handed to the renderer in a single call.
+struct XrRenderFrame
+{
+    uint64_t frameIndx = 0;
+    XrTime predictedDisplayTime = 0;
+    const XrRenderView* views = nullptr;
+    uint32_t viewCount = 0;
+};
+
+
+// Stage a render pass belongs to. PerFrame passes do not depend on the eye (shadow maps, light
+// clustering, probes, post-process setup) and run once per frame right after xrLocateViews, before any
+// swapchain image is acquired. PerView passes run once for every eye inside XrRenderer::RenderFrame().
+enum class XrRenderStage
+{
+    PerFrame,
+    PerView,
+    Count
+};
+
+// Render hook registered on the plug-in with OpenxrPlugIn::AddRenderPass(). The view is nullptr for
+// PerFrame passes.
+using XrRenderPassFunction = std::function<void(const XrRenderFrame& frame, const XrRenderView* view)>;
+
+struct XrRenderPass
+{
+    uint32_t id = 0;
+    const char* name = "";
+    XrRenderPassFunction execute;
+};
+
+
+// Interface the plug-in renders through. It is called once per frame with every view and its
+// acquired target, so an implementation is free to batch the eyes, reorder passes and share work.
+// Implementations run the PerView render hooks with OpenxrPlugIn::ExecuteRenderPasses() for each eye.
+class XrRenderer
+{
+public:
+    virtual ~XrRenderer() = default;
+
+    virtual void RenderFrame(const XrRenderFrame& frame) = 0;
+};
+
+
+// Renders nothing. Used to measure the cost of the XR frame loop on its own.
+class NullXrRenderer : public XrRenderer
+{
+public:
+    void RenderFrame(const XrRenderFrame& frame) override { (void)frame; }
+};
@@ -0,0 +1,236 @@
+#include "XrSessionRecording.h"
+
+#include "DebugOutput.h"
+
+#include <cstring>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+XrSessionRecordingFile::~XrSessionRecordingFile()
+{
+    Close();
+}
+
+bool XrSessionRecordingFile::Create(const std::string& path)
+{
+    Close();
+    m_path = path;
+    m_writable = true;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    m_file = file != INVALID_HANDLE_VALUE ? file : nullptr;
+    if (m_file == nullptr)
+#else
+    m_file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_file < 0)
+#endif
+    {
+        XR_TUT_LOG_ERROR("Failed to create session recording " << path);
+        return false;
+    }
+
+    if (!Map(sizeof(Header) + kGrowFrames * sizeof(XrRecordedFrame)))
+    {
+        Close();
+        return false;
+    }
+    Header* header = GetHeader();
+    std::memcpy(header->magic, "BXRR", 4);
+    header->version = kFileVersion;
+    header->frameSize = sizeof(XrRecordedFrame);
+    header->maxViews = XrRecordedFrame::kMaxViews;
+    header->frameCount = 0;
+    return true;
+}
+
+bool XrSessionRecordingFile::Open(const std::string& path)
+{
+    Close();
+    m_path = path;
+    m_writable = false;
+
+    uint64_t size = 0;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    m_file = file != INVALID_HANDLE_VALUE ? file : nullptr;
+    LARGE_INTEGER fileSize{};
+    if (m_file != nullptr && GetFileSizeEx(m_file, &fileSize))
+    {
+        size = static_cast<uint64_t>(fileSize.QuadPart);
+    }
+    if (m_file == nullptr)
+#else
+    m_file = open(path.c_str(), O_RDONLY);
+    struct stat fileStat{};
+    if (m_file >= 0 && fstat(m_file, &fileStat) == 0)
+    {
+        size = static_cast<uint64_t>(fileStat.st_size);
+    }
+    if (m_file < 0)
+#endif
+    {
+        XR_TUT_LOG_ERROR("Failed to open session recording " << path);
+        return false;
+    }
+
+    if (size < sizeof(Header) || !Map(size))
+    {
+        XR_TUT_LOG_ERROR("Session recording " << path << " is empty or cannot be mapped");
+        Close();
+        return false;
+    }
+    const Header* header = GetHeader();
+    if (std::memcmp(header->magic, "BXRR", 4) != 0 || header->version != kFileVersion ||
+        header->frameSize != sizeof(XrRecordedFrame) || header->maxViews != XrRecordedFrame::kMaxViews ||
+        header->frameCount > (size - sizeof(Header)) / sizeof(XrRecordedFrame))
+    {
+        XR_TUT_LOG_ERROR("Session recording " << path << " was written by a different build or is truncated");
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void XrSessionRecordingFile::Close()
+{
+    const uint64_t usedSize = m_data != nullptr ? sizeof(Header) + GetFrameCount() * sizeof(XrRecordedFrame) : 0;
+    Unmap();
+
+#if defined(_WIN32)
+    if (m_file != nullptr)
+    {
+        if (m_writable && usedSize > 0)
+        {
+            LARGE_INTEGER end{};
+            end.QuadPart = static_cast<LONGLONG>(usedSize);
+            SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN);
+            SetEndOfFile(m_file);
+        }
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+#else
+    if (m_file >= 0)
+    {
+        if (m_writable && usedSize > 0 && ftruncate(m_file, static_cast<off_t>(usedSize)) != 0)
+        {
+            XR_TUT_LOG_ERROR("Failed to trim session recording " << m_path);
+        }
+        close(m_file);
+        m_file = -1;
+    }
+#endif
+}
+
+bool XrSessionRecordingFile::Append(const XrRecordedFrame& frame)
+{
+    if (!m_writable || m_data == nullptr)
+    {
+        return false;
+    }
+
+    const uint64_t frameCount = GetHeader()->frameCount;
+    const uint64_t requiredSize = sizeof(Header) + (frameCount + 1) * sizeof(XrRecordedFrame);
+    if (requiredSize > m_mappedSize && !Map(m_mappedSize + kGrowFrames * sizeof(XrRecordedFrame)))
+    {
+        return false;
+    }
+
+    XrRecordedFrame& stored = GetFrames()[frameCount];
+    stored = frame;
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        stored.handPoseState[i].next = nullptr;
+    }
+    for (XrActionStateFloat& state : stored.floatStates)
+    {
+        state.next = nullptr;
+    }
+    for (XrActionStateBoolean& state : stored.booleanStates)
+    {
+        state.next = nullptr;
+    }
+    for (XrView& view : stored.views)
+    {
+        view.next = nullptr;
+    }
+    // Counted only once the frame is complete.
+    GetHeader()->frameCount = frameCount + 1;
+    return true;
+}
+
+uint64_t XrSessionRecordingFile::GetFrameCount() const
+{
+    return m_data != nullptr ? GetHeader()->frameCount : 0;
+}
+
+const XrRecordedFrame& XrSessionRecordingFile::GetFrame(uint64_t indx) const
+{
+    return GetFrames()[indx];
+}
+
+bool XrSessionRecordingFile::Map(uint64_t size)
+{
+    Unmap();
+
+#if defined(_WIN32)
+    const DWORD protect = m_writable ? PAGE_READWRITE : PAGE_READONLY;
+    m_mapping = CreateFileMappingA(m_file, nullptr, protect, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+    if (m_mapping != nullptr)
+    {
+        m_data = static_cast<uint8_t*>(MapViewOfFile(m_mapping, m_writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size));
+    }
+#else
+    if (m_writable && ftruncate(m_file, static_cast<off_t>(size)) != 0)
+    {
+        XR_TUT_LOG_ERROR("Failed to grow session recording " << m_path);
+        return false;
+    }
+    void* data = mmap(nullptr, size, m_writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_file, 0);
+    m_data = data != MAP_FAILED ? static_cast<uint8_t*>(data) : nullptr;
+#endif
+
+    if (m_data == nullptr)
+    {
+        XR_TUT_LOG_ERROR("Failed to map session recording " << m_path);
+        Unmap();
+        return false;
+    }
+    m_mappedSize = size;
+    return true;
+}
+
+void XrSessionRecordingFile::Unmap()
+{
+#if defined(_WIN32)
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+#else
+    if (m_data != nullptr)
+    {
+        munmap(m_data, m_mappedSize);
+    }
+#endif
+    m_data = nullptr;
+    m_mappedSize = 0;
+}
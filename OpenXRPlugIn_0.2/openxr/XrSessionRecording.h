@@ -0,0 +1,91 @@
+#pragma once
+
+#include "openxr.h"
+#include <cstdint>
+#include <string>
+
+
+// Everything the plug-in takes from the runtime in one frame: the frame timing, the located views,
+// the hand poses and every action state. Stored as is, so a replay is bit exact. Pointers (next)
+// are cleared before a frame is stored.
+struct XrRecordedFrame
+{
+    static constexpr uint32_t kMaxViews = 4;
+    static constexpr uint32_t kFloatActions = 10;
+    static constexpr uint32_t kBooleanActions = 9;
+
+    uint64_t frameIndx = 0;
+    XrTime predictedDisplayTime = 0;
+    XrDuration predictedDisplayPeriod = 0;
+    XrBool32 shouldRender = XR_FALSE;
+    XrSessionState sessionState = XR_SESSION_STATE_UNKNOWN;
+
+    // Input, valid when inputValid is set (the session was focused and rendering).
+    XrBool32 inputValid = XR_FALSE;
+    XrActionStatePose handPoseState[2] = {};
+    XrPosef handPose[2] = {};
+    XrActionStateFloat floatStates[kFloatActions] = {};
+    XrActionStateBoolean booleanStates[kBooleanActions] = {};
+
+    // Views, valid when viewCount > 0.
+    XrViewStateFlags viewStateFlags = 0;
+    uint32_t viewCount = 0;
+    XrView views[kMaxViews] = {};
+};
+
+
+// Append-only file of XrRecordedFrame, memory mapped: appending a frame is a copy into the mapping,
+// the operating system writes the pages back. The file grows in steps and is cut to its frames on
+// Close(). The frame count in the header is updated after each frame, so a file of a crashed session
+// still holds every complete frame.
+//
+// The file stores the structs in memory layout, it only replays on a build with the same layout
+// (same XrRecordedFrame and pointer size); Open() rejects other files.
+class XrSessionRecordingFile
+{
+public:
+    XrSessionRecordingFile() = default;
+    ~XrSessionRecordingFile();
+
+    XrSessionRecordingFile(const XrSessionRecordingFile&) = delete;
+    XrSessionRecordingFile& operator=(const XrSessionRecordingFile&) = delete;
+
+    bool Create(const std::string& path);
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return m_data != nullptr; }
+
+    bool Append(const XrRecordedFrame& frame);
+    uint64_t GetFrameCount() const;
+    const XrRecordedFrame& GetFrame(uint64_t indx) const;
+
+private:
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t frameSize;
+        uint32_t maxViews;
+        uint64_t frameCount;
+    };
+
+    static constexpr uint32_t kFileVersion = 1;
+    static constexpr uint64_t kGrowFrames = 1024;
+
+    Header* GetHeader() const { return reinterpret_cast<Header*>(m_data); }
+    XrRecordedFrame* GetFrames() const { return reinterpret_cast<XrRecordedFrame*>(m_data + sizeof(Header)); }
+    bool Map(uint64_t size);
+    void Unmap();
+
+    std::string m_path;
+    bool m_writable = false;
+    uint8_t* m_data = nullptr;
+    uint64_t m_mappedSize = 0;
+
+#if defined(_WIN32)
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+};
@@ -0,0 +1,267 @@
+#include "XrStructSerializer.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+
+namespace
+{
+
+#define XR_STRUCT_ENUM_CASE(name, value) \
+    case name:                           \
+        return #name;
+
+#define XR_STRUCT_ENUM_NAME(enumType)                   \
+    const char* EnumName(enumType value)                \
+    {                                                   \
+        switch (value)                                  \
+        {                                               \
+            XR_LIST_ENUM_##enumType(XR_STRUCT_ENUM_CASE) \
+        default:                                        \
+            return nullptr;                             \
+        }                                               \
+    }
+
+// Enums printed by name, the others as numbers.
+XR_STRUCT_ENUM_NAME(XrStructureType)
+XR_STRUCT_ENUM_NAME(XrResult)
+XR_STRUCT_ENUM_NAME(XrSessionState)
+XR_STRUCT_ENUM_NAME(XrFormFactor)
+XR_STRUCT_ENUM_NAME(XrViewConfigurationType)
+XR_STRUCT_ENUM_NAME(XrEnvironmentBlendMode)
+XR_STRUCT_ENUM_NAME(XrReferenceSpaceType)
+XR_STRUCT_ENUM_NAME(XrActionType)
+XR_STRUCT_ENUM_NAME(XrEyeVisibility)
+
+#undef XR_STRUCT_ENUM_NAME
+#undef XR_STRUCT_ENUM_CASE
+
+template <typename E>
+const char* EnumName(E)
+{
+    return nullptr;
+}
+
+// Reads members in the order XrStructWriter wrote them and prints them on one line.
+class StructPrinter
+{
+public:
+    StructPrinter(const uint8_t* data, size_t size, std::ostream& out) : m_data(data), m_size(size), m_out(out) {}
+
+    bool Failed() const { return m_failed; }
+    size_t Consumed() const { return m_offset; }
+
+    template <typename T>
+    void PrintStruct()
+    {
+        const T layout{};
+        bool first = true;
+        m_out << "{";
+        XrStructReflection<T>::Visit(layout,
+                                     [this, &first](const char* name, const auto& member)
+                                     {
+                                         using M = std::decay_t<decltype(member)>;
+                                         if constexpr (std::is_pointer_v<M> && std::is_void_v<std::remove_pointer_t<M>>)
+                                         {
+                                             return;  // next and other void pointers are not written
+                                         }
+                                         m_out << (first ? " " : ", ") << name << " = ";
+                                         first = false;
+                                         PrintValue<std::remove_cv_t<std::remove_reference_t<decltype(member)>>>();
+                                     });
+        m_out << (first ? "}" : " }");
+    }
+
+private:
+    template <typename M>
+    void PrintValue()
+    {
+        if constexpr (xr_struct_detail::IsString<M>() ||
+                      (std::is_array_v<M> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<M>>, char>))
+        {
+            uint32_t length = 0;
+            if (!Read(&length, sizeof(length)) || length > m_size - m_offset)
+            {
+                m_failed = true;
+                return;
+            }
+            m_out << '"';
+            m_out.write(reinterpret_cast<const char*>(m_data + m_offset), length);
+            m_out << '"';
+            m_offset += length;
+        }
+        else if constexpr (std::is_array_v<M>)
+        {
+            m_out << "[";
+            for (size_t i = 0; i < std::extent_v<M> && !m_failed; i++)
+            {
+                m_out << (i == 0 ? "" : ", ");
+                PrintValue<std::remove_cv_t<std::remove_extent_t<M>>>();
+            }
+            m_out << "]";
+        }
+        else if constexpr (xr_struct_detail::IsHandle<M>())
+        {
+            uint64_t handle = 0;
+            if (Read(&handle, sizeof(handle)))
+            {
+                char text[24];
+                snprintf(text, sizeof(text), "0x%" PRIx64, handle);
+                m_out << text;
+            }
+        }
+        else if constexpr (std::is_pointer_v<M>)
+        {
+            m_out << "<not captured>";
+        }
+        else if constexpr (XrStructReflection<M>::kReflected)
+        {
+            PrintStruct<M>();
+        }
+        else if constexpr (std::is_enum_v<M>)
+        {
+            M value{};
+            if (Read(&value, sizeof(value)))
+            {
+                const char* name = EnumName(value);
+                if (name != nullptr)
+                    m_out << name;
+                else
+                    m_out << static_cast<int64_t>(value);
+            }
+        }
+        else if constexpr (std::is_floating_point_v<M>)
+        {
+            M value{};
+            if (Read(&value, sizeof(value)))
+            {
+                m_out << value;
+            }
+        }
+        else if constexpr (std::is_integral_v<M>)
+        {
+            M value{};
+            if (Read(&value, sizeof(value)))
+            {
+                m_out << +value;
+            }
+        }
+        else
+        {
+            if (sizeof(M) > m_size - m_offset)
+            {
+                m_failed = true;
+                return;
+            }
+            m_out << "<" << sizeof(M) << " bytes>";
+            m_offset += sizeof(M);
+        }
+    }
+
+    bool Read(void* value, size_t size)
+    {
+        if (m_failed || size > m_size - m_offset)
+        {
+            m_failed = true;
+            return false;
+        }
+        std::memcpy(value, m_data + m_offset, size);
+        m_offset += size;
+        return true;
+    }
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+    bool m_failed = false;
+    std::ostream& m_out;
+};
+
+template <typename T>
+bool PrintBlock(const uint8_t* payload, uint32_t payloadBytes, std::ostream& out)
+{
+    out << XrStructReflection<T>::kName << " ";
+    StructPrinter printer(payload, payloadBytes, out);
+    printer.PrintStruct<T>();
+    out << "\n";
+    return !printer.Failed() && printer.Consumed() == payloadBytes;
+}
+
+bool PrintBlock(XrStructureType type, const uint8_t* payload, uint32_t payloadBytes, std::ostream& out)
+{
+    switch (type)
+    {
+#define XR_STRUCT_PRINT_CASE(structName, structType) \
+    case structType:                                 \
+        return PrintBlock<structName>(payload, payloadBytes, out);
+        XR_LIST_ALL_STRUCTURE_TYPES(XR_STRUCT_PRINT_CASE, XR_STRUCT_UNAVAILABLE)
+#undef XR_STRUCT_PRINT_CASE
+    default:
+    {
+        const char* name = EnumName(type);
+        if (name != nullptr)
+            out << name;
+        else
+            out << "XrStructureType " << static_cast<int64_t>(type);
+        out << " <" << payloadBytes << " bytes, not in this build>\n";
+        return true;
+    }
+    }
+}
+
+}  // namespace
+
+
+void XrStructWriter::WriteChained(const XrBaseInStructure* s)
+{
+    switch (s->type)
+    {
+#define XR_STRUCT_WRITE_CASE(structName, structType)               \
+    case structType:                                               \
+        WriteBlock(*reinterpret_cast<const structName*>(s));       \
+        return;
+        XR_LIST_ALL_STRUCTURE_TYPES(XR_STRUCT_WRITE_CASE, XR_STRUCT_UNAVAILABLE)
+#undef XR_STRUCT_WRITE_CASE
+    default:
+    {
+        // Unknown to this build: the type alone.
+        const uint32_t block[2] = {static_cast<uint32_t>(s->type), 0};
+        WriteBytes(block, sizeof(block));
+        return;
+    }
+    }
+}
+
+size_t XrDecodeStructRecord(const uint8_t* data, size_t size, std::ostream& out)
+{
+    uint16_t count = 0;
+    if (size < sizeof(count))
+    {
+        return 0;
+    }
+    std::memcpy(&count, data, sizeof(count));
+    size_t offset = sizeof(count);
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint32_t header[2];
+        if (size - offset < sizeof(header))
+        {
+            return 0;
+        }
+        std::memcpy(header, data + offset, sizeof(header));
+        offset += sizeof(header);
+        if (header[1] > size - offset)
+        {
+            return 0;
+        }
+
+        out << (i == 0 ? "" : "  next: ");
+        if (!PrintBlock(static_cast<XrStructureType>(header[0]), data + offset, header[1], out))
+        {
+            return 0;
+        }
+        offset += header[1];
+    }
+    return offset;
+}
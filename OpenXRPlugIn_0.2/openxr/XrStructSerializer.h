@@ -0,0 +1,214 @@
+#pragma once
+
+#include "openxr.h"
+#include "openxr_reflection.h"
+#include "openxr_reflection_structs.h"
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+
+// Binary records of OpenXR structs, generated at compile time from the XR_LIST_STRUCT_* tables of
+// openxr_reflection.h: no runtime reflection tables, writing a struct is a sequence of member copies.
+//
+// A record is the struct and its next chain:
+//   uint16 struct count, then per struct: uint32 XrStructureType, uint32 payload bytes, payload.
+// The payload holds the members in declaration order, without tags: arithmetic, enum and handle
+// members as their bytes, fixed size char arrays and const char* as uint32 length and characters,
+// other arrays element by element and reflected structs member by member. void pointers (next among
+// them) and pointers to arrays are not captured. XrDecodeStructRecord() reads the same layout with
+// the same generated code, so the two cannot drift apart.
+
+// Members of a struct, specialized below for every struct type the headers make available.
+template <typename T>
+struct XrStructReflection
+{
+    static constexpr bool kReflected = false;
+};
+
+#define XR_STRUCT_VISIT_MEMBER(member) visitor(#member, s.member);
+
+#define XR_STRUCT_REFLECT(structName, structType)                                     \
+    template <>                                                                       \
+    struct XrStructReflection<structName>                                             \
+    {                                                                                 \
+        static constexpr bool kReflected = true;                                      \
+        static constexpr XrStructureType kType = structType;                          \
+        static constexpr const char* kName = #structName;                             \
+        template <typename S, typename Visitor>                                       \
+        static void Visit(S& s, Visitor&& visitor)                                    \
+        {                                                                             \
+            XR_LIST_STRUCT_##structName(XR_STRUCT_VISIT_MEMBER)                       \
+        }                                                                             \
+    };
+
+#define XR_STRUCT_REFLECT_UNTYPED(structName) XR_STRUCT_REFLECT(structName, XR_TYPE_UNKNOWN)
+#define XR_STRUCT_UNAVAILABLE(structName, structType)
+
+XR_LIST_ALL_STRUCTURE_TYPES(XR_STRUCT_REFLECT, XR_STRUCT_UNAVAILABLE)
+
+// Structs without a type member are only listed per struct; these are the ones used as members of
+// the structs the plug-in traces. Others are written as their bytes.
+XR_STRUCT_REFLECT_UNTYPED(XrVector2f)
+XR_STRUCT_REFLECT_UNTYPED(XrVector3f)
+XR_STRUCT_REFLECT_UNTYPED(XrVector4f)
+XR_STRUCT_REFLECT_UNTYPED(XrQuaternionf)
+XR_STRUCT_REFLECT_UNTYPED(XrPosef)
+XR_STRUCT_REFLECT_UNTYPED(XrFovf)
+XR_STRUCT_REFLECT_UNTYPED(XrColor4f)
+XR_STRUCT_REFLECT_UNTYPED(XrOffset2Di)
+XR_STRUCT_REFLECT_UNTYPED(XrExtent2Di)
+XR_STRUCT_REFLECT_UNTYPED(XrRect2Di)
+XR_STRUCT_REFLECT_UNTYPED(XrExtent2Df)
+XR_STRUCT_REFLECT_UNTYPED(XrSwapchainSubImage)
+XR_STRUCT_REFLECT_UNTYPED(XrApplicationInfo)
+XR_STRUCT_REFLECT_UNTYPED(XrSystemGraphicsProperties)
+XR_STRUCT_REFLECT_UNTYPED(XrSystemTrackingProperties)
+
+namespace xr_struct_detail
+{
+
+// Handles are pointers to structs that are never defined (uint64_t on 32 bit builds).
+template <typename T, typename = void>
+struct IsComplete : std::false_type
+{};
+template <typename T>
+struct IsComplete<T, std::void_t<decltype(sizeof(T))>> : std::true_type
+{};
+
+template <typename M>
+constexpr bool IsHandle()
+{
+    if constexpr (std::is_pointer_v<M>)
+    {
+        using Pointee = std::remove_cv_t<std::remove_pointer_t<M>>;
+        return !std::is_void_v<Pointee> && !IsComplete<Pointee>::value;
+    }
+    return false;
+}
+
+template <typename M>
+constexpr bool IsString()
+{
+    return std::is_same_v<M, const char*> || std::is_same_v<M, char*>;
+}
+
+}  // namespace xr_struct_detail
+
+
+class XrStructWriter
+{
+public:
+    explicit XrStructWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    // Appends one record: the struct and every struct of its next chain.
+    template <typename T>
+    void Write(const T& s)
+    {
+        static_assert(XrStructReflection<T>::kReflected && XrStructReflection<T>::kType != XR_TYPE_UNKNOWN,
+                      "Records start with a struct that has a type member");
+        const size_t countOffset = m_out.size();
+        uint16_t count = 1;
+        WriteBytes(&count, sizeof(count));
+        WriteBlock(s);
+        for (auto chained = static_cast<const XrBaseInStructure*>(s.next); chained != nullptr && count < UINT16_MAX;
+             chained = chained->next)
+        {
+            WriteChained(chained);
+            count++;
+        }
+        std::memcpy(m_out.data() + countOffset, &count, sizeof(count));
+    }
+
+    // Appends one struct block, used for the structs of a next chain.
+    template <typename T>
+    void WriteBlock(const T& s)
+    {
+        const uint32_t type = static_cast<uint32_t>(XrStructReflection<T>::kType);
+        WriteBytes(&type, sizeof(type));
+        const size_t sizeOffset = m_out.size();
+        uint32_t payloadBytes = 0;
+        WriteBytes(&payloadBytes, sizeof(payloadBytes));
+        XrStructReflection<T>::Visit(s, *this);
+        payloadBytes = static_cast<uint32_t>(m_out.size() - sizeOffset - sizeof(payloadBytes));
+        std::memcpy(m_out.data() + sizeOffset, &payloadBytes, sizeof(payloadBytes));
+    }
+
+    template <typename M>
+    void operator()(const char*, const M& member)
+    {
+        WriteValue(member);
+    }
+
+private:
+    // Dispatches on the type member, instantiated for every reflected struct in XrStructSerializer.cpp.
+    void WriteChained(const XrBaseInStructure* s);
+
+    template <typename M>
+    void WriteValue(const M& value)
+    {
+        if constexpr (xr_struct_detail::IsString<M>())
+        {
+            WriteString(value, value != nullptr ? strlen(value) : 0);
+        }
+        else if constexpr (std::is_array_v<M> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<M>>, char>)
+        {
+            size_t length = 0;
+            while (length < std::extent_v<M> && value[length] != '\0')
+            {
+                length++;
+            }
+            WriteString(value, length);
+        }
+        else if constexpr (std::is_array_v<M>)
+        {
+            for (const auto& element : value)
+            {
+                WriteValue(element);
+            }
+        }
+        else if constexpr (xr_struct_detail::IsHandle<M>())
+        {
+            const uint64_t handle = reinterpret_cast<uintptr_t>(value);
+            WriteBytes(&handle, sizeof(handle));
+        }
+        else if constexpr (std::is_pointer_v<M>)
+        {
+            // Not captured.
+        }
+        else if constexpr (XrStructReflection<M>::kReflected)
+        {
+            XrStructReflection<M>::Visit(value, *this);
+        }
+        else
+        {
+            static_assert(std::is_trivially_copyable_v<M>);
+            WriteBytes(&value, sizeof(value));
+        }
+    }
+
+    void WriteString(const char* text, size_t length)
+    {
+        const uint32_t length32 = static_cast<uint32_t>(length);
+        WriteBytes(&length32, sizeof(length32));
+        WriteBytes(text, length);
+    }
+
+    void WriteBytes(const void* data, size_t size)
+    {
+        const size_t offset = m_out.size();
+        m_out.resize(offset + size);
+        if (size > 0)
+        {
+            std::memcpy(m_out.data() + offset, data, size);
+        }
+    }
+
+    std::vector<uint8_t>& m_out;
+};
+
+// Prints one record written by XrStructWriter::Write() and returns the bytes it took, 0 when the data
+// is truncated or does not match the layout. Structs unknown to this build are skipped by size.
+size_t XrDecodeStructRecord(const uint8_t* data, size_t size, std::ostream& out);
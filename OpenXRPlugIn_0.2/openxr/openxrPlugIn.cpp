@@ -1,18 +1,18 @@
 #include "openxrPlugIn.h"
 #include "core/engine.hpp"
 #include "core/device.hpp"
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <iostream>
+#include <thread>
 #include "DebugOutput.h"
 
 #include "OpenXRDebugUtils.h"
+#include "XrFrameTrace.h"
 
 
-#define GLFW_EXPOSE_NATIVE_WIN32
-#include <GLFW/glfw3.h>
-#include <GLFW/glfw3native.h>
-
-#include "renderXR_gl.h"
+#include "BeeXrRenderer.h"
 
 #include "core/transform.hpp"
 #include "xr_linear_algebra.h"
@@ -20,10 +20,14 @@
 
 
 OpenxrPlugIn::OpenxrPlugIn()
-{}
+{
+    SubscribeEvents();
+}
 
 OpenxrPlugIn::~OpenxrPlugIn() 
-{}
+{
+    Shutdown();
+}
 
 
 
@@ -31,26 +35,118 @@ OpenxrPlugIn::~OpenxrPlugIn()
 
 bool OpenxrPlugIn::Init() 
 {
-    CreateInstance();
-    CreateDebugMessenger();
+    m_initPhases.clear();
+    RunContextFreeInitPhases(false);
+    RunContextInitPhases();
 
-    GetInstanceProperties();
-    GetSystemID();
+	return true; 
+}
 
-    CreateActionSet();
-    SuggestBindings();
+void OpenxrPlugIn::InitAsync()
+{
+    if (m_initWorker.valid())
+    {
+        XR_TUT_LOG_ERROR("OpenXR init already started.");
+        return;
+    }
+    m_initPhases.clear();
+    // Create the backend here so a SetGraphicsBackend() racing the worker cannot replace it halfway.
+    GetGraphicsBackend();
+    m_initWorker = std::async(std::launch::async, [this]() { RunContextFreeInitPhases(true); });
+}
 
-    GetViewConfigurationViews();
-    GetEnvironmentBlendModes();
+bool OpenxrPlugIn::IsInitReady() const
+{
+    return !m_initWorker.valid() || m_initWorker.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
 
-    CreateSession();
-    CreateActionPoses();    
-    AttachActionSet();
-    CreateReferenceSpace();
+bool OpenxrPlugIn::FinishInit()
+{
+    if (!m_initWorker.valid())
+    {
+        XR_TUT_LOG_ERROR("FinishInit() called without InitAsync().");
+        return false;
+    }
 
-    CreateSwapchains();
+    // Time the render thread spends blocked on the worker, 0 when asset loading covered the whole worker.
+    auto start = std::chrono::steady_clock::now();
+    m_initWorker.get();
+    std::chrono::duration<double, std::milli> wait = std::chrono::steady_clock::now() - start;
+    m_initPhases.push_back({"WaitForWorker", wait.count(), false});
+    XR_TUT_LOG("OpenXR init phase WaitForWorker: " << wait.count() << " ms");
 
-	return true; 
+    RunContextInitPhases();
+    return true;
+}
+
+void OpenxrPlugIn::RunInitPhase(const char* name, void (OpenxrPlugIn::*phase)(), bool onWorker)
+{
+    auto start = std::chrono::steady_clock::now();
+    (this->*phase)();
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+
+    m_initPhases.push_back({name, duration.count(), onWorker});
+    XR_TUT_LOG("OpenXR init phase " << name << (onWorker ? " (worker)" : "") << ": " << duration.count() << " ms");
+}
+
+void OpenxrPlugIn::RunContextFreeInitPhases(bool onWorker)
+{
+    // RecreateInstance() may already have created the instance.
+    if (m_xrInstance == XR_NULL_HANDLE)
+    {
+        RunInitPhase("LoadCapabilityCache", &OpenxrPlugIn::LoadCapabilityCache, onWorker);
+        RunInitPhase("CreateInstance", &OpenxrPlugIn::CreateInstance, onWorker);
+    }
+    if (m_xrInstance == XR_NULL_HANDLE)
+    {
+        return;
+    }
+    RunInitPhase("CreateDebugMessenger", &OpenxrPlugIn::CreateDebugMessenger, onWorker);
+
+    RunInitPhase("GetInstanceProperties", &OpenxrPlugIn::GetInstanceProperties, onWorker);
+    if (m_xrInstance == XR_NULL_HANDLE)
+    {
+        return;
+    }
+    RunInitPhase("GetSystemID", &OpenxrPlugIn::GetSystemID, onWorker);
+
+    RunInitPhase("CreateActionSet", &OpenxrPlugIn::CreateActionSet, onWorker);
+    RunInitPhase("SuggestBindings", &OpenxrPlugIn::SuggestBindings, onWorker);
+
+    RunInitPhase("GetViewConfigurationViews", &OpenxrPlugIn::GetViewConfigurationViews, onWorker);
+    RunInitPhase("GetEnvironmentBlendModes", &OpenxrPlugIn::GetEnvironmentBlendModes, onWorker);
+}
+
+void OpenxrPlugIn::RunContextInitPhases()
+{
+    if (m_xrInstance == XR_NULL_HANDLE)
+    {
+        return;
+    }
+    // The graphics binding captures the context current on this thread.
+    RunInitPhase("CreateSession", &OpenxrPlugIn::CreateSession, false);
+    RunInitPhase("CreateActionPoses", &OpenxrPlugIn::CreateActionPoses, false);
+    RunInitPhase("AttachActionSet", &OpenxrPlugIn::AttachActionSet, false);
+    RunInitPhase("CreateReferenceSpace", &OpenxrPlugIn::CreateReferenceSpace, false);
+
+    RunInitPhase("CreateSwapchains", &OpenxrPlugIn::CreateSwapchains, false);
+    RunInitPhase("SaveCapabilityCache", &OpenxrPlugIn::SaveCapabilityCache, false);
+
+    double total = 0.0;
+    double renderThread = 0.0;
+    for (const InitPhase& phase : m_initPhases)
+    {
+        // The wait overlaps the worker phases, it only counts against the render thread.
+        bool isWait = strcmp(phase.name, "WaitForWorker") == 0;
+        total += isWait ? 0.0 : phase.milliseconds;
+        renderThread += phase.onWorker ? 0.0 : phase.milliseconds;
+    }
+    XR_TUT_LOG("OpenXR init total: " << total << " ms, " << renderThread << " ms of it on the render thread");
+
+    if (m_session != XR_NULL_HANDLE)
+    {
+        m_lifecycleState = XrLifecycleState::SessionIdle;
+    }
 }
 
 void OpenxrPlugIn::CreateInstance() 
@@ -64,11 +160,52 @@ void OpenxrPlugIn::CreateInstance()
 
     m_instanceExtensions.push_back(XR_EXT_DEBUG_UTILS_EXTENSION_NAME);
     // Ensure m_apiType is already defined when we call this line.
-    m_instanceExtensions.push_back(XR_KHR_OPENGL_ENABLE_EXTENSION_NAME);
+    GetGraphicsBackend().GetRequiredExtensions(m_instanceExtensions);
     // AR
     m_instanceExtensions.push_back(XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME);
+    // LOCAL_FLOOR reference space, optional.
+    m_instanceExtensions.push_back(XR_EXT_LOCAL_FLOOR_EXTENSION_NAME);
+    // Sky box layer, optional.
+    m_instanceExtensions.push_back(XR_KHR_COMPOSITION_LAYER_CUBE_EXTENSION_NAME);
+    // Video layers, optional.
+    m_instanceExtensions.push_back(XR_KHR_COMPOSITION_LAYER_CYLINDER_EXTENSION_NAME);
+    m_instanceExtensions.push_back(XR_KHR_COMPOSITION_LAYER_EQUIRECT2_EXTENSION_NAME);
     // m_instanceExtensions.push_back(XR_FB_PASSTHROUGH_EXTENSION_NAME);
 
+    // The available API layers and extensions come from the capability cache when it matched,
+    // otherwise from the runtime.
+    if (!m_useCachedCapabilities)
+    {
+        EnumerateApiLayersAndExtensions();
+    }
+    SelectApiLayersAndExtensions();
+
+    XrInstanceCreateInfo instanceCI{XR_TYPE_INSTANCE_CREATE_INFO};
+    instanceCI.createFlags = 0;
+    instanceCI.applicationInfo = AI;
+    instanceCI.enabledApiLayerCount = static_cast<uint32_t>(m_activeAPILayers.size());
+    instanceCI.enabledApiLayerNames = m_activeAPILayers.data();
+    instanceCI.enabledExtensionCount = static_cast<uint32_t>(m_activeInstanceExtensions.size());
+    instanceCI.enabledExtensionNames = m_activeInstanceExtensions.data();
+    XrResult result = xrCreateInstance(&instanceCI, &m_xrInstance);
+    if (XR_FAILED(result) && m_useCachedCapabilities)
+    {
+        // The runtime changed since the cache was written, retry with what it reports now.
+        XR_TUT_LOG_ERROR("Instance creation with cached capabilities failed (" << int(result) << "), enumerating the runtime.");
+        DiscardCapabilityCache();
+        SelectApiLayersAndExtensions();
+        instanceCI.enabledApiLayerCount = static_cast<uint32_t>(m_activeAPILayers.size());
+        instanceCI.enabledApiLayerNames = m_activeAPILayers.data();
+        instanceCI.enabledExtensionCount = static_cast<uint32_t>(m_activeInstanceExtensions.size());
+        instanceCI.enabledExtensionNames = m_activeInstanceExtensions.data();
+        result = xrCreateInstance(&instanceCI, &m_xrInstance);
+    }
+    OPENXR_CHECK(result, "Failed to create Instance.");
+    m_compositionLayers.SetEnabledExtensions(m_activeInstanceExtensions);
+}
+
+void OpenxrPlugIn::EnumerateApiLayersAndExtensions()
+{
     // Get all the API Layers from the OpenXR runtime.
     uint32_t apiLayerCount = 0;
     std::vector<XrApiLayerProperties> apiLayerProperties;
@@ -77,22 +214,10 @@ void OpenxrPlugIn::CreateInstance()
     OPENXR_CHECK(xrEnumerateApiLayerProperties(apiLayerCount, &apiLayerCount, apiLayerProperties.data()),
                  "Failed to enumerate ApiLayerProperties.");
 
-    // Check the requested API layers against the ones from the OpenXR. If found add it to the Active API Layers.
-    for (auto& requestLayer : m_apiLayers)
+    m_capabilityCache.apiLayers.clear();
+    for (auto& layerProperty : apiLayerProperties)
     {
-        for (auto& layerProperty : apiLayerProperties)
-        {
-            // strcmp returns 0 if the strings match.
-            if (strcmp(requestLayer.c_str(), layerProperty.layerName) != 0)
-            {
-                continue;
-            }
-            else
-            {
-                m_activeAPILayers.push_back(requestLayer.c_str());
-                break;
-            }
-        }
+        m_capabilityCache.apiLayers.push_back(layerProperty.layerName);
     }
 
     // Get all the Instance Extensions from the OpenXR instance.
@@ -104,20 +229,40 @@ void OpenxrPlugIn::CreateInstance()
     OPENXR_CHECK(xrEnumerateInstanceExtensionProperties(nullptr, extensionCount, &extensionCount, extensionProperties.data()),
                  "Failed to enumerate InstanceExtensionProperties.");
 
+    m_capabilityCache.instanceExtensions.clear();
+    for (auto& extensionProperty : extensionProperties)
+    {
+        m_capabilityCache.instanceExtensions.push_back(extensionProperty.extensionName);
+    }
+}
+
+void OpenxrPlugIn::SelectApiLayersAndExtensions()
+{
+    m_activeAPILayers.clear();
+    m_activeInstanceExtensions.clear();
+
+    // Check the requested API layers against the ones from the OpenXR. If found add it to the Active API Layers.
+    for (auto& requestLayer : m_apiLayers)
+    {
+        for (auto& layerName : m_capabilityCache.apiLayers)
+        {
+            if (requestLayer == layerName)
+            {
+                m_activeAPILayers.push_back(requestLayer.c_str());
+                break;
+            }
+        }
+    }
+
     // Check the requested Instance Extensions against the ones from the OpenXR runtime.
     // If an extension is found add it to Active Instance Extensions.
     // Log error if the Instance Extension is not found.
     for (auto& requestedInstanceExtension : m_instanceExtensions)
     {
         bool found = false;
-        for (auto& extensionProperty : extensionProperties)
+        for (auto& extensionName : m_capabilityCache.instanceExtensions)
         {
-            // strcmp returns 0 if the strings match.
-            if (strcmp(requestedInstanceExtension.c_str(), extensionProperty.extensionName) != 0)
-            {
-                continue;
-            }
-            else
+            if (requestedInstanceExtension == extensionName)
             {
                 m_activeInstanceExtensions.push_back(requestedInstanceExtension.c_str());
                 found = true;
@@ -129,15 +274,6 @@ void OpenxrPlugIn::CreateInstance()
             XR_TUT_LOG_ERROR("Failed to find OpenXR instance extension: " << requestedInstanceExtension);
         }
     }
-
-    XrInstanceCreateInfo instanceCI{XR_TYPE_INSTANCE_CREATE_INFO};
-    instanceCI.createFlags = 0;
-    instanceCI.applicationInfo = AI;
-    instanceCI.enabledApiLayerCount = static_cast<uint32_t>(m_activeAPILayers.size());
-    instanceCI.enabledApiLayerNames = m_activeAPILayers.data();
-    instanceCI.enabledExtensionCount = static_cast<uint32_t>(m_activeInstanceExtensions.size());
-    instanceCI.enabledExtensionNames = m_activeInstanceExtensions.data();
-    OPENXR_CHECK(xrCreateInstance(&instanceCI, &m_xrInstance), "Failed to create Instance.");
 }
 
 void OpenxrPlugIn::CreateDebugMessenger() 
@@ -145,10 +281,20 @@ void OpenxrPlugIn::CreateDebugMessenger()
     // Check that "XR_EXT_debug_utils" is in the active Instance Extensions before creating an XrDebugUtilsMessengerEXT.
     if (IsStringInVector(m_activeInstanceExtensions, XR_EXT_DEBUG_UTILS_EXTENSION_NAME))
     {
-        m_debugUtilsMessenger = CreateOpenXRDebugUtilsMessenger(m_xrInstance);  // From OpenXRDebugUtils.h.
+        m_debugUtilsMessenger = CreateOpenXRDebugUtilsMessenger(m_xrInstance, &m_debugMessengerFilter);  // From OpenXRDebugUtils.h.
     }
 }
 
+void OpenxrPlugIn::SetDebugMessengerSettings(const XrDebugMessengerSettings& settings)
+{
+    m_debugMessengerFilter.SetSettings(settings);
+}
+
+XrDebugMessengerStats OpenxrPlugIn::GetDebugMessengerStats() const
+{
+    return m_debugMessengerFilter.GetStats();
+}
+
 void OpenxrPlugIn::GetInstanceProperties() 
 {
     XrInstanceProperties instanceProperties{XR_TYPE_INSTANCE_PROPERTIES};
@@ -158,6 +304,32 @@ void OpenxrPlugIn::GetInstanceProperties()
                                   << XR_VERSION_MAJOR(instanceProperties.runtimeVersion) << "."
                                   << XR_VERSION_MINOR(instanceProperties.runtimeVersion) << "."
                                   << XR_VERSION_PATCH(instanceProperties.runtimeVersion));
+
+    if (m_useCachedCapabilities &&
+        (!m_capabilityCache.MatchesRuntime(instanceProperties.runtimeName, instanceProperties.runtimeVersion) ||
+         m_capabilityCache.graphicsBackend != GetGraphicsBackend().GetName()))
+    {
+        XR_TUT_LOG("Capability cache was written for another runtime or graphics backend, enumerating the runtime.");
+        const std::vector<std::string> cachedApiLayers = m_capabilityCache.apiLayers;
+        const std::vector<std::string> cachedExtensions = m_capabilityCache.instanceExtensions;
+        DiscardCapabilityCache();
+
+        // The instance was created with the layers and extensions selected from the stale cache.
+        if (cachedApiLayers != m_capabilityCache.apiLayers || cachedExtensions != m_capabilityCache.instanceExtensions)
+        {
+            XR_TUT_LOG("Runtime layers or extensions differ from the capability cache, re-creating the instance.");
+            DestroyInstance();
+            CreateInstance();
+            if (m_xrInstance == XR_NULL_HANDLE)
+            {
+                return;
+            }
+            CreateDebugMessenger();
+        }
+    }
+    m_capabilityCache.runtimeName = instanceProperties.runtimeName;
+    m_capabilityCache.runtimeVersion = instanceProperties.runtimeVersion;
+    m_capabilityCache.graphicsBackend = GetGraphicsBackend().GetName();
 }
 
 void OpenxrPlugIn::GetSystemID() 
@@ -171,6 +343,73 @@ void OpenxrPlugIn::GetSystemID()
     OPENXR_CHECK(xrGetSystemProperties(m_xrInstance, m_systemID, &m_systemProperties), "Failed to get SystemProperties.");
 }
 
+void OpenxrPlugIn::LoadCapabilityCache()
+{
+    m_useCachedCapabilities = !m_capabilityCachePath.empty() && m_capabilityCache.Load(m_capabilityCachePath);
+    XR_TUT_LOG("Capability cache " << m_capabilityCachePath << (m_useCachedCapabilities ? " loaded." : " not available."));
+}
+
+void OpenxrPlugIn::DiscardCapabilityCache()
+{
+    // Everything decided from the cache so far gets enumerated again. The instance level lists are
+    // refreshed here so the cache written at the end of the init describes the live runtime.
+    m_useCachedCapabilities = false;
+    EnumerateApiLayersAndExtensions();
+}
+
+void OpenxrPlugIn::ValidateCapabilityCache()
+{
+    if (!m_useCachedCapabilities)
+    {
+        m_capabilityCache.systemVendorId = m_systemProperties.vendorId;
+        m_capabilityCache.systemName = m_systemProperties.systemName;
+        return;
+    }
+
+    // The runtime version does not change with the headset or its settings (resolution scale), so
+    // check the system and the recommended view sizes before the swapchains get created from them.
+    std::vector<XrViewConfigurationView> liveViews;
+    EnumerateViewConfigurationViews(liveViews);
+    bool viewsMatch = liveViews.size() == m_viewConfigurationViews.size();
+    for (size_t i = 0; viewsMatch && i < liveViews.size(); i++)
+    {
+        viewsMatch = liveViews[i].recommendedImageRectWidth == m_viewConfigurationViews[i].recommendedImageRectWidth &&
+                     liveViews[i].recommendedImageRectHeight == m_viewConfigurationViews[i].recommendedImageRectHeight &&
+                     liveViews[i].recommendedSwapchainSampleCount == m_viewConfigurationViews[i].recommendedSwapchainSampleCount;
+    }
+    bool systemMatches = m_capabilityCache.systemVendorId == m_systemProperties.vendorId &&
+                         m_capabilityCache.systemName == m_systemProperties.systemName;
+    if (viewsMatch && systemMatches)
+    {
+        return;
+    }
+
+    XR_TUT_LOG("Capability cache does not match the " << m_systemProperties.systemName << " system, enumerating the runtime.");
+    DiscardCapabilityCache();
+    m_capabilityCache.systemVendorId = m_systemProperties.vendorId;
+    m_capabilityCache.systemName = m_systemProperties.systemName;
+    GetViewConfigurationViews();
+    GetEnvironmentBlendModes();
+}
+
+void OpenxrPlugIn::SaveCapabilityCache()
+{
+    // Only a fully enumerated init has anything new to write.
+    if (m_useCachedCapabilities || m_capabilityCachePath.empty())
+    {
+        return;
+    }
+    if (!m_capabilityCache.Save(m_capabilityCachePath))
+    {
+        XR_TUT_LOG_ERROR("Failed to write the capability cache " << m_capabilityCachePath);
+    }
+}
+
+void OpenxrPlugIn::SetCapabilityCachePath(const std::string& path)
+{
+    m_capabilityCachePath = path;
+}
+
 XrPath OpenxrPlugIn::CreateXrPath(const char* path_string)    
 {
     XrPath xrPath;
@@ -334,16 +573,24 @@ void OpenxrPlugIn::GetViewConfigurationViews()
 {
     // Gets the View Configuration Types. The first call gets the count of the array that will be returned. The next call fills
     // out the array.
-    uint32_t viewConfigurationCount = 0;
-    OPENXR_CHECK(xrEnumerateViewConfigurations(m_xrInstance, m_systemID, 0, &viewConfigurationCount, nullptr),
-                 "Failed to enumerate View Configurations.");
-    m_viewConfigurations.resize(viewConfigurationCount);
-    OPENXR_CHECK(xrEnumerateViewConfigurations(m_xrInstance,
-                                               m_systemID,
-                                               viewConfigurationCount,
-                                               &viewConfigurationCount,
-                                               m_viewConfigurations.data()),
-                 "Failed to enumerate View Configurations.");
+    if (m_useCachedCapabilities)
+    {
+        m_viewConfigurations = m_capabilityCache.viewConfigurations;
+    }
+    else
+    {
+        uint32_t viewConfigurationCount = 0;
+        OPENXR_CHECK(xrEnumerateViewConfigurations(m_xrInstance, m_systemID, 0, &viewConfigurationCount, nullptr),
+                     "Failed to enumerate View Configurations.");
+        m_viewConfigurations.resize(viewConfigurationCount);
+        OPENXR_CHECK(xrEnumerateViewConfigurations(m_xrInstance,
+                                                   m_systemID,
+                                                   viewConfigurationCount,
+                                                   &viewConfigurationCount,
+                                                   m_viewConfigurations.data()),
+                     "Failed to enumerate View Configurations.");
+        m_capabilityCache.viewConfigurations = m_viewConfigurations;
+    }
 
     // Pick the first application supported View Configuration Type con supported by the hardware.
     for (const XrViewConfigurationType& viewConfiguration : m_applicationViewConfigurations)
@@ -364,6 +611,23 @@ void OpenxrPlugIn::GetViewConfigurationViews()
 
     // Gets the View Configuration Views. The first call gets the count of the array that will be returned. The next call fills
     // out the array.
+    if (m_useCachedCapabilities && m_capabilityCache.viewConfiguration == m_viewConfiguration)
+    {
+        m_viewConfigurationViews = m_capabilityCache.viewConfigurationViews;
+    }
+    else
+    {
+        EnumerateViewConfigurationViews(m_viewConfigurationViews);
+        m_capabilityCache.viewConfiguration = m_viewConfiguration;
+        m_capabilityCache.viewConfigurationViews = m_viewConfigurationViews;
+    }
+
+    // One projection cache per view, filled on the first rendered frame.
+    m_projectionCaches.resize(m_viewConfigurationViews.size());
+}
+
+void OpenxrPlugIn::EnumerateViewConfigurationViews(std::vector<XrViewConfigurationView>& views)
+{
     uint32_t viewConfigurationViewCount = 0;
     OPENXR_CHECK(xrEnumerateViewConfigurationViews(m_xrInstance,
                                                    m_systemID,
@@ -372,13 +636,13 @@ void OpenxrPlugIn::GetViewConfigurationViews()
                                                    &viewConfigurationViewCount,
                                                    nullptr),
                  "Failed to enumerate ViewConfiguration Views.");
-    m_viewConfigurationViews.resize(viewConfigurationViewCount, {XR_TYPE_VIEW_CONFIGURATION_VIEW});
+    views.resize(viewConfigurationViewCount, {XR_TYPE_VIEW_CONFIGURATION_VIEW});
     OPENXR_CHECK(xrEnumerateViewConfigurationViews(m_xrInstance,
                                                    m_systemID,
                                                    m_viewConfiguration,
                                                    viewConfigurationViewCount,
                                                    &viewConfigurationViewCount,
-                                                   m_viewConfigurationViews.data()),
+                                                   views.data()),
                  "Failed to enumerate ViewConfiguration Views.");
 }
 
@@ -386,20 +650,29 @@ void OpenxrPlugIn::GetEnvironmentBlendModes()
 {
     // Retrieves the available blend modes. The first call gets the count of the array that will be returned. The next call
     // fills out the array.
-    uint32_t environmentBlendModeCount = 0;
-    OPENXR_CHECK(
-        xrEnumerateEnvironmentBlendModes(m_xrInstance, m_systemID, m_viewConfiguration, 0, &environmentBlendModeCount, nullptr),
-        "Failed to enumerate EnvironmentBlend Modes.");
-    m_environmentBlendModes.resize(environmentBlendModeCount);
-    OPENXR_CHECK(xrEnumerateEnvironmentBlendModes(m_xrInstance,
-                                                  m_systemID,
-                                                  m_viewConfiguration,
-                                                  environmentBlendModeCount,
-                                                  &environmentBlendModeCount,
-                                                  m_environmentBlendModes.data()),
-                 "Failed to enumerate EnvironmentBlend Modes.");
+    if (m_useCachedCapabilities)
+    {
+        m_environmentBlendModes = m_capabilityCache.environmentBlendModes;
+    }
+    else
+    {
+        uint32_t environmentBlendModeCount = 0;
+        OPENXR_CHECK(
+            xrEnumerateEnvironmentBlendModes(m_xrInstance, m_systemID, m_viewConfiguration, 0, &environmentBlendModeCount, nullptr),
+            "Failed to enumerate EnvironmentBlend Modes.");
+        m_environmentBlendModes.resize(environmentBlendModeCount);
+        OPENXR_CHECK(xrEnumerateEnvironmentBlendModes(m_xrInstance,
+                                                      m_systemID,
+                                                      m_viewConfiguration,
+                                                      environmentBlendModeCount,
+                                                      &environmentBlendModeCount,
+                                                      m_environmentBlendModes.data()),
+                     "Failed to enumerate EnvironmentBlend Modes.");
+        m_capabilityCache.environmentBlendModes = m_environmentBlendModes;
+    }
 
     // Pick the first application supported blend mode supported by the hardware.
+    m_environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_MAX_ENUM;
     for (const XrEnvironmentBlendMode& environmentBlendMode : m_applicationEnvironmentBlendModes)
     {
         // AR
@@ -423,42 +696,20 @@ void OpenxrPlugIn::GetEnvironmentBlendModes()
 
 void OpenxrPlugIn::CreateSession() 
 {
-    // Query OpenGL graphics requirements
-    PFN_xrGetOpenGLGraphicsRequirementsKHR pfnGetOpenGLGraphicsRequirementsKHR = nullptr;
-    OPENXR_CHECK(xrGetInstanceProcAddr(m_xrInstance,
-                                       "xrGetOpenGLGraphicsRequirementsKHR",
-                                       (PFN_xrVoidFunction*)&pfnGetOpenGLGraphicsRequirementsKHR),
-                 "Failed to get OpenGL graphics requirements function pointer");
-
-    XrGraphicsRequirementsOpenGLKHR graphicsRequirements{XR_TYPE_GRAPHICS_REQUIREMENTS_OPENGL_KHR};
-    OPENXR_CHECK(pfnGetOpenGLGraphicsRequirementsKHR(m_xrInstance, m_systemID, &graphicsRequirements),
-                 "Failed to get OpenGL graphics requirements");
-      
-    //////////////////////////////////////////////////////////////////////////////////////////////
-    
-    GLFWwindow* window = nullptr;
-    window = bee::Engine.Device().GetWindow();   
-    HWND hwnd = glfwGetWin32Window(window);  // Get the Win32 window handle
-    HDC hdc = GetDC(hwnd);                                              // Get the window 
-    
-    HGLRC hglrc = wglGetCurrentContext();    
-
-    // Get the OpenGl context
-
-    // Fill the graphics binding structure
-    graphicsBinding.type = XR_TYPE_GRAPHICS_BINDING_OPENGL_WIN32_KHR;
-    graphicsBinding.next = nullptr;
-    graphicsBinding.hDC = hdc;      // Valid HDC handle
-    graphicsBinding.hGLRC = hglrc;  // Valid HGLRC handle
-    
-    /////////////////////////////////////////////////////////////////////////////////////////////
+    // Check the graphics requirements and fill the graphics binding structure of the backend
+    if (!m_graphicsBackend->CreateBinding(m_xrInstance, m_systemID))
+    {
+        XR_TUT_LOG_ERROR("Failed to create the " << m_graphicsBackend->GetName() << " graphics binding.");
+    }
 
     XrSessionCreateInfo sessionCI{XR_TYPE_SESSION_CREATE_INFO};
-    sessionCI.next = &graphicsBinding;                            
+    sessionCI.next = m_graphicsBackend->GetSessionBinding();
     sessionCI.createFlags = 0;
     sessionCI.systemId = m_systemID;
 
     OPENXR_CHECK(xrCreateSession(m_xrInstance, &sessionCI, &m_session), "Failed to create Session.");
+
+    ValidateCapabilityCache();
 }
 
 void OpenxrPlugIn::CreateActionPoses()
@@ -491,23 +742,51 @@ void OpenxrPlugIn::AttachActionSet()
 
 void OpenxrPlugIn::CreateReferenceSpace()
 {
-    // Fill out an XrReferenceSpaceCreateInfo structure and create a reference XrSpace, specifying a Local space with an
-    // identity pose as the origin.
-    XrReferenceSpaceCreateInfo referenceSpaceCI{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
-    //referenceSpaceCI.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
-    referenceSpaceCI.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_STAGE;
-    referenceSpaceCI.poseInReferenceSpace = {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
-    OPENXR_CHECK(xrCreateReferenceSpace(m_session, &referenceSpaceCI, &m_localSpace), "Failed to create ReferenceSpace.");
+    // The requested reference space type (STAGE by default) with an identity pose as the origin.
+    m_referenceSpace.Create(m_session, IsStringInVector(m_activeInstanceExtensions, XR_EXT_LOCAL_FLOOR_EXTENSION_NAME));
 }
 
 void OpenxrPlugIn::CreateSwapchains()
 {
+    // A re-created session gets the swapchains of the first one, without enumerating the formats again.
+    if (m_swapchainCreateInfos.size() == m_viewConfigurationViews.size() && !m_swapchainCreateInfos.empty())
+    {
+        m_colorSwapchainInfos.resize(m_swapchainCreateInfos.size());
+        m_depthSwapchainInfos.resize(m_swapchainCreateInfos.size());
+        swapchainImages.resize(m_swapchainCreateInfos.size());
+        for (size_t i = 0; i < m_swapchainCreateInfos.size(); i++)
+        {
+            SwapchainInfo& colorSwapchainInfo = m_colorSwapchainInfos[i];
+            OPENXR_CHECK(xrCreateSwapchain(m_session, &m_swapchainCreateInfos[i], &colorSwapchainInfo.swapchain),
+                         "Failed to create Color Swapchain");
+            colorSwapchainInfo.swapchainFormat = m_swapchainCreateInfos[i].format;
+            m_graphicsBackend->EnumerateSwapchainImages(colorSwapchainInfo.swapchain, swapchainImages[i]);
+        }
+        m_compositionLayers.CreateSwapchains(m_session, *m_graphicsBackend, m_swapchainCreateInfos[0].format);
+        return;
+    }
+    m_swapchainCreateInfos.clear();
+
     // Get the supported swapchain formats as an array of int64_t and ordered by runtime preference.
-    uint32_t formatCount = 0;
-    OPENXR_CHECK(xrEnumerateSwapchainFormats(m_session, 0, &formatCount, nullptr), "Failed to enumerate Swapchain Formats");
-    std::vector<int64_t> formats(formatCount);
-    OPENXR_CHECK(xrEnumerateSwapchainFormats(m_session, formatCount, &formatCount, formats.data()),
-                 "Failed to enumerate Swapchain Formats");
+    std::vector<int64_t> formats;
+    if (m_useCachedCapabilities)
+    {
+        formats = m_capabilityCache.swapchainFormats;
+    }
+    else
+    {
+        uint32_t formatCount = 0;
+        OPENXR_CHECK(xrEnumerateSwapchainFormats(m_session, 0, &formatCount, nullptr), "Failed to enumerate Swapchain Formats");
+        formats.resize(formatCount);
+        OPENXR_CHECK(xrEnumerateSwapchainFormats(m_session, formatCount, &formatCount, formats.data()),
+                     "Failed to enumerate Swapchain Formats");
+        m_capabilityCache.swapchainFormats = formats;
+    }
+    int64_t colorFormat = m_graphicsBackend->SelectColorSwapchainFormat(formats);
+    if (colorFormat == 0)
+    {
+        XR_TUT_LOG_ERROR("Failed to find a color format for Swapchain supported by the " << m_graphicsBackend->GetName() << " backend.");
+    }
     //if (m_graphicsAPI->SelectDepthSwapchainFormat(formats) == 0)
     //{
     //    std::cerr << "Failed to find depth format for Swapchain." << std::endl;
@@ -529,7 +808,7 @@ void OpenxrPlugIn::CreateSwapchains()
         XrSwapchainCreateInfo swapchainCI{XR_TYPE_SWAPCHAIN_CREATE_INFO};
         swapchainCI.createFlags = 0;
         swapchainCI.usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
-        swapchainCI.format = GL_SRGB8_ALPHA8;
+        swapchainCI.format = colorFormat;
         swapchainCI.sampleCount = m_viewConfigurationViews[i].recommendedSwapchainSampleCount;  // Use the recommended values from the XrViewConfigurationView.
         swapchainCI.width = m_viewConfigurationViews[i].recommendedImageRectWidth;
         swapchainCI.height = m_viewConfigurationViews[i].recommendedImageRectHeight;
@@ -539,28 +818,19 @@ void OpenxrPlugIn::CreateSwapchains()
         OPENXR_CHECK(xrCreateSwapchain(m_session, &swapchainCI, &colorSwapchainInfo.swapchain),
                      "Failed to create Color Swapchain");
         colorSwapchainInfo.swapchainFormat = swapchainCI.format;  // Save the swapchain format for later use.
+        m_swapchainCreateInfos.push_back(swapchainCI);
 
 
         //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-        uint32_t colorSwapchainImageCount = 0;
-        OPENXR_CHECK(xrEnumerateSwapchainImages(colorSwapchainInfo.swapchain, 0, &colorSwapchainImageCount, nullptr), "Failed to enumerate Color Swapchain Images.");  
-
-        swapchainImages[i].resize(colorSwapchainImageCount);
-        for (int a = 0; a < swapchainImages[i].size(); a++)
-        {
-            swapchainImages[i][a].type = XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_KHR;
-        }
-
-        OPENXR_CHECK(xrEnumerateSwapchainImages(colorSwapchainInfo.swapchain,
-                                               colorSwapchainImageCount,
-                                               &colorSwapchainImageCount,
-                                                reinterpret_cast<XrSwapchainImageBaseHeader*>(swapchainImages[i].data())),
-                     "Failed to enumerate Color Swapchain Images.");
+        m_graphicsBackend->EnumerateSwapchainImages(colorSwapchainInfo.swapchain, swapchainImages[i]);
 
          //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////        
 
     }
+
+    // Layer swapchains share the color format of the views.
+    m_compositionLayers.CreateSwapchains(m_session, *m_graphicsBackend, colorFormat);
 }
 
 
@@ -574,107 +844,79 @@ void OpenxrPlugIn::PollEvents()
     auto XrPollEvents = [&]() -> bool
     {
         eventData = {XR_TYPE_EVENT_DATA_BUFFER};
-        return xrPollEvent(m_xrInstance, &eventData) == XR_SUCCESS;
+        return m_xrInstance != XR_NULL_HANDLE && xrPollEvent(m_xrInstance, &eventData) == XR_SUCCESS;
     };
 
     while (XrPollEvents())
     {
-        switch (eventData.type)
+        DispatchEvent(eventData);
+    }
+
+    // Suppression summaries of the debug messages whose burst ended.
+    m_debugMessengerFilter.FlushSuppressed();
+}
+
+void OpenxrPlugIn::DispatchEvent(const XrEventDataBuffer& eventData)
+{
+    // The plug-in's own handlers were subscribed first, see SubscribeEvents().
+    m_jankCapture.RecordEvent(m_frameIndx, eventData);
+    m_eventBus.Dispatch(eventData);
+}
+
+void OpenxrPlugIn::SubscribeEvents()
+{
+    // Log the number of lost events from the runtime.
+    m_eventBus.Subscribe<XrEventDataEventsLost>(
+        [](const XrEventDataEventsLost& eventsLost) { XR_TUT_LOG("OPENXR: Events Lost: " << eventsLost.lostEventCount); });
+
+    m_eventBus.Subscribe<XrEventDataInstanceLossPending>(
+        [this](const XrEventDataInstanceLossPending& instanceLossPending)
         {
-                // Log the number of lost events from the runtime.
-            case XR_TYPE_EVENT_DATA_EVENTS_LOST:
-            {
-                XrEventDataEventsLost* eventsLost = reinterpret_cast<XrEventDataEventsLost*>(&eventData);
-                XR_TUT_LOG("OPENXR: Events Lost: " << eventsLost->lostEventCount);
-                break;
-            }
-            // Log that an instance loss is pending and shutdown the application.
-            case XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING:
-            {
-                XrEventDataInstanceLossPending* instanceLossPending =
-                    reinterpret_cast<XrEventDataInstanceLossPending*>(&eventData);
-                XR_TUT_LOG("OPENXR: Instance Loss Pending at: " << instanceLossPending->lossTime);
-                //m_sessionRunning = false;
-                //m_applicationRunning = false;
-                break;
-            }
-            // Log that the interaction profile has changed.
-            case XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED:
-            {
-                XrEventDataInteractionProfileChanged* interactionProfileChanged =
-                    reinterpret_cast<XrEventDataInteractionProfileChanged*>(&eventData);
-                XR_TUT_LOG("OPENXR: Interaction Profile changed for Session: " << interactionProfileChanged->session);
-                if (interactionProfileChanged->session != m_session)
-                {
-                    XR_TUT_LOG("XrEventDataInteractionProfileChanged for unknown Session");
-                    break;
-                }
-                RecordCurrentBindings();
-                break;
-            }
-            // Log that there's a reference space change pending.
-            case XR_TYPE_EVENT_DATA_REFERENCE_SPACE_CHANGE_PENDING:
+            XR_TUT_LOG("OPENXR: Instance Loss Pending at: " << instanceLossPending.lossTime);
+            // Everything goes, the runtime may be restarting or updating. Re-created by ServiceLifecycle().
+            DestroyInstance();
+            m_lifecycleState = XrLifecycleState::InstanceLost;
+            m_lossStart = std::chrono::steady_clock::now();
+            m_nextRecreateAttempt = m_lossStart + std::chrono::seconds(1);
+        });
+
+    // Log the new bindings when the interaction profile has changed.
+    m_eventBus.Subscribe<XrEventDataInteractionProfileChanged>(
+        [this](const XrEventDataInteractionProfileChanged& interactionProfileChanged)
+        {
+            XR_TUT_LOG("OPENXR: Interaction Profile changed for Session: " << interactionProfileChanged.session);
+            if (interactionProfileChanged.session != m_session)
             {
-                XrEventDataReferenceSpaceChangePending* referenceSpaceChangePending =
-                    reinterpret_cast<XrEventDataReferenceSpaceChangePending*>(&eventData);
-                XR_TUT_LOG("OPENXR: Reference Space Change pending for Session: " << referenceSpaceChangePending->session);
-                if (referenceSpaceChangePending->session != m_session)
-                {
-                    XR_TUT_LOG("XrEventDataReferenceSpaceChangePending for unknown Session");
-                    break;
-                }
-                break;
+                XR_TUT_LOG("XrEventDataInteractionProfileChanged for unknown Session");
+                return;
             }
-            // Session State changes:
-            case XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED:
-            {
-                XrEventDataSessionStateChanged* sessionStateChanged =
-                    reinterpret_cast<XrEventDataSessionStateChanged*>(&eventData);
-                if (sessionStateChanged->session != m_session)
-                {
-                    XR_TUT_LOG("XrEventDataSessionStateChanged for unknown Session");
-                    break;
-                }
+            RecordCurrentBindings();
+        });
 
-                if (sessionStateChanged->state == XR_SESSION_STATE_READY)
-                {
-                    // SessionState is ready. Begin the XrSession using the XrViewConfigurationType.
-                    XrSessionBeginInfo sessionBeginInfo{XR_TYPE_SESSION_BEGIN_INFO};
-                    sessionBeginInfo.primaryViewConfigurationType = m_viewConfiguration;
-                    OPENXR_CHECK(xrBeginSession(m_session, &sessionBeginInfo), "Failed to begin Session.");
-                    //m_sessionRunning = true;
-                }
-                if (sessionStateChanged->state == XR_SESSION_STATE_STOPPING)
-                {
-                    // SessionState is stopping. End the XrSession.
-                    OPENXR_CHECK(xrEndSession(m_session), "Failed to end Session.");
-                    //m_sessionRunning = false;
-                }
-                if (sessionStateChanged->state == XR_SESSION_STATE_EXITING)
-                {
-                    // SessionState is exiting. Exit the application.
-                    //m_sessionRunning = false;
-                    //m_applicationRunning = false;
-                }
-                if (sessionStateChanged->state == XR_SESSION_STATE_LOSS_PENDING)
-                {
-                    // SessionState is loss pending. Exit the application.
-                    // It's possible to try a reestablish an XrInstance and XrSession, but we will simply exit here.
-                    //m_sessionRunning = false;
-                    //m_applicationRunning = false;
-                }
-                // Store state for reference across the application.
-                m_sessionState = sessionStateChanged->state;
-                RecordCurrentBindings();
-                break;
+    // Log that there's a reference space change pending.
+    m_eventBus.Subscribe<XrEventDataReferenceSpaceChangePending>(
+        [this](const XrEventDataReferenceSpaceChangePending& referenceSpaceChangePending)
+        {
+            XR_TUT_LOG("OPENXR: Reference Space Change pending for Session: " << referenceSpaceChangePending.session);
+            if (referenceSpaceChangePending.session != m_session)
+            {
+                XR_TUT_LOG("XrEventDataReferenceSpaceChangePending for unknown Session");
+                return;
             }
+            m_referenceSpace.OnChangePending(referenceSpaceChangePending);
+        });
 
-            default:
+    // Session State changes:
+    m_eventBus.Subscribe<XrEventDataSessionStateChanged>(
+        [this](const XrEventDataSessionStateChanged& sessionStateChanged)
+        {
+            if (sessionStateChanged.session != m_session)
             {
-                break;
+                XR_TUT_LOG("XrEventDataSessionStateChanged for unknown Session");
+                return;
             }
-        }
-    }
+            HandleSessionStateChanged(sessionStateChanged);
+        });
 }
 
 void OpenxrPlugIn::RecordCurrentBindings() 
@@ -698,32 +940,84 @@ void OpenxrPlugIn::RecordCurrentBindings()
 }
 
 void OpenxrPlugIn::PollActions(XrTime predictedTime)
-
 {
-    // Update our action set with up-to-date input data.
-    // First, we specify the actionSet we are polling.
-    XrActiveActionSet activeActionSet{};
-    activeActionSet.actionSet = m_actionSet;
-    activeActionSet.subactionPath = XR_NULL_PATH;
-    // Now we sync the Actions to make sure they have current data.
-    XrActionsSyncInfo actionsSyncInfo{XR_TYPE_ACTIONS_SYNC_INFO};
-    actionsSyncInfo.countActiveActionSets = 1;
-    actionsSyncInfo.activeActionSets = &activeActionSet;
-    OPENXR_CHECK(xrSyncActions(m_session, &actionsSyncInfo), "Failed to sync Actions.");
+    XR_TRACE_SCOPE("PollActions");
 
-    XrActionStateGetInfo actionStateGetInfo{XR_TYPE_ACTION_STATE_GET_INFO};
-    // We pose a single Action, twice - once for each subAction Path.
-    actionStateGetInfo.action = m_palmPoseAction;
-    // For each hand, get the pose state if possible.
-    for (int i = 0; i < 2; i++)
+    if (m_replayFrame != nullptr)
     {
-        // Specify the subAction Path.
-        actionStateGetInfo.subactionPath = m_handPaths[i];
-        OPENXR_CHECK(xrGetActionStatePose(m_session, &actionStateGetInfo, &m_handPoseState[i]), "Failed to get Pose State.");
+        // A frame recorded without input replays as no input, the runtime's live input would break the replay.
+        if (m_replayFrame->inputValid)
+        {
+            XrRecordedFrame replayFrame = *m_replayFrame;
+            CopyRecordedInput(replayFrame, false);
+        }
+        else
+        {
+            ClearActionStates();
+        }
+    }
+    else
+    {
+        SyncActionStates(predictedTime);
+    }
+
+    if (m_recordFile.IsOpen())
+    {
+        CopyRecordedInput(m_recordFrame, true);
+        m_recordFrame.inputValid = XR_TRUE;
+    }
+
+    // Input history for the jank captures.
+    XrJankInput& jankInput = m_jankCapture.GetInput();
+    for (int i = 0; i < 2; i++)
+    {
+        jankInput.handActive[i] = m_handPoseState[i].isActive == XR_TRUE;
+        jankInput.handPose[i] = m_handPose[i];
+    }
+    jankInput.trigger[0] = leftTriggerState.currentState;
+    jankInput.trigger[1] = rightTriggerState.currentState;
+    jankInput.grip[0] = leftGripState.currentState;
+    jankInput.grip[1] = rightGripState.currentState;
+    jankInput.joystick[0][0] = leftJoystick_x_State.currentState;
+    jankInput.joystick[0][1] = leftJoystick_y_State.currentState;
+    jankInput.joystick[1][0] = rightJoystick_x_State.currentState;
+    jankInput.joystick[1][1] = rightJoystick_y_State.currentState;
+    const XrActionStateBoolean* buttons[] = {&x_buttonState, &y_buttonState, &leftThumbstick_clickState,
+                                             &a_buttonState, &b_buttonState, &rightThumbstick_clickState};
+    jankInput.buttons = 0;
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        jankInput.buttons |= buttons[i]->currentState ? (1u << i) : 0u;
+    }
+}
+
+void OpenxrPlugIn::SyncActionStates(XrTime predictedTime)
+
+{
+    // Update our action set with up-to-date input data.
+    // First, we specify the actionSet we are polling.
+    XrActiveActionSet activeActionSet{};
+    activeActionSet.actionSet = m_actionSet;
+    activeActionSet.subactionPath = XR_NULL_PATH;
+    // Now we sync the Actions to make sure they have current data.
+    XrActionsSyncInfo actionsSyncInfo{XR_TYPE_ACTIONS_SYNC_INFO};
+    actionsSyncInfo.countActiveActionSets = 1;
+    actionsSyncInfo.activeActionSets = &activeActionSet;
+    OPENXR_CHECK(xrSyncActions(m_session, &actionsSyncInfo), "Failed to sync Actions.");
+
+    XrActionStateGetInfo actionStateGetInfo{XR_TYPE_ACTION_STATE_GET_INFO};
+    // We pose a single Action, twice - once for each subAction Path.
+    actionStateGetInfo.action = m_palmPoseAction;
+    // For each hand, get the pose state if possible.
+    for (int i = 0; i < 2; i++)
+    {
+        // Specify the subAction Path.
+        actionStateGetInfo.subactionPath = m_handPaths[i];
+        OPENXR_CHECK(xrGetActionStatePose(m_session, &actionStateGetInfo, &m_handPoseState[i]), "Failed to get Pose State.");
         if (m_handPoseState[i].isActive)
         {
             XrSpaceLocation spaceLocation{XR_TYPE_SPACE_LOCATION};
-            XrResult res = xrLocateSpace(m_handPoseSpace[i], m_localSpace, predictedTime, &spaceLocation);
+            XrResult res = xrLocateSpace(m_handPoseSpace[i], m_referenceSpace.GetSpace(), predictedTime, &spaceLocation);
             if (XR_UNQUALIFIED_SUCCESS(res) && (spaceLocation.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0 &&
                 (spaceLocation.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) != 0)
             {
@@ -839,76 +1133,745 @@ void OpenxrPlugIn::PollActions(XrTime predictedTime)
     }
 }
 
+void OpenxrPlugIn::CopyRecordedInput(XrRecordedFrame& frame, bool toFrame)
+{
+    XrActionStateFloat* floatStates[XrRecordedFrame::kFloatActions] = {
+        &m_grabState[0],  &m_grabState[1],       &leftTriggerState,      &leftGripState,          &leftJoystick_x_State,
+        &leftJoystick_y_State, &rightTriggerState, &rightGripState, &rightJoystick_x_State, &rightJoystick_y_State};
+    XrActionStateBoolean* booleanStates[XrRecordedFrame::kBooleanActions] = {
+        &m_changeColorState[0], &m_changeColorState[1], &m_spawnCubeState, &x_buttonState, &y_buttonState,
+        &leftThumbstick_clickState, &a_buttonState, &b_buttonState, &rightThumbstick_clickState};
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        if (toFrame)
+        {
+            frame.handPoseState[i] = m_handPoseState[i];
+            frame.handPose[i] = m_handPose[i];
+        }
+        else
+        {
+            m_handPoseState[i] = frame.handPoseState[i];
+            m_handPose[i] = frame.handPose[i];
+        }
+    }
+    for (uint32_t i = 0; i < XrRecordedFrame::kFloatActions; i++)
+    {
+        if (toFrame)
+            frame.floatStates[i] = *floatStates[i];
+        else
+            *floatStates[i] = frame.floatStates[i];
+    }
+    for (uint32_t i = 0; i < XrRecordedFrame::kBooleanActions; i++)
+    {
+        if (toFrame)
+            frame.booleanStates[i] = *booleanStates[i];
+        else
+            *booleanStates[i] = frame.booleanStates[i];
+    }
+}
+
+void OpenxrPlugIn::ClearActionStates()
+{
+    XrRecordedFrame cleared;
+    CopyRecordedInput(cleared, true);
+    for (XrActionStatePose& state : cleared.handPoseState)
+    {
+        state.isActive = XR_FALSE;
+    }
+    for (XrActionStateFloat& state : cleared.floatStates)
+    {
+        state.currentState = 0.0f;
+        state.changedSinceLastSync = XR_FALSE;
+        state.isActive = XR_FALSE;
+    }
+    for (XrActionStateBoolean& state : cleared.booleanStates)
+    {
+        state.currentState = XR_FALSE;
+        state.changedSinceLastSync = XR_FALSE;
+        state.isActive = XR_FALSE;
+    }
+    CopyRecordedInput(cleared, false);
+}
+
 void OpenxrPlugIn::GetControllerPose(int controllerIndx, float& pos_x, float& pos_y, float& pos_z, glm::quat& rot)
 { 
+    const XrPosef handPose = m_referenceSpace.ToApplicationSpace(m_handPose[controllerIndx]);
     glm::vec3 pos;
-    XrVector3f_To_glm_vec3(pos, m_handPose[controllerIndx].position); 
+    XrVector3f_To_glm_vec3(pos, handPose.position); 
     pos_x = pos.x;
     pos_y = pos.y;
     pos_z = pos.z;
 
     glm::vec4 r;
-    XrQuaternionf_To_glm_vec4(r, m_handPose[controllerIndx].orientation);
+    XrQuaternionf_To_glm_vec4(r, handPose.orientation);
     rot = glm::quat(r.w, r.x, r.y, r.z);
 }
 
 
 
+//Lifecycle
+
+void OpenxrPlugIn::HandleSessionStateChanged(const XrEventDataSessionStateChanged& sessionStateChanged)
+{
+    // Store state for reference across the application.
+    m_sessionState = sessionStateChanged.state;
+    switch (sessionStateChanged.state)
+    {
+        case XR_SESSION_STATE_READY:
+        {
+            // Already begun when the loading thread saw the event, see RunLoadingFrames().
+            if (m_lifecycleState != XrLifecycleState::SessionRunning)
+            {
+                BeginSession();
+            }
+            break;
+        }
+        case XR_SESSION_STATE_STOPPING:
+        {
+            // SessionState is stopping. End the XrSession, it may become READY again (headset put back on).
+            OPENXR_CHECK(xrEndSession(m_session), "Failed to end Session.");
+            m_lifecycleState = XrLifecycleState::SessionIdle;
+            break;
+        }
+        case XR_SESSION_STATE_EXITING:
+        {
+            // The user or the runtime closed the application.
+            DestroySession();
+            m_lifecycleState = XrLifecycleState::Exiting;
+            break;
+        }
+        case XR_SESSION_STATE_LOSS_PENDING:
+        {
+            // Usually the headset was disconnected or went to sleep. The instance, the action set and the
+            // swapchain descriptions are kept, ServiceLifecycle() re-creates the session from them.
+            DestroySession();
+            m_lifecycleState = XrLifecycleState::SessionLost;
+            m_lossStart = std::chrono::steady_clock::now();
+            m_nextRecreateAttempt = m_lossStart;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+bool OpenxrPlugIn::BeginSession()
+{
+    // SessionState is ready. Begin the XrSession using the XrViewConfigurationType.
+    XrSessionBeginInfo sessionBeginInfo{XR_TYPE_SESSION_BEGIN_INFO};
+    sessionBeginInfo.primaryViewConfigurationType = m_viewConfiguration;
+    XrResult result = xrBeginSession(m_session, &sessionBeginInfo);
+    OPENXR_CHECK(result, "Failed to begin Session.");
+    if (XR_FAILED(result))
+    {
+        return false;
+    }
+    OnSessionBegun();
+    return true;
+}
+
+void OpenxrPlugIn::OnSessionBegun()
+{
+    m_lifecycleState = XrLifecycleState::SessionRunning;
+    // The display times of the new session do not continue the old ones.
+    m_jankCapture.ResetFrameTiming();
+    if (m_resuming)
+    {
+        std::chrono::duration<double, std::milli> resume = std::chrono::steady_clock::now() - m_lossStart;
+        XR_TUT_LOG("OpenXR session running again " << resume.count() << " ms after the loss");
+        m_resuming = false;
+    }
+}
+
+void OpenxrPlugIn::ServiceLifecycle()
+{
+    bool sessionLost = m_lifecycleState == XrLifecycleState::SessionLost;
+    bool instanceLost = m_lifecycleState == XrLifecycleState::InstanceLost;
+    auto now = std::chrono::steady_clock::now();
+    if ((!sessionLost && !instanceLost) || now < m_nextRecreateAttempt)
+    {
+        return;
+    }
+
+    bool recreated = sessionLost ? RecreateSession() : RecreateInstance();
+    if (!recreated)
+    {
+        m_nextRecreateAttempt = now + std::chrono::seconds(1);
+    }
+}
+
+bool OpenxrPlugIn::RecreateSession()
+{
+    // There is no system while the headset sleeps or is disconnected, checked quietly since it fails
+    // on every attempt until then.
+    XrSystemGetInfo systemGI{XR_TYPE_SYSTEM_GET_INFO};
+    systemGI.formFactor = m_formFactor;
+    XrSystemId systemID = XR_NULL_SYSTEM_ID;
+    if (xrGetSystem(m_xrInstance, &systemGI, &systemID) != XR_SUCCESS)
+    {
+        return false;
+    }
+    m_systemID = systemID;
+
+    // Only the session level objects, from the instance, actions and views of the init.
+    auto start = std::chrono::steady_clock::now();
+    CreateSession();
+    if (m_session == XR_NULL_HANDLE)
+    {
+        return false;
+    }
+    CreateActionPoses();
+    AttachActionSet();
+    CreateReferenceSpace();
+    CreateSwapchains();
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+    XR_TUT_LOG("OpenXR session re-created in " << duration.count() << " ms");
+
+    m_lifecycleState = XrLifecycleState::SessionIdle;
+    m_resuming = true;
+    return true;
+}
+
+bool OpenxrPlugIn::RecreateInstance()
+{
+    // Without a runtime, or without a system while the headset sleeps or is disconnected, this fails on
+    // every attempt until then. Those failures are checked quietly, only other ones are reported. The
+    // instance is kept between the attempts.
+    if (m_xrInstance == XR_NULL_HANDLE)
+    {
+        uint32_t extensionCount = 0;
+        XrResult result = xrEnumerateInstanceExtensionProperties(nullptr, 0, &extensionCount, nullptr);
+        if (XR_FAILED(result))
+        {
+            if (result != XR_ERROR_RUNTIME_UNAVAILABLE)
+            {
+                XR_TUT_LOG_ERROR("OpenXR runtime not available: " << XrResultName(result));
+            }
+            return false;
+        }
+        m_initPhases.clear();
+        RunInitPhase("LoadCapabilityCache", &OpenxrPlugIn::LoadCapabilityCache, false);
+        RunInitPhase("CreateInstance", &OpenxrPlugIn::CreateInstance, false);
+        if (m_xrInstance == XR_NULL_HANDLE)
+        {
+            m_instanceExtensions.clear();
+            return false;
+        }
+    }
+
+    XrSystemGetInfo systemGI{XR_TYPE_SYSTEM_GET_INFO};
+    systemGI.formFactor = m_formFactor;
+    XrSystemId systemID = XR_NULL_SYSTEM_ID;
+    XrResult result = xrGetSystem(m_xrInstance, &systemGI, &systemID);
+    if (result == XR_ERROR_FORM_FACTOR_UNAVAILABLE)
+    {
+        return false;
+    }
+    if (XR_FAILED(result))
+    {
+        if (result != XR_ERROR_INSTANCE_LOST)
+        {
+            XR_TUT_LOG_ERROR("Failed to get the OpenXR system: " << XrResultName(result));
+        }
+        DestroyInstance();
+        return false;
+    }
+
+    // The rest of the full init, on the render thread that owns the graphics context.
+    RunContextFreeInitPhases(false);
+    if (m_xrInstance == XR_NULL_HANDLE || m_systemID == XR_NULL_SYSTEM_ID)
+    {
+        DestroyInstance();
+        return false;
+    }
+    RunContextInitPhases();
+    if (m_session == XR_NULL_HANDLE)
+    {
+        DestroyInstance();
+        return false;
+    }
+    m_resuming = true;
+    return true;
+}
+
+void OpenxrPlugIn::DestroySwapchains()
+{
+    m_compositionLayers.DestroySwapchains();
+    for (size_t i = 0; i < m_colorSwapchainInfos.size(); i++)
+    {
+        if (i < swapchainImages.size())
+        {
+            m_graphicsBackend->ReleaseSwapchainImages(swapchainImages[i]);
+        }
+        if (m_colorSwapchainInfos[i].swapchain != XR_NULL_HANDLE)
+        {
+            OPENXR_CHECK(xrDestroySwapchain(m_colorSwapchainInfos[i].swapchain), "Failed to destroy Color Swapchain");
+        }
+    }
+    m_colorSwapchainInfos.clear();
+    m_depthSwapchainInfos.clear();
+    swapchainImages.clear();
+}
+
+void OpenxrPlugIn::DestroySession()
+{
+    if (m_session == XR_NULL_HANDLE)
+    {
+        return;
+    }
+
+    DestroySwapchains();
+    for (XrSpace& space : m_handPoseSpace)
+    {
+        if (space != XR_NULL_HANDLE)
+        {
+            OPENXR_CHECK(xrDestroySpace(space), "Failed to destroy ActionSpace.");
+            space = XR_NULL_HANDLE;
+        }
+    }
+    m_referenceSpace.Destroy();
+    OPENXR_CHECK(xrDestroySession(m_session), "Failed to destroy Session.");
+    m_session = XR_NULL_HANDLE;
+    m_sessionState = XR_SESSION_STATE_UNKNOWN;
+}
+
+void OpenxrPlugIn::DestroyInstance()
+{
+    DestroySession();
+    if (m_xrInstance == XR_NULL_HANDLE)
+    {
+        return;
+    }
+
+    if (m_debugUtilsMessenger != XR_NULL_HANDLE)
+    {
+        DestroyOpenXRDebugUtilsMessenger(m_xrInstance, m_debugUtilsMessenger);
+        m_debugUtilsMessenger = XR_NULL_HANDLE;
+        m_debugMessengerFilter.FlushSuppressed(true);
+    }
+    // Also destroys the action set and its actions.
+    OPENXR_CHECK(xrDestroyInstance(m_xrInstance), "Failed to destroy Instance.");
+    m_xrInstance = XR_NULL_HANDLE;
+    m_systemID = XR_NULL_SYSTEM_ID;
+    m_actionSet = XR_NULL_HANDLE;
+    // A new instance may come from another runtime: requested again by CreateInstance(), enumerated
+    // again by CreateSwapchains().
+    m_instanceExtensions.clear();
+    m_swapchainCreateInfos.clear();
+}
+
+void OpenxrPlugIn::UpdateThrottleSignal(bool shouldRender)
+{
+    XrThrottleSignal signal;
+    signal.sessionState = m_sessionState;
+    bool visible = m_sessionState == XR_SESSION_STATE_VISIBLE || m_sessionState == XR_SESSION_STATE_FOCUSED;
+    if (m_lifecycleState != XrLifecycleState::SessionRunning)
+    {
+        signal.level = XrThrottleLevel::Suspended;
+    }
+    else if (!visible || !shouldRender)
+    {
+        signal.level = XrThrottleLevel::Idle;
+    }
+    else
+    {
+        signal.level = m_sessionState == XR_SESSION_STATE_FOCUSED ? XrThrottleLevel::Full : XrThrottleLevel::Visible;
+    }
+    signal.render = signal.level == XrThrottleLevel::Full || signal.level == XrThrottleLevel::Visible;
+    signal.pollActions = signal.level == XrThrottleLevel::Full;
+    signal.updateInterval = signal.render ? std::chrono::milliseconds(0) : m_idleUpdateInterval;
+
+    // Buttons held when the focus went away would stay pressed.
+    if (m_throttleSignal.pollActions && !signal.pollActions)
+    {
+        ClearActionStates();
+    }
+
+    bool changed = signal.level != m_throttleSignal.level;
+    m_throttleSignal = signal;
+    if (changed)
+    {
+        static const char* levelNames[] = {"Full", "Visible", "Idle", "Suspended"};
+        XR_TUT_LOG("XR throttle level " << levelNames[static_cast<int>(signal.level)]);
+        if (m_throttleCallback)
+        {
+            m_throttleCallback(m_throttleSignal);
+        }
+    }
+}
+
+void OpenxrPlugIn::SetThrottleCallback(XrThrottleCallback callback)
+{
+    m_throttleCallback = std::move(callback);
+}
+
+void OpenxrPlugIn::Shutdown()
+{
+    if (m_initWorker.valid())
+    {
+        m_initWorker.wait();
+    }
+    EndLoading();
+    StopRecording();
+    StopReplay();
+    // A running session can be destroyed without xrEndSession, which is only valid once STOPPING.
+    DestroyInstance();
+    m_lifecycleState = XrLifecycleState::Uninitialized;
+}
+
+
+
+//Loading
+
+bool OpenxrPlugIn::BeginLoading(const std::vector<uint32_t>& layerIds, uint32_t progressLayerId)
+{
+    if (IsLoading())
+    {
+        XR_TUT_LOG_ERROR("BeginLoading() called while the loading screen is shown.");
+        return false;
+    }
+    if (m_session == XR_NULL_HANDLE)
+    {
+        XR_TUT_LOG_ERROR("BeginLoading() needs a session, call it after Init().");
+        return false;
+    }
+
+    // The loading thread has no graphics context, the layers are rendered now.
+    m_compositionLayers.RenderDirtyLayers();
+    m_loadingLayers = layerIds;
+    m_loadingProgressLayer = progressLayerId;
+    m_loadingProgress.store(0.0f, std::memory_order_relaxed);
+    m_loadingStop.store(false, std::memory_order_relaxed);
+    m_loadingThread = std::thread(&OpenxrPlugIn::RunLoadingFrames, this);
+    return true;
+}
+
+void OpenxrPlugIn::EndLoading()
+{
+    if (!IsLoading())
+    {
+        return;
+    }
+    m_loadingStop.store(true, std::memory_order_release);
+    m_loadingThread.join();
+    m_loadingLayers.clear();
+    m_loadingProgressLayer = 0;
+
+    // The session the loading thread began becomes running for the rest of the plug-in only now, the
+    // render thread reads the lifecycle state without synchronization.
+    if (m_loadingBegunSession)
+    {
+        m_loadingBegunSession = false;
+        OnSessionBegun();
+    }
+
+    // In the order they were polled: teardown after a loss and the application's handlers run here,
+    // on the thread with the graphics context.
+    std::vector<XrEventDataBuffer> events = std::move(m_loadingEvents);
+    m_loadingEvents.clear();
+    for (const XrEventDataBuffer& eventData : events)
+    {
+        DispatchEvent(eventData);
+    }
+}
+
+void OpenxrPlugIn::RunLoadingFrames()
+{
+    XR_TUT_LOG("Loading screen shown.");
+    auto start = std::chrono::steady_clock::now();
+    uint64_t frameCount = 0;
+    std::vector<XrCompositionLayerBaseHeader*> layers;
+    // Only this thread's view of the session, EndLoading() updates the shared state.
+    bool running = m_lifecycleState == XrLifecycleState::SessionRunning;
+    // Set once the session leaves the running states: ending it, or destroying it after a loss, needs
+    // the render thread, so no more frames until EndLoading().
+    bool stopped = false;
+    while (!m_loadingStop.load(std::memory_order_acquire))
+    {
+        XrEventDataBuffer eventData{XR_TYPE_EVENT_DATA_BUFFER};
+        while (xrPollEvent(m_xrInstance, &eventData) == XR_SUCCESS)
+        {
+            m_loadingEvents.push_back(eventData);
+            if (eventData.type == XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING)
+            {
+                stopped = true;
+            }
+            else if (eventData.type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED)
+            {
+                XrSessionState state = reinterpret_cast<const XrEventDataSessionStateChanged*>(&eventData)->state;
+                // Beginning needs no graphics context, so loading can start right after Init().
+                if (state == XR_SESSION_STATE_READY && !stopped && !running &&
+                    m_lifecycleState == XrLifecycleState::SessionIdle)
+                {
+                    XrSessionBeginInfo sessionBeginInfo{XR_TYPE_SESSION_BEGIN_INFO};
+                    sessionBeginInfo.primaryViewConfigurationType = m_viewConfiguration;
+                    XrResult result = xrBeginSession(m_session, &sessionBeginInfo);
+                    OPENXR_CHECK(result, "Failed to begin Session.");
+                    running = XR_SUCCEEDED(result);
+                    m_loadingBegunSession = running;
+                }
+                else if (state == XR_SESSION_STATE_STOPPING || state == XR_SESSION_STATE_LOSS_PENDING ||
+                         state == XR_SESSION_STATE_EXITING)
+                {
+                    stopped = true;
+                }
+            }
+            eventData = {XR_TYPE_EVENT_DATA_BUFFER};
+        }
+        if (stopped || !running)
+        {
+            std::this_thread::sleep_for(m_idlePollInterval);
+            continue;
+        }
+
+        XR_TRACE_SCOPE("LoadingFrame");
+        XrFrameState frameState{XR_TYPE_FRAME_STATE};
+        XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
+        OPENXR_CHECK(xrWaitFrame(m_session, &frameWaitInfo, &frameState), "Failed to wait for XR Frame.");
+        XrFrameBeginInfo frameBeginInfo{XR_TYPE_FRAME_BEGIN_INFO};
+        OPENXR_CHECK(xrBeginFrame(m_session, &frameBeginInfo), "Failed to begin the XR Frame.");
+        // The reference space is only read here, recentering and space changes wait for the render thread.
+
+        layers.clear();
+        if (frameState.shouldRender == XR_TRUE)
+        {
+            if (m_loadingProgressLayer != 0)
+            {
+                m_compositionLayers.SetFill(m_loadingProgressLayer, m_loadingProgress.load(std::memory_order_relaxed));
+            }
+            m_compositionLayers.AppendLayers(layers, m_loadingLayers, m_referenceSpace);
+        }
+
+        XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
+        frameEndInfo.displayTime = frameState.predictedDisplayTime;
+        frameEndInfo.environmentBlendMode = m_environmentBlendMode;
+        frameEndInfo.layerCount = static_cast<uint32_t>(layers.size());
+        frameEndInfo.layers = layers.data();
+        OPENXR_CHECK(xrEndFrame(m_session, &frameEndInfo), "Failed to end the XR Frame.");
+        frameCount++;
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    XR_TUT_LOG("Loading screen hidden after " << seconds << " s, " << frameCount << " frames.");
+}
+
+
+
 //Render
 
 void OpenxrPlugIn::RenderXRBeguin() 
 {
-    PollEvents();
+    // The loading thread owns the frame loop until EndLoading().
+    if (IsLoading())
+    {
+        return;
+    }
+
+    XR_TRACE_SCOPE("Frame");
+    m_jankCapture.BeginFrame(m_frameIndx, m_sessionState);
+
+    // xrWaitFrame is only valid on a running session. Until the runtime says READY (again), events are
+    // polled at a low rate. This never blocks: the engine paces itself from the Idle throttle signal.
+    auto now = std::chrono::steady_clock::now();
+    if (m_lifecycleState == XrLifecycleState::SessionRunning || now >= m_nextIdlePoll)
+    {
+        XR_TRACE_SCOPE("PollEvents");
+        XrJankCapture::PhaseTimer timer(m_jankCapture, XrFramePhase::PollEvents);
+        PollEvents();
+        m_nextIdlePoll = now + m_idlePollInterval;
+    }
+
+    if (m_lifecycleState != XrLifecycleState::SessionRunning)
+    {
+        UpdateThrottleSignal(false);
+        ServiceLifecycle();
+        return;
+    }
 
     // Get the XrFrameState for timing and rendering info.
     XrFrameState frameState{XR_TYPE_FRAME_STATE};
-    XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
-    OPENXR_CHECK(xrWaitFrame(m_session, &frameWaitInfo, &frameState), "Failed to wait for XR Frame.");
+    {
+        XR_TRACE_SCOPE("xrWaitFrame");
+        XrJankCapture::PhaseTimer timer(m_jankCapture, XrFramePhase::WaitFrame);
+        XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
+        OPENXR_CHECK(xrWaitFrame(m_session, &frameWaitInfo, &frameState), "Failed to wait for XR Frame.");
+    }
+    // A replayed frame drives the application, the runtime's own display time still goes to xrEndFrame.
+    const XrTime runtimeDisplayTime = frameState.predictedDisplayTime;
+    m_replayFrame = NextReplayFrame();
+    if (m_replayFrame != nullptr)
+    {
+        frameState.predictedDisplayTime = m_replayFrame->predictedDisplayTime;
+        frameState.predictedDisplayPeriod = m_replayFrame->predictedDisplayPeriod;
+        frameState.shouldRender = m_replayFrame->shouldRender;
+    }
+    if (m_recordFile.IsOpen())
+    {
+        m_recordFrame = XrRecordedFrame();
+        m_recordFrame.frameIndx = m_frameIndx;
+        m_recordFrame.predictedDisplayTime = frameState.predictedDisplayTime;
+        m_recordFrame.predictedDisplayPeriod = frameState.predictedDisplayPeriod;
+        m_recordFrame.shouldRender = frameState.shouldRender;
+        m_recordFrame.sessionState = m_sessionState;
+    }
+    XrFrameTrace::Get().SetFrame(m_frameIndx, frameState.predictedDisplayTime);
+    m_referenceSpace.Update(runtimeDisplayTime);
+    if (m_jankCapture.SetFrameState(frameState))
+    {
+        XR_TRACE_INSTANT("MissedFrame");
+        XrFrameTrace::Get().OnMissedFrame(m_frameIndx);
+    }
 
     // Tell the OpenXR compositor that the application is beginning the frame.
-    XrFrameBeginInfo frameBeginInfo{XR_TYPE_FRAME_BEGIN_INFO};
-    OPENXR_CHECK(xrBeginFrame(m_session, &frameBeginInfo), "Failed to begin the XR Frame.");
+    {
+        XR_TRACE_SCOPE("xrBeginFrame");
+        XrJankCapture::PhaseTimer timer(m_jankCapture, XrFramePhase::BeginFrame);
+        XrFrameBeginInfo frameBeginInfo{XR_TYPE_FRAME_BEGIN_INFO};
+        OPENXR_CHECK(xrBeginFrame(m_session, &frameBeginInfo), "Failed to begin the XR Frame.");
+    }
 
     // Variables for rendering and layer composition.
     bool rendered = false;
     RenderLayerInfo renderLayerInfo;
     renderLayerInfo.predictedDisplayTime = frameState.predictedDisplayTime;
+    renderLayerInfo.runtimeDisplayTime = runtimeDisplayTime;
 
-    // Check that the session is active and that we should render.
-    bool sessionActive = (m_sessionState == XR_SESSION_STATE_SYNCHRONIZED || m_sessionState == XR_SESSION_STATE_VISIBLE ||
-                          m_sessionState == XR_SESSION_STATE_FOCUSED);
-    if (sessionActive && frameState.shouldRender)
+    // Check that the session is displayed and that we should render, input only while focused.
+    UpdateThrottleSignal(frameState.shouldRender == XR_TRUE);
+    if (m_throttleSignal.render)
     {
         // poll actions here because they require a predicted display time, which we've only just obtained.
-        PollActions(frameState.predictedDisplayTime);
+        if (m_throttleSignal.pollActions)
+        {
+            XrJankCapture::PhaseTimer timer(m_jankCapture, XrFramePhase::PollActions);
+            PollActions(runtimeDisplayTime);
+        }
 
         // APP things   -    Handle the interaction between the user and the 3D blocks.
 
 
 
         // Render the stereo image and associate one of swapchain images with the XrCompositionLayerProjection structure.
-        rendered = RenderLayer(renderLayerInfo);
+        {
+            XrJankCapture::PhaseTimer timer(m_jankCapture, XrFramePhase::RenderLayer);
+            rendered = RenderLayer(renderLayerInfo);
+            m_compositionLayers.RenderDirtyLayers();
+        }
+        // Layers below the projection layer, the projection layer, then the layers above it.
+        m_compositionLayers.AppendLayers(renderLayerInfo.layers, true, m_referenceSpace);
         if (rendered)
         {
             renderLayerInfo.layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&renderLayerInfo.layerProjection));
         }
+        m_compositionLayers.AppendLayers(renderLayerInfo.layers, false, m_referenceSpace);
     }
 
     // Tell OpenXR that we are finished with this frame; specifying its display time, environment blending and layers.
     XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
-    frameEndInfo.displayTime = frameState.predictedDisplayTime;
+    frameEndInfo.displayTime = runtimeDisplayTime;
     frameEndInfo.environmentBlendMode = m_environmentBlendMode;
     frameEndInfo.layerCount = static_cast<uint32_t>(renderLayerInfo.layers.size());
     frameEndInfo.layers = renderLayerInfo.layers.data();
-    OPENXR_CHECK(xrEndFrame(m_session, &frameEndInfo), "Failed to end the XR Frame.");
+    {
+        XR_TRACE_SCOPE("xrEndFrame");
+        XrJankCapture::PhaseTimer timer(m_jankCapture, XrFramePhase::EndFrame);
+        OPENXR_CHECK(xrEndFrame(m_session, &frameEndInfo), "Failed to end the XR Frame.");
+    }
+    m_jankCapture.EndFrame();
+
+    if (m_recordFile.IsOpen() && !m_recordFile.Append(m_recordFrame))
+    {
+        XR_TUT_LOG_ERROR("Session recording stopped, the file could not grow");
+        StopRecording();
+    }
+    m_replayFrame = nullptr;
+
+    m_frameIndx++;
+}
+
+bool OpenxrPlugIn::StartRecording(const std::string& path)
+{
+    if (!m_recordFile.Create(path))
+    {
+        return false;
+    }
+    XR_TUT_LOG("Recording the session to " << path);
+    return true;
+}
+
+void OpenxrPlugIn::StopRecording()
+{
+    if (m_recordFile.IsOpen())
+    {
+        XR_TUT_LOG("Session recording stopped after " << m_recordFile.GetFrameCount() << " frames");
+    }
+    m_recordFile.Close();
+}
+
+bool OpenxrPlugIn::StartReplay(const std::string& path, bool loop)
+{
+    if (!m_replayFile.Open(path))
+    {
+        return false;
+    }
+    m_replayFrameIndx = 0;
+    m_replayLoop = loop;
+    XR_TUT_LOG("Replaying " << m_replayFile.GetFrameCount() << " frames from " << path);
+    return true;
 }
 
-glm::vec3 recordedCameraPos;
-glm::quat recordedCameraRot;
+void OpenxrPlugIn::StopReplay()
+{
+    m_replayFile.Close();
+    m_replayFrame = nullptr;
+}
 
+const XrRecordedFrame* OpenxrPlugIn::NextReplayFrame()
+{
+    if (!m_replayFile.IsOpen())
+    {
+        return nullptr;
+    }
+    if (m_replayFrameIndx >= m_replayFile.GetFrameCount())
+    {
+        if (!m_replayLoop || m_replayFile.GetFrameCount() == 0)
+        {
+            XR_TUT_LOG("Replay finished after " << m_replayFrameIndx << " frames");
+            StopReplay();
+            return nullptr;
+        }
+        m_replayFrameIndx = 0;
+    }
+    return &m_replayFile.GetFrame(m_replayFrameIndx++);
+}
+
+void OpenxrPlugIn::SetJankCaptureSettings(const XrJankCaptureSettings& settings)
+{
+    m_jankCapture.SetSettings(settings);
+}
+
+void OpenxrPlugIn::StartFrameTrace(uint32_t capacity, const std::string& missedFrameDumpPrefix)
+{
+    XrFrameTrace::Get().SetMissedFrameDump(missedFrameDumpPrefix);
+    XrFrameTrace::Get().Start(capacity);
+}
+
+void OpenxrPlugIn::StopFrameTrace()
+{
+    XrFrameTrace::Get().Stop();
+}
+
+bool OpenxrPlugIn::WriteFrameTrace(const std::string& path)
+{
+    return XrFrameTrace::Get().WriteChromeTrace(path);
+}
 
 bool OpenxrPlugIn::RenderLayer(RenderLayerInfo& renderLayerInfo) 
 {
+    XR_TRACE_SCOPE("RenderLayer");
+
     // Locate the views from the view configuration within the (reference) space at the display time.
     std::vector<XrView> views(m_viewConfigurationViews.size(), {XR_TYPE_VIEW});
 
@@ -916,10 +1879,26 @@ bool OpenxrPlugIn::RenderLayer(RenderLayerInfo& renderLayerInfo)
         XR_TYPE_VIEW_STATE};  // Will contain information on whether the position and/or orientation is valid and/or tracked.
     XrViewLocateInfo viewLocateInfo{XR_TYPE_VIEW_LOCATE_INFO};
     viewLocateInfo.viewConfigurationType = m_viewConfiguration;
-    viewLocateInfo.displayTime = renderLayerInfo.predictedDisplayTime;
-    viewLocateInfo.space = m_localSpace;
+    viewLocateInfo.displayTime = renderLayerInfo.runtimeDisplayTime;
+    viewLocateInfo.space = m_referenceSpace.GetSpace();
     uint32_t viewCount = 0;
-    xrLocateViews(m_session, &viewLocateInfo, &viewState, static_cast<uint32_t>(views.size()), &viewCount, views.data());
+    if (m_replayFrame != nullptr && m_replayFrame->viewCount > 0 && m_replayFrame->viewCount <= views.size())
+    {
+        viewCount = m_replayFrame->viewCount;
+        viewState.viewStateFlags = m_replayFrame->viewStateFlags;
+        std::copy(m_replayFrame->views, m_replayFrame->views + viewCount, views.begin());
+    }
+    else
+    {
+        XR_TRACE_SCOPE("xrLocateViews");
+        xrLocateViews(m_session, &viewLocateInfo, &viewState, static_cast<uint32_t>(views.size()), &viewCount, views.data());
+    }
+    if (m_recordFile.IsOpen())
+    {
+        m_recordFrame.viewStateFlags = viewState.viewStateFlags;
+        m_recordFrame.viewCount = std::min(viewCount, XrRecordedFrame::kMaxViews);
+        std::copy(views.begin(), views.begin() + m_recordFrame.viewCount, m_recordFrame.views);
+    }
 
     // Resize the layer projection views to match the view count. The layer projection views are used in the layer projection.
     renderLayerInfo.layerProjectionViews.resize(viewCount, {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW});
@@ -927,34 +1906,54 @@ bool OpenxrPlugIn::RenderLayer(RenderLayerInfo& renderLayerInfo)
     // AR
     renderLayerInfo.layerDepthInfos.resize(viewCount, {XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR});
 
-    // Per view in the view configuration:
+    // Camera parameters of every view, computed once for both eyes before rendering any of them.
+    UpdateViewCameras(views.data(), viewCount);
 
-    ////Record camera pos and rot to apply correctly the local tracking offset and turn it back to the origin transform.
-    //for (const auto& [e, camera, cameraTransform] : bee::Engine.ECS().Registry.view<bee::Camera, bee::Transform>().each())
-    //{
-    //    recordedCameraPos = cameraTransform.GetTranslation();
-    //    recordedCameraRot = cameraTransform.GetRotation();
-    //}
+    m_renderViews.resize(viewCount);
+    for (uint32_t i = 0; i < viewCount; i++)
+    {
+        m_renderViews[i].viewIndx = i;
+        m_renderViews[i].view = views[i];
+        m_renderViews[i].camera = m_viewCameras[i];
+    }
+
+    XrRenderFrame renderFrame;
+    renderFrame.frameIndx = m_frameIndx;
+    renderFrame.predictedDisplayTime = renderLayerInfo.predictedDisplayTime;
+    renderFrame.views = m_renderViews.data();
+    renderFrame.viewCount = viewCount;
 
+    // View independent work runs once for both eyes, before waiting on any swapchain image.
+    {
+        XR_TRACE_SCOPE("PerFramePasses");
+        ExecuteRenderPasses(XrRenderStage::PerFrame, renderFrame, nullptr);
+    }
+
+    // Per view in the view configuration:
     for (uint32_t i = 0; i < viewCount; i++)
     {
-        eyeIndx = i;
-        
         SwapchainInfo& colorSwapchainInfo = m_colorSwapchainInfos[i];
+        uint32_t swapchainImageIndx = 0;
 
         // Acquire and wait for an image from the swapchains.
         // Get the image index of an image in the swapchains.
         // The timeout is infinite.
-        XrSwapchainImageAcquireInfo acquireInfo{XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
-        OPENXR_CHECK(xrAcquireSwapchainImage(colorSwapchainInfo.swapchain, &acquireInfo, &swapchainImageIndx),
-                     "Failed to acquire Image from the Color Swapchian");
-        //OPENXR_CHECK(xrAcquireSwapchainImage(depthSwapchainInfo.swapchain, &acquireInfo, &depthImageIndex),
-        //             "Failed to acquire Image from the Depth Swapchian");
-
-        XrSwapchainImageWaitInfo waitInfo = {XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
-        waitInfo.timeout = XR_INFINITE_DURATION;
-        OPENXR_CHECK(xrWaitSwapchainImage(colorSwapchainInfo.swapchain, &waitInfo),
-                     "Failed to wait for Image from the Color Swapchain");
+        {
+            XR_TRACE_SCOPE("xrAcquireSwapchainImage");
+            XrSwapchainImageAcquireInfo acquireInfo{XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+            OPENXR_CHECK(xrAcquireSwapchainImage(colorSwapchainInfo.swapchain, &acquireInfo, &swapchainImageIndx),
+                         "Failed to acquire Image from the Color Swapchian");
+            //OPENXR_CHECK(xrAcquireSwapchainImage(depthSwapchainInfo.swapchain, &acquireInfo, &depthImageIndex),
+            //             "Failed to acquire Image from the Depth Swapchian");
+        }
+
+        {
+            XR_TRACE_SCOPE("xrWaitSwapchainImage");
+            XrSwapchainImageWaitInfo waitInfo = {XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+            waitInfo.timeout = XR_INFINITE_DURATION;
+            OPENXR_CHECK(xrWaitSwapchainImage(colorSwapchainInfo.swapchain, &waitInfo),
+                         "Failed to wait for Image from the Color Swapchain");
+        }
         //OPENXR_CHECK(xrWaitSwapchainImage(depthSwapchainInfo.swapchain, &waitInfo),
         //             "Failed to wait for Image from the Depth Swapchain");
 
@@ -963,8 +1962,6 @@ bool OpenxrPlugIn::RenderLayer(RenderLayerInfo& renderLayerInfo)
         const uint32_t& height = m_viewConfigurationViews[i].recommendedImageRectHeight;
         //GraphicsAPI::Viewport viewport = {0.0f, 0.0f, (float)width, (float)height, 0.0f, 1.0f};
         //GraphicsAPI::Rect2D scissor = {{(int32_t)0, (int32_t)0}, {width, height}};
-        float nearZ = 0.05f;
-        float farZ = 100.0f;
 
         // Fill out the XrCompositionLayerProjectionView structure specifying the pose and fov from the view. This also
         // associates the swapchain image with this layer projection view.
@@ -989,52 +1986,37 @@ bool OpenxrPlugIn::RenderLayer(RenderLayerInfo& renderLayerInfo)
         //renderLayerInfo.layerDepthInfos[i].subImage.imageRect.extent.height = static_cast<int32_t>(height);
         //renderLayerInfo.layerDepthInfos[i].minDepth = 0;
         //renderLayerInfo.layerDepthInfos[i].maxDepth = 1;
-        //renderLayerInfo.layerDepthInfos[i].nearZ = nearZ;
-        //renderLayerInfo.layerDepthInfos[i].farZ = farZ;
-
-
-
-        /////////////////////////////////////////////////////   RENDERING   //////////////////////////////////////////////////////////////////////////////////////////////
-
-        //Camera xr actions                 
-
-        glm::vec3 eyeLocalPos;
-        glm::vec4 eyeLocalRot;
-        XrVector3f_To_glm_vec3(eyeLocalPos, views[i].pose.position);
-        XrQuaternionf_To_glm_vec4(eyeLocalRot, views[i].pose.orientation);
-
-        glm::vec3 eyeWorldPos;
-        glm::quat eyeWorldRot;
-
-        for (const auto& [e, camera, cameraTransform] : bee::Engine.ECS().Registry.view<bee::Camera, bee::Transform>().each())
-        {
-            //Rot and pos
-
-            eyeWorldPos = eyeLocalPos;
-            eyeWorldRot = glm::quat(eyeLocalRot.w, eyeLocalRot.x, eyeLocalRot.y, eyeLocalRot.z);
-
-            cameraTransform.SetRotation(eyeWorldRot);
-            cameraTransform.SetTranslation(eyeWorldPos);
-
-            //Projection
-            XrMatrix4x4f xrProj; 
-            XrMatrix4x4f_CreateProjectionFov(&xrProj, views[i].fov, nearZ, farZ);
-            XrMatrix4x4f_To_glm_mat4x4(camera.Projection, xrProj);               
-        }
+        //renderLayerInfo.layerDepthInfos[i].nearZ = m_nearZ;
+        //renderLayerInfo.layerDepthInfos[i].farZ = m_farZ;
+
+        // Associate the acquired image with the view for the renderer.
+        XrRenderView& renderView = m_renderViews[i];
+        renderView.target.viewIndx = i;
+        renderView.target.swapchainImageIndx = swapchainImageIndx;
+        renderView.target.image = swapchainImages[i][swapchainImageIndx];
+        renderView.target.format = colorSwapchainInfo.swapchainFormat;
+        renderView.target.width = static_cast<int32_t>(width);
+        renderView.target.height = static_cast<int32_t>(height);
+    }
 
-        //Rendering call
 
-        bee::RendererXR& rendererxr = bee::Engine.ECS().GetSystem<bee::RendererXR>();
+    /////////////////////////////////////////////////////   RENDERING   //////////////////////////////////////////////////////////////////////////////////////////////
 
-        rendererxr.RenderFlat(); 
+    // All the views go to the renderer in a single call.
+    {
+        XR_TRACE_SCOPE("RenderFrame");
+        m_graphicsBackend->BeginFrame(renderFrame);
+        GetRenderer().RenderFrame(renderFrame);
+        m_graphicsBackend->EndFrame(renderFrame);
+    }
 
-        GLuint finalBufferIndx = rendererxr.m_finalFramebuffer;
-        GLuint finalTextureWidth = rendererxr.m_width;
-        GLuint finalTextureHeight = rendererxr.m_height;
-        BlitToSwapchain(i, finalBufferIndx, finalTextureWidth, finalTextureHeight);
+    XR_TRACE_SCOPE("xrReleaseSwapchainImage");
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-        ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    for (uint32_t i = 0; i < viewCount; i++)
+    {
+        SwapchainInfo& colorSwapchainInfo = m_colorSwapchainInfos[i];
 
         // Give the swapchain image back to OpenXR, allowing the compositor to use the image.
         XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
@@ -1047,94 +2029,187 @@ bool OpenxrPlugIn::RenderLayer(RenderLayerInfo& renderLayerInfo)
     // Fill out the XrCompositionLayerProjection structure for usage with xrEndFrame().
     renderLayerInfo.layerProjection.layerFlags =
         XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT | XR_COMPOSITION_LAYER_CORRECT_CHROMATIC_ABERRATION_BIT;
-    renderLayerInfo.layerProjection.space = m_localSpace;
+    renderLayerInfo.layerProjection.space = m_referenceSpace.GetSpace();
     renderLayerInfo.layerProjection.viewCount = static_cast<uint32_t>(renderLayerInfo.layerProjectionViews.size());
     renderLayerInfo.layerProjection.views = renderLayerInfo.layerProjectionViews.data();
 
-    ////Give back recorded pos and rot to the camera transform and let the game logic clean:
-    //for (const auto& [e, camera, cameraTransform] : bee::Engine.ECS().Registry.view<bee::Camera, bee::Transform>().each())
-    //{
-    //    cameraTransform.SetTranslation(recordedCameraPos);
-    //    cameraTransform.SetRotation(recordedCameraRot);
-    //} 
-
     return true;
 }
 
-void OpenxrPlugIn::BlitToSwapchain(int eyeIndex, int finalBufferIndx, int finalBufferTextureWidth, int finalBufferTextureHeight)
+void OpenxrPlugIn::BlitToSwapchain(const XrRenderTarget& target, GLuint finalBufferIndx, int finalBufferTextureWidth, int finalBufferTextureHeight)
 {
+    XR_TRACE_SCOPE("BlitToSwapchain");
+
     // XR SWAPCHAINS FROM M_finalFramebuffer!!!!
-    (void)eyeIndex;
+    XrGraphicsImage source;
+    source.handle = finalBufferIndx;
+    source.width = finalBufferTextureWidth;
+    source.height = finalBufferTextureHeight;
+    m_graphicsBackend->CopyToRenderTarget(target, source);
+}
 
-    GLuint swchindx = swapchainImageIndx;                                  // INTRUSION
-    GLuint indx = swapchainImages[eyeIndx][swchindx].image;  // INTRUSION
-                                                                                                    //   |
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, finalBufferIndx);  //  V
+void OpenxrPlugIn::RenderXREnd()
+{
 
-    // Create and bind a new framebuffer for the swapchain texture
-    GLuint swapchainFramebuffer;
-    glGenFramebuffers(1, &swapchainFramebuffer);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, swapchainFramebuffer);
+}
+
+void OpenxrPlugIn::SetRenderer(XrRenderer* renderer)
+{
+    m_renderer = renderer;
+}
 
-    // Attach the swapchain image to the new framebuffer
-    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, indx, 0);
+void OpenxrPlugIn::SetGraphicsBackend(std::unique_ptr<XrGraphicsBackend> backend)
+{
+    m_graphicsBackend = std::move(backend);
+}
 
-    // Check if the framebuffer is complete
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+XrGraphicsBackend& OpenxrPlugIn::GetGraphicsBackend()
+{
+    if (!m_graphicsBackend)
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDeleteFramebuffers(1, &swapchainFramebuffer);
-        return;  // Abort blit operation if framebuffer is not complete
+        m_graphicsBackend = CreateDefaultGraphicsBackend();
     }
+    return *m_graphicsBackend;
+}
 
-    /////////////////////////////////////////// VR BLITTING
-    ////////////////////////////////////////////////////////////////////////
+XrRenderer& OpenxrPlugIn::GetRenderer()
+{
+    if (m_renderer == nullptr)
+    {
+        // RendererXR is created after Init(), so the default renderer is only made on the first frame.
+        if (!m_defaultRenderer)
+        {
+            if (GetGraphicsBackend().GetApi() == XrGraphicsApi::OpenGL)
+            {
+                m_defaultRenderer = std::make_unique<BeeXrRenderer>(*this);
+            }
+            else
+            {
+                // The Bee renderer is OpenGL only.
+                XR_TUT_LOG_ERROR("No XrRenderer set for the " << GetGraphicsBackend().GetName() << " backend, use SetRenderer().");
+                m_defaultRenderer = std::make_unique<NullXrRenderer>();
+            }
+        }
+        return *m_defaultRenderer;
+    }
+    return *m_renderer;
+}
 
-    // int sourceWidth = m_width;
-    // int sourceHeight = m_height;
 
-    //// Destination region (centered adjustment)
-    // int destWidth = Engine.ECS().GetSystem<OpenxrPlugIn>().m_viewConfigurationViews[eyeIndx].recommendedImageRectWidth;
-    // int destHeight = Engine.ECS().GetSystem<OpenxrPlugIn>().m_viewConfigurationViews[eyeIndx].recommendedImageRectHeight;
 
-    //// Retrieve FOV angles (from OpenXR views[i].fov for each eye)
-    // float tanLeft = tanf(fov.angleLeft);
-    // float tanRight = tanf(fov.angleRight);
-    // float tanUp = tanf(fov.angleUp);
-    // float tanDown = tanf(fov.angleDown);
+//Projection
 
-    //// Compute the normalized offsets for the visual center in NDC
-    // float centerX_NDC = (tanRight + tanLeft) / (2.0f * (tanRight - tanLeft));
-    // float centerY_NDC = (tanUp + tanDown) / (2.0f * (tanUp - tanDown));
+void OpenxrPlugIn::SetClipPlanes(float nearZ, float farZ, bool reversedZInfiniteFar)
+{
+    if (nearZ == m_nearZ && farZ == m_farZ && reversedZInfiniteFar == m_reversedZInfiniteFar)
+    {
+        return;
+    }
 
-    //// Convert NDC center offsets to pixel coordinates
-    // int blitXOffset = (int)((centerX_NDC + 0.5f) * destWidth - sourceWidth / 2.0f);
-    // int blitYOffset = (int)((centerY_NDC + 0.5f) * destHeight - sourceHeight / 2.0f);
+    m_nearZ = nearZ;
+    m_farZ = farZ;
+    m_reversedZInfiniteFar = reversedZInfiniteFar;
+    m_clipPlanesVersion++;
+}
 
-    // Perform the adjusted blit
-    glBlitFramebuffer(0,
-                      0,
-        finalBufferTextureWidth,
-        finalBufferTextureHeight,  // Source rectangle
-                      0,
-                      0,                    // Adjusted destination rectangle (bottom-left corner)
-                      m_viewConfigurationViews[eyeIndx].recommendedImageRectWidth,  // Width aligned with the projection center
-                      m_viewConfigurationViews[eyeIndx].recommendedImageRectHeight,  // Height aligned with the projection center
-                      GL_COLOR_BUFFER_BIT,  // Buffer to copy
-                      GL_NEAREST            // Sampling filter
-    );
-    // Perform the blit
-    // glBlitFramebuffer(0, 0, sourceWidth, sourceHeight, xOffset, yOffset, destWidth - xOffset, destHeight - yOffset,
-    // GL_COLOR_BUFFER_BIT, GL_NEAREST);
+void OpenxrPlugIn::SetTrackingOrigin(const glm::mat4& worldFromTrackingSpace)
+{
+    m_worldFromTrackingSpace = worldFromTrackingSpace;
+}
+
+void OpenxrPlugIn::UpdateViewCameras(const XrView* views, uint32_t viewCount)
+{
+    m_viewCameras.resize(viewCount);
 
-    // Clean up
-    glBindFramebuffer(GL_FRAMEBUFFER, finalBufferIndx);            // Unbind both framebuffers
-    glDeleteFramebuffers(1, &swapchainFramebuffer);  // Delete the temporary framebuffer
+    for (uint32_t i = 0; i < viewCount; i++)
+    {
+        XrViewCamera& viewCamera = m_viewCameras[i];
+
+        // Eye pose in the recentered reference space, moved into the world by the tracking origin.
+        const XrPosef eyePose = m_referenceSpace.ToApplicationSpace(views[i].pose);
+        XrMatrix4x4f xrTrackingFromEye;
+        XrVector3f unitScale = {1.0f, 1.0f, 1.0f};
+        XrMatrix4x4f_CreateTranslationRotationScale(&xrTrackingFromEye,
+                                                    &eyePose.position,
+                                                    &eyePose.orientation,
+                                                    &unitScale);
+        glm::mat4 trackingFromEye;
+        XrMatrix4x4f_To_glm_mat4x4(trackingFromEye, xrTrackingFromEye);
+        glm::mat4 worldFromEye = m_worldFromTrackingSpace * trackingFromEye;
+
+        viewCamera.view = glm::inverse(worldFromEye);
+        viewCamera.projection = GetViewProjection(i, views[i].fov);
+        viewCamera.position = glm::vec3(worldFromEye[3].x, worldFromEye[3].y, worldFromEye[3].z);
+    }
 }
 
-void OpenxrPlugIn::RenderXREnd() 
+uint32_t OpenxrPlugIn::AddRenderPass(XrRenderStage stage, const char* name, XrRenderPassFunction execute)
 {
-    
+    XrRenderPass renderPass;
+    renderPass.id = m_nextRenderPassId++;
+    renderPass.name = name;
+    renderPass.execute = std::move(execute);
+    m_renderPasses[static_cast<size_t>(stage)].push_back(std::move(renderPass));
+    return m_renderPasses[static_cast<size_t>(stage)].back().id;
+}
+
+void OpenxrPlugIn::RemoveRenderPass(uint32_t passId)
+{
+    for (std::vector<XrRenderPass>& renderPasses : m_renderPasses)
+    {
+        renderPasses.erase(std::remove_if(renderPasses.begin(),
+                                          renderPasses.end(),
+                                          [passId](const XrRenderPass& renderPass) { return renderPass.id == passId; }),
+                           renderPasses.end());
+    }
+}
+
+void OpenxrPlugIn::ExecuteRenderPasses(XrRenderStage stage, const XrRenderFrame& frame, const XrRenderView* view)
+{
+    // Passes run in registration order.
+    for (const XrRenderPass& renderPass : m_renderPasses[static_cast<size_t>(stage)])
+    {
+        renderPass.execute(frame, view);
+    }
+}
+
+const XrViewCamera& OpenxrPlugIn::GetCurrentViewCamera() const
+{
+    return m_viewCameras[eyeIndx];
+}
+
+const glm::mat4& OpenxrPlugIn::GetViewProjection(uint32_t viewIndx, const XrFovf& fov)
+{
+    if (viewIndx >= m_projectionCaches.size())
+    {
+        m_projectionCaches.resize(viewIndx + 1);
+    }
+
+    ProjectionCache& cache = m_projectionCaches[viewIndx];
+
+    // The fov of a view only changes on IPD or runtime adjustments, so most frames hit the cache.
+    bool sameFov = cache.fov.angleLeft == fov.angleLeft && cache.fov.angleRight == fov.angleRight &&
+                   cache.fov.angleUp == fov.angleUp && cache.fov.angleDown == fov.angleDown;
+    if (cache.valid && sameFov && cache.clipPlanesVersion == m_clipPlanesVersion)
+    {
+        return cache.projection;
+    }
+
+    XrMatrix4x4f xrProj;
+    if (m_reversedZInfiniteFar)
+    {
+        XrMatrix4x4f_CreateProjectionFovReversedZInfinite(&xrProj, fov, m_nearZ);
+    }
+    else
+    {
+        XrMatrix4x4f_CreateProjectionFov(&xrProj, fov, m_nearZ, m_farZ);
+    }
+    XrMatrix4x4f_To_glm_mat4x4(cache.projection, xrProj);
+
+    cache.fov = fov;
+    cache.clipPlanesVersion = m_clipPlanesVersion;
+    cache.valid = true;
+    return cache.projection;
 }
 
 
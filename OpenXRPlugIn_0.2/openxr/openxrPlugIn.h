@@ -3,14 +3,69 @@
 
 #define XR_USE_GRAPHICS_API_OPENGL
 #define XR_KHR_OPENGL_ENABLE_EXTENSION_NAME "XR_KHR_opengl_enable"
-#define XR_USE_PLATFORM_WIN32
+#if defined(BEE_XR_GRAPHICS_VULKAN)
+#define XR_USE_GRAPHICS_API_VULKAN
+#include <vulkan/vulkan.h>
+#endif
+#if defined(_WIN32)
 #define NOMINMAX
 #include "Windows.h"
+#endif
 #include "openxr.h"
 #include "openxr_platform.h"
 #include "core/ecs.hpp"
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include "XrRenderer.h"
+#include "XrGraphicsBackend.h"
+#include "XrCapabilityCache.h"
+#include "XrCompositionLayers.h"
+#include "XrDebugMessengerFilter.h"
+#include "XrEventBus.h"
+#include "XrJankCapture.h"
+#include "XrReferenceSpace.h"
+#include "XrSessionRecording.h"
+
+
+// Where the plug-in is in the OpenXR lifecycle, driven by the runtime events in PollEvents().
+enum class XrLifecycleState
+{
+    Uninitialized,
+    SessionIdle,     // Session created, not running (before READY and after STOPPING)
+    SessionRunning,  // Between xrBeginSession and xrEndSession, frames are submitted
+    SessionLost,     // Session destroyed after LOSS_PENDING, re-created once the system is back
+    InstanceLost,    // Instance destroyed after INSTANCE_LOSS_PENDING, re-created from scratch
+    Exiting          // Session destroyed after EXITING, the application should quit
+};
+
+// How much of the engine's work is worth doing for XR, from the session state and shouldRender.
+enum class XrThrottleLevel
+{
+    Full,       // FOCUSED and displayed: full update rate, input and rendering
+    Visible,    // VISIBLE and displayed (e.g. under a system overlay): full update rate and rendering, no input
+    Idle,       // Running but not displayed (SYNCHRONIZED, shouldRender false): no rendering, no input
+    Suspended   // No running session (headset off, IDLE, STOPPING, lost): only events are polled
+};
+
+// Published by RenderXRBeguin() every frame. A scheduler can lower its update rate to updateInterval
+// and skip the rendering work while the user cannot see the application.
+struct XrThrottleSignal
+{
+    XrThrottleLevel level = XrThrottleLevel::Suspended;
+    XrSessionState sessionState = XR_SESSION_STATE_UNKNOWN;
+    bool render = false;        // RenderLayer() runs this frame
+    bool pollActions = false;   // PollActions() runs this frame, the action states are cleared otherwise
+    // Suggested time between engine updates, zero for every frame.
+    std::chrono::milliseconds updateInterval{0};
+};
+using XrThrottleCallback = std::function<void(const XrThrottleSignal& signal)>;
 
 
 //ALWAYS 0 = LEFT, 1 = RIGHT
@@ -30,9 +85,56 @@ public:
 
     //INIT
 	bool Init();
+
+    // Asynchronous init. InitAsync() runs the phases that do not need the graphics context (instance,
+    // system, actions, view and blend mode enumeration) on a worker thread, so they overlap with the
+    // engine loading assets. FinishInit() joins the worker and runs the remaining phases (session,
+    // spaces, swapchains) on the calling thread, which must own the graphics context.
+    void InitAsync();
+    bool IsInitReady() const;   // True once FinishInit() will not block
+    bool FinishInit();
+
+    struct InitPhase
+    {
+        const char* name = "";
+        double milliseconds = 0.0;
+        bool onWorker = false;
+    };
+    // Duration of every init phase in execution order, complete after Init() or FinishInit().
+    const std::vector<InitPhase>& GetInitPhases() const { return m_initPhases; }
+
+    // Lifecycle. Without a running session RenderXRBeguin() returns right away. It only polls events, at
+    // most once per idle poll interval, and re-creates a lost session or instance. A lost session is re-created from the
+    // kept instance, action set and swapchain descriptions, so waking the headset does not cost an Init().
+    XrLifecycleState GetLifecycleState() const { return m_lifecycleState; }
+    bool IsExitRequested() const { return m_lifecycleState == XrLifecycleState::Exiting; }
+    void SetIdlePollInterval(std::chrono::milliseconds interval) { m_idlePollInterval = interval; }
+    // Destroys every OpenXR object, also called by the destructor.
+    void Shutdown();
+
+    // Loading screen. While the application loads and does not call RenderXRBeguin(), a thread of its
+    // own keeps the frame loop running and submits only the given composition layers, so the runtime
+    // never shows a frozen image. The layers get their content in BeginLoading(), on the render thread;
+    // the quad progressLayerId is filled from SetLoadingProgress(). The loading thread only begins a READY
+    // session, which GetLifecycleState() reports as running from EndLoading() on. Every event is queued and
+    // dispatched on the render thread by EndLoading(), and frames stop once the session leaves the running
+    // states. Call BeginLoading() and EndLoading() after Init(), on the render thread.
+    bool BeginLoading(const std::vector<uint32_t>& layerIds, uint32_t progressLayerId = 0);
+    void SetLoadingProgress(float progress) { m_loadingProgress.store(progress, std::memory_order_relaxed); }
+    void EndLoading();
+    bool IsLoading() const { return m_loadingThread.joinable(); }
+
+    // Throttle signal, see XrThrottleSignal. The callback is called when the level changes.
+    const XrThrottleSignal& GetThrottleSignal() const { return m_throttleSignal; }
+    void SetThrottleCallback(XrThrottleCallback callback);
+    void SetIdleUpdateInterval(std::chrono::milliseconds interval) { m_idleUpdateInterval = interval; }
 	
 	void  CreateInstance();
     void  CreateDebugMessenger();
+    // Severities, types and rate limits of the logged runtime messages. Call before Init().
+    void SetDebugMessengerSettings(const XrDebugMessengerSettings& settings);
+    // Message counts per severity, performance messages and suppressed repeats.
+    XrDebugMessengerStats GetDebugMessengerStats() const;
     void  GetInstanceProperties();
     void  GetSystemID();        
     XrPath CreateXrPath(const char* path_string);   // Helper functions from string to path
@@ -46,11 +148,48 @@ public:
     void AttachActionSet();
     void CreateReferenceSpace();
     void CreateSwapchains();
+
+    // Capability cache, see XrCapabilityCache.h. Off by default; give it a writable per-user path (not
+    // the working directory, which may be an install directory), call before Init().
+    void SetCapabilityCachePath(const std::string& path);
+    void LoadCapabilityCache();
+    void EnumerateApiLayersAndExtensions();
+    void SelectApiLayersAndExtensions();
+    void EnumerateViewConfigurationViews(std::vector<XrViewConfigurationView>& views);
+    void DiscardCapabilityCache();
+    void ValidateCapabilityCache();
+    void SaveCapabilityCache();
+
+    void RunInitPhase(const char* name, void (OpenxrPlugIn::*phase)(), bool onWorker);
+    void RunContextFreeInitPhases(bool onWorker);
+    void RunContextInitPhases();
+
+    void HandleSessionStateChanged(const XrEventDataSessionStateChanged& sessionStateChanged);
+    bool BeginSession();
+    void OnSessionBegun();
+    void ServiceLifecycle();
+    bool RecreateSession();
+    bool RecreateInstance();
+    void DestroySwapchains();
+    void DestroySession();
+    void DestroyInstance();
+    void UpdateThrottleSignal(bool shouldRender);
+    void RunLoadingFrames();
    
     //Update
     void PollEvents();
+    void DispatchEvent(const XrEventDataBuffer& eventData);
+    void SubscribeEvents();
+    // Runtime events of the polling thread, see XrEventBus.h. Subscribe after the plug-in is created,
+    // the plug-in's own handlers (session state, instance loss) run first.
+    XrEventBus& GetEventBus() { return m_eventBus; }
     void RecordCurrentBindings();
     void PollActions(XrTime predictedTime);
+    void SyncActionStates(XrTime predictedTime);
+    // Between the action states of the plug-in and a recorded frame.
+    void CopyRecordedInput(XrRecordedFrame& frame, bool toFrame);
+    // Releases every button and marks every action inactive, for when input is suspended.
+    void ClearActionStates();
 
     void GetControllerPose(int controllerIndx, float& pos_x, float& pos_y, float& pos_z, glm::quat& rot);
 
@@ -60,6 +199,7 @@ public:
     struct RenderLayerInfo
     {
         XrTime predictedDisplayTime;
+        XrTime runtimeDisplayTime;  // Differs from predictedDisplayTime while replaying, used for the runtime calls.
         std::vector<XrCompositionLayerBaseHeader*> layers;
         XrCompositionLayerProjection layerProjection = {XR_TYPE_COMPOSITION_LAYER_PROJECTION};
         std::vector<XrCompositionLayerProjectionView> layerProjectionViews;
@@ -70,9 +210,69 @@ public:
 
     void RenderXRBeguin();
     bool RenderLayer(RenderLayerInfo& renderLayerInfo);
-    void BlitToSwapchain(int eyeIndex, int finalBufferIndx, int finalBufferTextureWidth, int finalBufferTextureHeight);
+    void BlitToSwapchain(const XrRenderTarget& target, GLuint finalBufferIndx, int finalBufferTextureWidth, int finalBufferTextureHeight);
     void RenderXREnd();
 
+    // Frame timeline in Chrome Trace Event JSON, see XrFrameTrace.h. With a dump prefix the last
+    // capacity events are also written to <prefix><frame index>.json when the runtime misses a frame.
+    void StartFrameTrace(uint32_t capacity = 65536, const std::string& missedFrameDumpPrefix = "");
+    void StopFrameTrace();
+    bool WriteFrameTrace(const std::string& path);
+
+    // History written to disk on missed frames, see XrJankCapture.h.
+    void SetJankCaptureSettings(const XrJankCaptureSettings& settings);
+    uint64_t GetMissedFrameCount() const { return m_jankCapture.GetMissedFrameCount(); }
+
+    // Record/replay, see XrSessionRecording.h. A replay takes the frame timing, views and input from the
+    // file instead of the runtime; the runtime still provides the session, the swapchains and the pacing.
+    bool StartRecording(const std::string& path);
+    void StopRecording();
+    bool StartReplay(const std::string& path, bool loop = false);
+    void StopReplay();
+    bool IsReplaying() const { return m_replayFile.IsOpen(); }
+    const XrRecordedFrame* NextReplayFrame();
+
+    // Graphics API the session renders with. Call before Init() to replace the build time default.
+    void SetGraphicsBackend(std::unique_ptr<XrGraphicsBackend> backend);
+    XrGraphicsBackend& GetGraphicsBackend();
+
+    // Renderer the frame loop hands every view to. Not owned, nullptr falls back to the Bee RendererXR.
+    void SetRenderer(XrRenderer* renderer);
+    XrRenderer& GetRenderer();
+
+    // Render hooks. PerFrame passes run once after xrLocateViews, PerView passes are run by the
+    // renderer for every eye. Returns an id for RemoveRenderPass().
+    uint32_t AddRenderPass(XrRenderStage stage, const char* name, XrRenderPassFunction execute);
+    void RemoveRenderPass(uint32_t passId);
+    void ExecuteRenderPasses(XrRenderStage stage, const XrRenderFrame& frame, const XrRenderView* view);
+
+    // Projection
+    // Clip planes used for every view. With reversedZInfiniteFar the far plane is ignored and the
+    // renderer is expected to use a [0,1] depth range with a GL_GREATER depth test.
+    void SetClipPlanes(float nearZ, float farZ, bool reversedZInfiniteFar = false);
+    // Returns the cached projection of a view, rebuilt only when its fov or the clip planes changed.
+    const glm::mat4& GetViewProjection(uint32_t viewIndx, const XrFovf& fov);
+
+    // Camera
+    // World transform of the tracking space (usually the XR rig), applied on top of the eye poses.
+    void SetTrackingOrigin(const glm::mat4& worldFromTrackingSpace);
+    const glm::mat4& GetTrackingOrigin() const { return m_worldFromTrackingSpace; }
+    // Entity with the bee::Camera that BeeXrRenderer gives each eye's projection, the xrCameraEntity of
+    // CreateXRRig(). Without it the first camera is used. The eye view comes from GetCurrentViewCamera(),
+    // no Transform is written.
+    void SetCameraEntity(bee::Entity cameraEntity) { m_cameraEntity = cameraEntity; }
+    bee::Entity GetCameraEntity() const { return m_cameraEntity; }
+    // LOCAL, STAGE or LOCAL_FLOOR and the recentering, see XrReferenceSpace.h. Cameras and controller
+    // poses are reported in the recentered space.
+    XrReferenceSpace& GetReferenceSpace() { return m_referenceSpace; }
+    void UpdateViewCameras(const XrView* views, uint32_t viewCount);
+    // Camera of the eye being rendered, valid during RenderLayer().
+    const XrViewCamera& GetCurrentViewCamera() const;
+
+    // Layers
+    // Quads with their own swapchains, rendered only when marked dirty, see XrCompositionLayers.h.
+    XrCompositionLayers& GetCompositionLayers() { return m_compositionLayers; }
+
 
 // XR essentials
 #pragma region variables
@@ -84,6 +284,7 @@ public:
     std::vector<std::string> m_instanceExtensions = {};
 
     XrDebugUtilsMessengerEXT m_debugUtilsMessenger = {};
+    XrDebugMessengerFilter m_debugMessengerFilter;
 
     XrFormFactor m_formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
     XrSystemId m_systemID = {};
@@ -91,8 +292,42 @@ public:
 
     XrSession m_session = XR_NULL_HANDLE;
     XrSessionState m_sessionState = XR_SESSION_STATE_UNKNOWN;
-
-    XrGraphicsBindingOpenGLWin32KHR graphicsBinding;
+    XrEventBus m_eventBus;
+
+    // Enumeration results of the runtime, loaded from and saved to m_capabilityCachePath.
+    // m_useCachedCapabilities is true while the init decides from the loaded cache instead of the runtime.
+    XrCapabilityCache m_capabilityCache;
+    std::string m_capabilityCachePath = "";
+    bool m_useCachedCapabilities = false;
+
+    std::future<void> m_initWorker;
+    std::vector<InitPhase> m_initPhases = {};
+
+    XrLifecycleState m_lifecycleState = XrLifecycleState::Uninitialized;
+    std::chrono::milliseconds m_idlePollInterval{10};
+    std::chrono::steady_clock::time_point m_nextIdlePoll = {};
+    // Re-creation after a loss is retried at this rate until the runtime accepts it.
+    std::chrono::steady_clock::time_point m_nextRecreateAttempt = {};
+    // Start of the loss, for the resume time logged once the session runs again.
+    std::chrono::steady_clock::time_point m_lossStart = {};
+    bool m_resuming = false;
+
+    XrThrottleSignal m_throttleSignal = {};
+    XrThrottleCallback m_throttleCallback;
+    std::chrono::milliseconds m_idleUpdateInterval{100};
+
+    std::thread m_loadingThread;
+    std::atomic<bool> m_loadingStop{false};
+    std::atomic<float> m_loadingProgress{0.0f};
+    std::vector<uint32_t> m_loadingLayers;
+    uint32_t m_loadingProgressLayer = 0;
+    // Polled by the loading thread, dispatched by EndLoading().
+    std::vector<XrEventDataBuffer> m_loadingEvents;
+    // Set by the loading thread when it began the session, applied by EndLoading().
+    bool m_loadingBegunSession = false;
+
+    // Graphics API specific part of the session and the swapchains, see XrGraphicsBackend.h.
+    std::unique_ptr<XrGraphicsBackend> m_graphicsBackend;
 
 #pragma endregion
 
@@ -115,7 +350,7 @@ public:
     // The XrPaths for left and right hand hands or controllers.
     XrPath m_handPaths[2] = {0, 0};
     // The spaces that represents the two hand poses.
-    XrSpace m_handPoseSpace[2];
+    XrSpace m_handPoseSpace[2] = {XR_NULL_HANDLE, XR_NULL_HANDLE};
     XrActionStatePose m_handPoseState[2] = {{XR_TYPE_ACTION_STATE_POSE}, {XR_TYPE_ACTION_STATE_POSE}};
     // The current poses obtained from the XrSpaces.
     float m_viewHeightM = 1.5f;
@@ -194,12 +429,61 @@ public:
     std::vector<SwapchainInfo> m_colorSwapchainInfos = {};
     std::vector<SwapchainInfo> m_depthSwapchainInfos = {};
 
-    std::vector<std::vector<XrSwapchainImageOpenGLKHR>> swapchainImages;
+    // Swapchain descriptions of the first CreateSwapchains(), reused when the session is re-created.
+    std::vector<XrSwapchainCreateInfo> m_swapchainCreateInfos = {};
+
+    // Native swapchain images per view, GL texture names or VkImages depending on the graphics backend.
+    std::vector<std::vector<uint64_t>> swapchainImages;
 
-    unsigned int swapchainImageIndx = 0;
     unsigned int eyeIndx = 0;
 #pragma endregion
 
+// Projection
+#pragma region variables
+
+    struct ProjectionCache
+    {
+        XrFovf fov = {};
+        uint32_t clipPlanesVersion = 0;
+        bool valid = false;
+        glm::mat4 projection = glm::mat4(1.0f);
+    };
+    std::vector<ProjectionCache> m_projectionCaches = {};
+
+    float m_nearZ = 0.05f;
+    float m_farZ = 100.0f;
+    bool m_reversedZInfiniteFar = false;
+    // Bumped by SetClipPlanes() so every cached projection gets rebuilt once.
+    uint32_t m_clipPlanesVersion = 1;
+
+    std::vector<XrViewCamera> m_viewCameras = {};
+    glm::mat4 m_worldFromTrackingSpace = glm::mat4(1.0f);
+    bee::Entity m_cameraEntity = entt::null;
+
+#pragma endregion
+
+// Renderer
+#pragma region variables
+
+    XrRenderer* m_renderer = nullptr;
+    std::unique_ptr<XrRenderer> m_defaultRenderer;
+    std::vector<XrRenderView> m_renderViews = {};
+    uint64_t m_frameIndx = 0;
+    XrJankCapture m_jankCapture;
+
+    XrSessionRecordingFile m_recordFile;
+    XrRecordedFrame m_recordFrame;
+    XrSessionRecordingFile m_replayFile;
+    uint64_t m_replayFrameIndx = 0;
+    bool m_replayLoop = false;
+    // Frame of the replay driving the current frame, null outside a replay.
+    const XrRecordedFrame* m_replayFrame = nullptr;
+
+    std::vector<XrRenderPass> m_renderPasses[static_cast<size_t>(XrRenderStage::Count)];
+    uint32_t m_nextRenderPassId = 1;
+
+#pragma endregion
+
 // Layer and blend
 #pragma region variables
 
@@ -208,7 +492,11 @@ public:
     std::vector<XrEnvironmentBlendMode> m_environmentBlendModes = {};
     XrEnvironmentBlendMode m_environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_MAX_ENUM;
 
-    XrSpace m_localSpace = XR_NULL_HANDLE;
+    // Space the views, hands and layers are located in, with the recentering offset.
+    XrReferenceSpace m_referenceSpace;
+
+    // Layers submitted with the projection layer.
+    XrCompositionLayers m_compositionLayers;
 
 
 #pragma endregion
@@ -556,6 +556,40 @@ inline static void XrMatrix4x4f_CreateProjectionFov(XrMatrix4x4f* result, const
     XrMatrix4x4f_CreateProjection(result, tanLeft, tanRight, tanUp, tanDown, nearZ, farZ);
 }
 
+// Creates a reversed-Z projection matrix with the far plane at infinity based on the specified FOV.
+// Depth is written to a [0,1] Z clip space with 1 at nearZ and 0 at infinity, so it requires
+// glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE), a depth clear of 0 and a GL_GREATER depth test.
+inline static void XrMatrix4x4f_CreateProjectionFovReversedZInfinite(XrMatrix4x4f* result, const XrFovf fov, const float nearZ) {
+    const float tanLeft = tanf(fov.angleLeft);
+    const float tanRight = tanf(fov.angleRight);
+
+    const float tanDown = tanf(fov.angleDown);
+    const float tanUp = tanf(fov.angleUp);
+
+    const float tanAngleWidth = tanRight - tanLeft;
+    const float tanAngleHeight = tanUp - tanDown;
+
+    result->m[0] = 2.0f / tanAngleWidth;
+    result->m[4] = 0.0f;
+    result->m[8] = (tanRight + tanLeft) / tanAngleWidth;
+    result->m[12] = 0.0f;
+
+    result->m[1] = 0.0f;
+    result->m[5] = 2.0f / tanAngleHeight;
+    result->m[9] = (tanUp + tanDown) / tanAngleHeight;
+    result->m[13] = 0.0f;
+
+    result->m[2] = 0.0f;
+    result->m[6] = 0.0f;
+    result->m[10] = 0.0f;
+    result->m[14] = nearZ;
+
+    result->m[3] = 0.0f;
+    result->m[7] = 0.0f;
+    result->m[11] = -1.0f;
+    result->m[15] = 0.0f;
+}
+
 // Creates a matrix that transforms the -1 to 1 cube to cover the given 'mins' and 'maxs' transformed with the given 'matrix'.
 inline static void XrMatrix4x4f_CreateOffsetScaleForBounds(XrMatrix4x4f* result, const XrMatrix4x4f* matrix, const XrVector3f* mins,
                                                            const XrVector3f* maxs) {
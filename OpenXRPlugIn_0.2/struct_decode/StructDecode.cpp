@@ -0,0 +1,48 @@
+// Prints the struct records written by XrStructWriter (openxr/XrStructSerializer.h).
+//
+//   bee_xr_struct_decode <file> [offset]
+//
+// The file holds records back to back, starting at offset (default 0).
+
+#include "XrStructSerializer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <file> [offset]\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file)
+    {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    size_t offset = argc > 2 ? strtoull(argv[2], nullptr, 0) : 0;
+    uint64_t records = 0;
+    while (offset < data.size())
+    {
+        size_t size = XrDecodeStructRecord(data.data() + offset, data.size() - offset, std::cout);
+        if (size == 0)
+        {
+            fprintf(stderr, "malformed record at offset %zu\n", offset);
+            return 1;
+        }
+        offset += size;
+        records++;
+    }
+    std::cout << records << " records\n";
+    return 0;
+}